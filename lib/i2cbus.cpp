@@ -2,68 +2,122 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <linux/i2c-dev.h>
-#include "common/mathutil.h" //for CtoK, etc
+#ifndef I2C_SMBUS_BLOCK_MAX
+	//i2c-tools' version of i2c-dev.h defines the SMBus types itself; the kernel's leaves them to i2c.h
+	#include <linux/i2c.h>
+#endif
 #include "common/logging.h"
 
 namespace drv {
 
-	I2CBus::I2CBus() {}
+	//Perform an SMBus transfer directly through the I2C_SMBUS ioctl,
+	//  rather than via the i2c-tools helpers, which newer systems only provide in a separate library (libi2c).
+	static int smbusAccess(int fd, uint8_t readWrite, uint8_t command, int size, union i2c_smbus_data *data) {
+		struct i2c_smbus_ioctl_data args;
+		args.read_write = readWrite;
+		args.command = command;
+		args.size = size;
+		args.data = data;
+		return ioctl(fd, I2C_SMBUS, &args);
 	}
 
+	I2CBus::I2CBus() : fd(-1) {}
+
 	I2CBus::~I2CBus() {
 	//	close(fd);
 	}
 
-	void I2CBus::busSet(const char * deviceName) {
+	bool I2CBus::busSet(const char * deviceName) {
 		fd = open(deviceName, O_RDWR);
 		if (fd == -1) {
 			LOGE("Failed to open %s (did you remember to run as root?)\n", deviceName );
+			return false;
 		}
+		return true;
 	}
 
-	void I2CBus::addressSet(uint8_t address) {
+	bool I2CBus::addressSet(uint8_t address) {
 		int result = ioctl(fd, I2C_SLAVE, address);
 		if (result == -1) {
 			LOGE("Failed to set I2C address 0x%02X\n", address );
+			return false;
 		}
+		return true;
 	}
 
-	void I2CBus::writeByte(uint8_t command, uint8_t data) {
-		int result = i2c_smbus_write_byte_data(fd, command, data);
+	bool I2CBus::writeByte(uint8_t command, uint8_t data) {
+		union i2c_smbus_data buffer;
+		buffer.byte = data;
+		int result = smbusAccess(fd, I2C_SMBUS_WRITE, command, I2C_SMBUS_BYTE_DATA, &buffer);
 		if (result == -1) {
 			LOGE("Failed to write byte to I2C.\n");
+			return false;
+		}
+		return true;
+	}
+
+	bool I2CBus::writeShort(uint8_t command, uint16_t data) {
+		union i2c_smbus_data buffer;
+		buffer.word = data;
+		int result = smbusAccess(fd, I2C_SMBUS_WRITE, command, I2C_SMBUS_WORD_DATA, &buffer);
+		if (result == -1) {
+			LOGE("Failed to write short to I2C.\n");
+			return false;
 		}
+		return true;
 	}
 
 	uint8_t I2CBus::readByte(uint8_t command) {
-		int result = i2c_smbus_read_byte_data(fd, command);
+		int result = tryReadByte(command);
 		if (result == -1) {
 			LOGE("Failed to read byte from I2C.\n");
+			result = 0;
 		}
 		return result;
 	}
 
 	uint16_t I2CBus::readShort(uint8_t command) {
-		int result = i2c_smbus_read_word_data(fd, command);
+		int result = tryReadShort(command);
 		if (result == -1) {
 			LOGE("Failed to read short from I2C.\n");
-	        result = 0;
+			result = 0;
 		}
 		return result;
 	}
 
-
 	int I2CBus::tryReadByte(uint8_t command) {
-		return i2c_smbus_read_byte_data(fd, command);
+		union i2c_smbus_data buffer;
+		if (smbusAccess(fd, I2C_SMBUS_READ, command, I2C_SMBUS_BYTE_DATA, &buffer) == -1) {
+			return -1;
+		}
+		return buffer.byte;
 	}
 
-	void I2CBus::readBlock(uint8_t command, uint8_t size, uint8_t * data) {
-		int result = i2c_smbus_read_i2c_block_data(fd, command, size, data);
-		if (result != size) {
+	int I2CBus::tryReadShort(uint8_t command) {
+		union i2c_smbus_data buffer;
+		if (smbusAccess(fd, I2C_SMBUS_READ, command, I2C_SMBUS_WORD_DATA, &buffer) == -1) {
+			return -1;
+		}
+		return buffer.word;
+	}
+
+	bool I2CBus::readBlock(uint8_t command, uint8_t size, uint8_t * data) {
+		union i2c_smbus_data buffer;
+		if (size > I2C_SMBUS_BLOCK_MAX) {
+			size = I2C_SMBUS_BLOCK_MAX;
+		}
+		//the first byte of the block holds its length, both to request a size and to report the size read
+		buffer.block[0] = size;
+		int result = smbusAccess(fd, I2C_SMBUS_READ, command, size == I2C_SMBUS_BLOCK_MAX ? I2C_SMBUS_I2C_BLOCK_BROKEN : I2C_SMBUS_I2C_BLOCK_DATA, &buffer);
+		if (result == -1 || buffer.block[0] != size) {
 			LOGE("Failed to read block from I2C.\n");
+			return false;
 		}
+		memcpy(data, &buffer.block[1], size);
+		return true;
 	}
 
 }
@@ -1,4 +1,3 @@
-
 #ifndef _I2CBus_h
 #define _I2CBus_h
 #include <stdint.h>
@@ -10,15 +9,23 @@ class I2CBus
 	public:
 		I2CBus();
 		~I2CBus();
-		void busSet(const char * deviceName);
-		void addressSet(uint8_t address);
-		void writeByte(uint8_t command, uint8_t data);
+		//the following return false (after logging an error) if the transfer fails
+		bool busSet(const char * deviceName);
+		bool addressSet(uint8_t address);
+		bool writeByte(uint8_t command, uint8_t data);
+		//note: SMBus transfers words least-significant byte first
+		bool writeShort(uint8_t command, uint16_t data);
+		//readByte and readShort return 0 on failure; use the tryRead variants to tell a failure apart from a 0 reading
 		uint8_t readByte(uint8_t command);
 		uint16_t readShort(uint8_t command);
+		//return the value read, or -1 on failure
 		int tryReadByte(uint8_t command);
-		void readBlock(uint8_t command, uint8_t size, uint8_t * data);
+		int tryReadShort(uint8_t command);
+		bool readBlock(uint8_t command, uint8_t size, uint8_t * data);
 		int tryReadByte(uint8_t address, uint8_t command) {
-			addressSet(address);
+			if (!addressSet(address)) {
+				return -1;
+			}
 			return tryReadByte(command);
 		}
 
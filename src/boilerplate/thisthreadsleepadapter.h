@@ -26,6 +26,9 @@
 #define BOILERPLATE_THISTHREADSLEEPADAPTER_H
 
 #include <chrono>
+#include <cstddef> //for size_t
+
+struct pollfd;
 
 //allows for sleeping to an absolute time when the custom clock (EventClockT) has a different offset than the system clock (which is otherwise used for measuring sleep times).
 //@ClockT the clock to which absolute times should be compared.
@@ -39,6 +42,19 @@ template <typename ClockT, typename SleepT> struct ThisThreadSleepAdapter {
     template <class Rep, class Period> static void sleep_for(const std::chrono::duration<Rep, Period> &dur) {
         SleepT::sleep_for(dur);
     }
+    //sleep until @sleep_time, or until any of the @numFds descriptors in @fds has an event.
+    template<class Clock, class Duration> static int poll_until(const std::chrono::time_point<Clock, Duration> &sleep_time, struct pollfd *fds, std::size_t numFds) {
+        auto now = ClockT::now();
+        auto rel = sleep_time.time_since_epoch() - now.time_since_epoch();
+        return poll_for(rel, fds, numFds);
+    }
+    template <class Rep, class Period> static int poll_for(const std::chrono::duration<Rep, Period> &dur, struct pollfd *fds, std::size_t numFds) {
+        if (numFds == 0) {
+            SleepT::sleep_for(dur);
+            return 0;
+        }
+        return SleepT::poll_for(dur, fds, numFds);
+    }
 };
 
 #endif
@@ -0,0 +1,186 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "allocaudit.h"
+
+#if ALLOC_AUDIT
+
+#include <cstdlib> //for malloc, abort
+#include <new> //for std::bad_alloc, std::nothrow_t
+#include <cstring> //for memcmp
+#include <execinfo.h> //for backtrace
+#include <unistd.h> //for STDOUT_FILENO
+#include "common/logging.h"
+
+#ifdef __GLIBC__
+    //glibc exposes its allocator under these names, which lets us interpose malloc itself.
+    extern "C" {
+        void* __libc_malloc(std::size_t size);
+        void* __libc_calloc(std::size_t num, std::size_t size);
+        void* __libc_realloc(void *ptr, std::size_t size);
+    }
+    #define RAW_MALLOC __libc_malloc
+#else
+    #define RAW_MALLOC std::malloc
+#endif
+
+namespace allocaudit {
+
+namespace {
+    //number of stack frames stored per call-site (the first few are always inside the allocator/interposer)
+    const int CALL_SITE_DEPTH = 10;
+    const std::size_t MAX_CALL_SITES = 64;
+
+    struct CallSite {
+        void *frames[CALL_SITE_DEPTH];
+        int numFrames;
+        std::size_t count;
+    };
+
+    //Only one thread (the event loop) is expected to hold a Scope at a time, so these aren't synchronized.
+    CallSite callSites[MAX_CALL_SITES];
+    std::size_t numCallSites = 0;
+    std::size_t numAllocs = 0;
+    bool abortOnAlloc = false;
+    //true if the current thread's allocations should be recorded. Cleared while recording, to avoid recursion.
+    thread_local bool isAuditing = false;
+    //Scopes may nest (e.g. homing runs a nested event loop); only the outermost one resets & reports.
+    thread_local int scopeDepth = 0;
+
+    void record() {
+        if (!isAuditing) {
+            return;
+        }
+        isAuditing = false;
+        ++numAllocs;
+        void *frames[CALL_SITE_DEPTH];
+        int numFrames = backtrace(frames, CALL_SITE_DEPTH);
+        if (abortOnAlloc) {
+            LOGE("allocaudit: heap allocation inside the event loop; aborting. Backtrace:\n");
+            //the message above is written by the logging thread; make sure it's out before the backtrace (and the abort)
+            logging::flush();
+            backtrace_symbols_fd(frames, numFrames, STDERR_FILENO);
+            abort();
+        }
+        //look for a matching call-site; else append a new one (if room)
+        std::size_t i = 0;
+        for (; i < numCallSites; ++i) {
+            if (callSites[i].numFrames == numFrames && memcmp(callSites[i].frames, frames, numFrames*sizeof(void*)) == 0) {
+                break;
+            }
+        }
+        if (i == numCallSites && numCallSites < MAX_CALL_SITES) {
+            memcpy(callSites[i].frames, frames, numFrames*sizeof(void*));
+            callSites[i].numFrames = numFrames;
+            callSites[i].count = 0;
+            ++numCallSites;
+        }
+        if (i < numCallSites) {
+            ++callSites[i].count;
+        }
+        isAuditing = true;
+    }
+}
+
+Scope::Scope() {
+    if (scopeDepth++ == 0) {
+        //backtrace() allocates when first called (it lazily loads libgcc), so do that before auditing is enabled.
+        void *frames[1];
+        backtrace(frames, 1);
+        numCallSites = 0;
+        numAllocs = 0;
+        isAuditing = true;
+    }
+}
+
+Scope::~Scope() {
+    if (--scopeDepth == 0) {
+        isAuditing = false;
+        logReport();
+    }
+}
+
+void setAbortOnAlloc(bool doAbort) {
+    abortOnAlloc = doAbort;
+}
+
+std::size_t numAllocations() {
+    return numAllocs;
+}
+
+void logReport() {
+    if (numAllocs == 0) {
+        LOG("allocaudit: no heap allocations inside the event loop\n");
+        return;
+    }
+    LOGW("allocaudit: %zu heap allocations inside the event loop, from %zu call-sites:\n", numAllocs, numCallSites);
+    for (std::size_t i=0; i<numCallSites; ++i) {
+        LOGW("allocaudit: call-site #%zu allocated %zu times:\n", i, callSites[i].count);
+        logging::flush();
+        backtrace_symbols_fd(callSites[i].frames, callSites[i].numFrames, STDOUT_FILENO);
+    }
+}
+
+}
+
+//Interpose the global allocation functions.
+//Note: only allocation needs to be recorded; the default operator delete & free are compatible with RAW_MALLOC.
+
+void* operator new(std::size_t size) {
+    allocaudit::record();
+    void *p = RAW_MALLOC(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+void* operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    allocaudit::record();
+    return RAW_MALLOC(size);
+}
+void* operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    allocaudit::record();
+    return RAW_MALLOC(size);
+}
+
+#ifdef __GLIBC__
+extern "C" {
+    void* malloc(std::size_t size) noexcept {
+        allocaudit::record();
+        return __libc_malloc(size);
+    }
+    void* calloc(std::size_t num, std::size_t size) noexcept {
+        allocaudit::record();
+        return __libc_calloc(num, size);
+    }
+    void* realloc(void *ptr, std::size_t size) noexcept {
+        allocaudit::record();
+        return __libc_realloc(ptr, size);
+    }
+}
+#endif
+
+#endif
@@ -0,0 +1,72 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef COMMON_ALLOCAUDIT_H
+#define COMMON_ALLOCAUDIT_H
+
+#include <cstddef> //for size_t
+#include "compileflags.h" //for ALLOC_AUDIT
+
+/* 
+ * The event loop is expected to run without touching the heap once the machine is set up
+ *   (allocations may page-fault or take locks, which is unacceptable while stepping motors).
+ * When compiled with `make ALLOC_AUDIT=1`, operator new and malloc are interposed, and every allocation made
+ *   by a thread while it holds an allocaudit::Scope is recorded along with a short backtrace of its call-site.
+ * The Scheduler holds a Scope for the duration of its eventLoop.
+ * Without ALLOC_AUDIT, all of these are no-ops.
+ */
+
+namespace allocaudit {
+
+#if ALLOC_AUDIT
+    //Audits all allocations made by the constructing thread until destruction.
+    //Construction resets the allocation counts; destruction logs a summary of each call-site that allocated.
+    class Scope {
+        public:
+            Scope();
+            ~Scope();
+    };
+    //if @doAbort is true, then the first allocation made inside a Scope will log its backtrace & abort the program.
+    void setAbortOnAlloc(bool doAbort=true);
+    //number of allocations recorded since the most recent Scope was constructed.
+    std::size_t numAllocations();
+    //log each distinct call-site that allocated, along with its allocation count.
+    void logReport();
+#else
+    class Scope {
+        public:
+            //user-provided, so that declaring a Scope doesn't trigger unused-variable warnings
+            inline Scope() {}
+    };
+    inline void setAbortOnAlloc(bool doAbort=true) {
+        (void)doAbort;
+    }
+    inline std::size_t numAllocations() {
+        return 0;
+    }
+    inline void logReport() {}
+#endif
+
+}
+
+#endif
@@ -0,0 +1,56 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "clockdriftestimator.h"
+#include "catch.hpp"
+
+TEST_CASE("ClockDriftEstimator recovers the offset and rate of a drifting clock", "[clockdriftestimator]") {
+    //nominally 4 uS per frame, but actually running 50 ppm slow, and starting at an arbitrary time
+    const double nominal = 4.0, actual = 4.0*(1 + 50e-6);
+    const int64_t offset = 123456789;
+    ClockDriftEstimator est(nominal);
+    SECTION("With 1 sample, the nominal rate is assumed") {
+        est.addSample(1000, offset + 4000);
+        REQUIRE(est.ppmError() == Approx(0));
+        REQUIRE(est.xAt(offset + 8000) == 2000);
+    }
+    SECTION("Jittery samples converge on the true rate") {
+        //sample every 10000 frames (40 mS), with +/-1 uS of jitter in the timestamp
+        for (int i=0; i<3*(int)ClockDriftEstimator::WINDOW; ++i) {
+            int64_t frame = 10000LL*i + 5000000000LL;
+            int jitter = (i*7 % 3) - 1;
+            est.addSample(frame, offset + (int64_t)(frame*actual) + jitter);
+        }
+        REQUIRE(std::abs(est.ppmError() - 50) < 1);
+        int64_t frame = 10000LL*200 + 5000000000LL;
+        REQUIRE(std::abs(est.yAt(frame) - (offset + frame*actual)) < 1.0);
+        REQUIRE(std::abs(est.xAt(offset + (int64_t)(frame*actual)) - frame) <= 1);
+    }
+    SECTION("Resetting forgets the old rate") {
+        est.addSample(0, 0);
+        est.addSample(1000, 5000);
+        REQUIRE(est.period() == Approx(5));
+        est.reset();
+        REQUIRE(est.period() == Approx(nominal));
+    }
+}
@@ -0,0 +1,113 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef COMMON_CLOCKDRIFTESTIMATOR_H
+#define COMMON_CLOCKDRIFTESTIMATOR_H
+
+#include <array>
+#include <cmath> //for std::floor
+#include <cstddef> //for size_t
+#include <cstdint>
+
+/*
+ * ClockDriftEstimator relates two clocks that tick at nearly, but not exactly, a known ratio,
+ *   e.g. the DMA frame counter and the system timer on rpi (see platforms/rpi/hardwarescheduler.cpp).
+ * It's fed (x, y) pairs read from both clocks at the same instant, and fits y = offset + period*x by least squares
+ *   over the most recent WINDOW samples, so that one noisy sample can't shift the estimate much, and slow drift in the rate is tracked.
+ * Until there are 2 samples, the nominal period is assumed.
+ */
+class ClockDriftEstimator {
+    public:
+        static const std::size_t WINDOW = 64;
+    private:
+        struct Sample {
+            int64_t x, y;
+        };
+        double _nominalPeriod;
+        std::array<Sample, WINDOW> _samples;
+        std::size_t _nextSample;
+        std::size_t _numSamples;
+        //fit, expressed relative to a reference sample to preserve precision: y = _yRef + _period*(x - _xRef)
+        int64_t _xRef;
+        double _yRef;
+        double _period;
+    public:
+        //@nominalPeriod the expected change in y per unit of x
+        inline ClockDriftEstimator(double nominalPeriod)
+          : _nominalPeriod(nominalPeriod), _nextSample(0), _numSamples(0), _xRef(0), _yRef(0), _period(nominalPeriod) {}
+        //forget all samples, e.g. if the clocks have been restarted
+        inline void reset() {
+            _nextSample = _numSamples = 0;
+            _xRef = 0;
+            _yRef = 0;
+            _period = _nominalPeriod;
+        }
+        inline std::size_t numSamples() const {
+            return _numSamples;
+        }
+        //record that x and y read @x and @y at the same time, and update the fit.
+        inline void addSample(int64_t x, int64_t y) {
+            _samples[_nextSample].x = x;
+            _samples[_nextSample].y = y;
+            _nextSample = (_nextSample+1) % WINDOW;
+            if (_numSamples < WINDOW) {
+                ++_numSamples;
+            }
+            //accumulate relative to the newest sample, so that the sums stay small no matter how long the clocks have run
+            double sumX=0, sumY=0;
+            for (std::size_t i=0; i<_numSamples; ++i) {
+                sumX += _samples[i].x - x;
+                sumY += _samples[i].y - y;
+            }
+            double meanX = sumX/_numSamples, meanY = sumY/_numSamples;
+            double sxx=0, sxy=0;
+            for (std::size_t i=0; i<_numSamples; ++i) {
+                double dx = _samples[i].x - x - meanX;
+                double dy = _samples[i].y - y - meanY;
+                sxx += dx*dx;
+                sxy += dx*dy;
+            }
+            _period = sxx > 0 ? sxy/sxx : _nominalPeriod;
+            //the fit passes through the mean of the samples
+            _xRef = x;
+            _yRef = y + meanY - _period*meanX;
+        }
+        //@return the estimated change in y per unit of x
+        inline double period() const {
+            return _period;
+        }
+        //@return how far the estimated rate of y relative to x differs from nominal, in parts per million
+        inline double ppmError() const {
+            return (_period/_nominalPeriod - 1.0) * 1e6;
+        }
+        //@return the value y is estimated to have when x reads @x
+        inline double yAt(int64_t x) const {
+            return _yRef + _period*(x - _xRef);
+        }
+        //@return the latest x reading that is estimated to occur at or before y reads @y
+        inline int64_t xAt(int64_t y) const {
+            return _xRef + (int64_t)std::floor((y - _yRef) / _period);
+        }
+};
+
+#endif
@@ -0,0 +1,386 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "latencytracer.h"
+
+#include <stdexcept> //for runtime_error
+#include <cstring> //for strerror, strncpy
+#include <cerrno>
+#include <cstdarg> //for va_list
+#include <algorithm> //for std::min, std::max, std::copy
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib> //for atexit
+#include <fstream> //for ifstream
+#include "compileflags.h"
+#if USE_PTHREAD
+    #include <pthread.h> //for pthread_setschedparam
+#endif
+#include "catch.hpp"
+
+namespace {
+    //number of trace lines that can be waiting to be written. Must be a power of 2.
+    const std::size_t TRACE_RING_SIZE = 256;
+    const std::size_t TRACE_RING_MASK = TRACE_RING_SIZE - 1;
+    //how long the writer thread sleeps when there's nothing to write
+    const std::chrono::milliseconds TRACE_WRITER_IDLE_SLEEP(5);
+
+    //one line of the trace file, copied by LatencyTracer::record & formatted by the writer thread
+    struct TraceLine {
+        long long receivedUsec;
+        char opcode[8];
+        int32_t lineNumber;
+        long long usec[LatencyTracer::NUM_STAGES];
+    };
+}
+
+//Single-producer/single-consumer ring of trace lines, which a background thread writes to the trace file.
+//Only the event loop traces commands, so the producer side needs no compare-and-swap (unlike the logging ring).
+class LatencyTracer::TraceWriter {
+    TraceLine _ring[TRACE_RING_SIZE];
+    //_head is the next slot to be filled by the producer, and _tail the next one to be written out by the writer thread.
+    std::atomic<std::size_t> _head;
+    std::atomic<std::size_t> _tail;
+    std::atomic<std::size_t> _numDropped;
+    std::atomic<bool> _isStopping;
+    FILE *_file;
+    std::thread _thread;
+    //writers that are still running, so that they can be drained if the process exits (e.g. upon SIGINT) without destroying them
+    static std::mutex runningMutex;
+    static std::vector<TraceWriter*> running;
+    public:
+        //takes ownership of @file, and starts writing to it
+        explicit TraceWriter(FILE *file);
+        ~TraceWriter();
+        //queue @line to be written. If the ring is full, the line is dropped (and the drop is noted in the file later)
+        void push(const TraceLine &line);
+    private:
+        //stop the writer thread & write out everything that's queued. Does nothing if already stopped.
+        //If called from the writer thread itself, it's only detached; whatever is still queued isn't written.
+        void stop();
+        //write all queued lines & flush them to the file. Must only be called from one thread at a time.
+        //returns the number of lines written.
+        std::size_t drain();
+        void run();
+        static void stopAll();
+};
+
+std::mutex LatencyTracer::TraceWriter::runningMutex;
+std::vector<LatencyTracer::TraceWriter*> LatencyTracer::TraceWriter::running;
+
+LatencyTracer::TraceWriter::TraceWriter(FILE *file) : _head(0), _tail(0), _numDropped(0), _isStopping(false), _file(file) {
+    std::lock_guard<std::mutex> lock(runningMutex);
+    //registered after the statics above are constructed, so that it runs before they're destroyed
+    static bool isExitHandlerRegistered = (std::atexit(stopAll), true);
+    (void)isExitHandlerRegistered;
+    running.push_back(this);
+    _thread = std::thread(&TraceWriter::run, this);
+}
+
+LatencyTracer::TraceWriter::~TraceWriter() {
+    {
+        std::lock_guard<std::mutex> lock(runningMutex);
+        running.erase(std::find(running.begin(), running.end(), this));
+    }
+    stop();
+    fclose(_file);
+}
+
+void LatencyTracer::TraceWriter::push(const TraceLine &line) {
+    std::size_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) >= TRACE_RING_SIZE) {
+        //rather drop the line than wait on the writer
+        ++_numDropped;
+        return;
+    }
+    _ring[head & TRACE_RING_MASK] = line;
+    _head.store(head+1, std::memory_order_release);
+}
+
+void LatencyTracer::TraceWriter::stop() {
+    if (!_thread.joinable()) {
+        return;
+    }
+    _isStopping.store(true);
+    if (_thread.get_id() == std::this_thread::get_id()) {
+        //exit() was called from the writer thread (e.g. by a signal handler); it can't join itself.
+        //Nor can it drain, as it may have interrupted its own drain().
+        _thread.detach();
+        return;
+    }
+    _thread.join();
+    drain();
+}
+
+std::size_t LatencyTracer::TraceWriter::drain() {
+    std::size_t tail = _tail.load(std::memory_order_relaxed);
+    std::size_t head = _head.load(std::memory_order_acquire);
+    std::size_t numWritten = head - tail;
+    for (; tail != head; ++tail) {
+        const TraceLine &line = _ring[tail & TRACE_RING_MASK];
+        fprintf(_file, "%lld %s %i %lld %lld %lld %lld %lld\n", line.receivedUsec, line.opcode, (int)line.lineNumber,
+            line.usec[STAGE_QUEUE], line.usec[STAGE_EXECUTE], line.usec[STAGE_PLAN], line.usec[STAGE_FIRST_STEP], line.usec[STAGE_TOTAL]);
+    }
+    //release the slots to the producer
+    _tail.store(tail, std::memory_order_release);
+    std::size_t dropped = _numDropped.exchange(0);
+    if (dropped) {
+        fprintf(_file, "# %zu commands were not traced because the trace buffer was full\n", dropped);
+    }
+    if (numWritten || dropped) {
+        //don't leave anything in stdio's buffer, where it would be lost if the process is killed
+        fflush(_file);
+    }
+    return numWritten;
+}
+
+void LatencyTracer::TraceWriter::run() {
+    #if USE_PTHREAD
+        //the writer may have been started from a real-time thread; it must never compete with it.
+        struct sched_param sp;
+        sp.sched_priority = 0;
+        pthread_setschedparam(pthread_self(), SCHED_OTHER, &sp);
+    #endif
+    while (!_isStopping.load()) {
+        if (!drain()) {
+            std::this_thread::sleep_for(TRACE_WRITER_IDLE_SLEEP);
+        }
+    }
+}
+
+void LatencyTracer::TraceWriter::stopAll() {
+    std::lock_guard<std::mutex> lock(runningMutex);
+    for (TraceWriter *writer : running) {
+        writer->stop();
+    }
+}
+
+LatencyHistogram::LatencyHistogram() {
+    clear();
+}
+
+void LatencyHistogram::add(EventClockT::duration latency) {
+    int64_t usec = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+    uint32_t clamped = usec < 0 ? 0 : (usec > (int64_t)UINT32_MAX ? UINT32_MAX : (uint32_t)usec);
+    //bucket = number of significant bits, so that bucket i holds [2^(i-1), 2^i)
+    std::size_t bucket = clamped ? 32 - __builtin_clz(clamped) : 0;
+    ++_buckets[bucket < NUM_BUCKETS ? bucket : NUM_BUCKETS-1];
+    ++_count;
+    _maxUsec = std::max(_maxUsec, clamped);
+}
+
+void LatencyHistogram::clear() {
+    _buckets.fill(0);
+    _count = 0;
+    _maxUsec = 0;
+}
+
+uint32_t LatencyHistogram::quantileUsec(float fraction) const {
+    //number of samples that must lie at or below the quantile
+    uint32_t needed = (uint32_t)(fraction*_count + 0.5f);
+    uint32_t seen = 0;
+    for (std::size_t i=0; i<NUM_BUCKETS; ++i) {
+        seen += _buckets[i];
+        if (seen >= needed && seen) {
+            return std::min(bucketLimitUsec(i), _maxUsec);
+        }
+    }
+    return _maxUsec;
+}
+
+LatencyTracer::LatencyTracer() {}
+
+LatencyTracer::LatencyTracer(LatencyTracer &&other) = default;
+
+LatencyTracer::~LatencyTracer() {}
+
+void LatencyTracer::openTraceFile(const std::string &path) {
+    FILE *f = fopen(path.c_str(), "w");
+    if (!f) {
+        throw std::runtime_error("Unable to open latency trace file " + path + ": " + strerror(errno));
+    }
+    fprintf(f, "# received_us opcode line queue_us execute_us plan_us first_step_us total_us (-1 if not applicable)\n");
+    _traceWriter.reset(new TraceWriter(f));
+}
+
+void LatencyTracer::record(const CommandTimestamps &stamps, const char *opcode, int32_t lineNumber) {
+    //latency (in us) between two stages, or -1 if the command didn't pass through both
+    auto usecBetween = [](const EventClockT::time_point &from, const EventClockT::time_point &to) -> long long {
+        if (!CommandTimestamps::isSet(from) || !CommandTimestamps::isSet(to)) {
+            return -1;
+        }
+        return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+    };
+    const EventClockT::time_point *stageBounds[NUM_STAGES][2] = {
+        { &stamps.received,   &stamps.dispatched },
+        { &stamps.dispatched, &stamps.replied },
+        { &stamps.dispatched, &stamps.planned },
+        { &stamps.planned,    &stamps.firstStep },
+        { &stamps.received,   &stamps.firstStep },
+    };
+    TraceLine line;
+    for (std::size_t s=0; s<NUM_STAGES; ++s) {
+        line.usec[s] = usecBetween(*stageBounds[s][0], *stageBounds[s][1]);
+        if (line.usec[s] != -1) {
+            _histograms[s].add(*stageBounds[s][1] - *stageBounds[s][0]);
+        }
+    }
+    if (_traceWriter) {
+        line.receivedUsec = std::chrono::duration_cast<std::chrono::microseconds>(stamps.received.time_since_epoch()).count();
+        strncpy(line.opcode, opcode, sizeof(line.opcode)-1);
+        line.opcode[sizeof(line.opcode)-1] = '\0';
+        line.lineNumber = lineNumber;
+        _traceWriter->push(line);
+    }
+}
+
+void LatencyTracer::clear() {
+    for (LatencyHistogram &h : _histograms) {
+        h.clear();
+    }
+}
+
+const char* LatencyTracer::stageName(Stage stage) {
+    static const char* names[NUM_STAGES] = { "queue", "exec", "plan", "step", "total" };
+    return names[stage];
+}
+
+//append printf-style text at @dest+@len, keeping snprintf's semantics of returning the untruncated length
+__attribute__ ((format (printf, 4, 5))) static std::size_t appendf(char *dest, std::size_t size, std::size_t len, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int added = vsnprintf(len < size ? dest+len : nullptr, len < size ? size-len : 0, fmt, args);
+    va_end(args);
+    return len + (added < 0 ? 0 : added);
+}
+
+std::size_t LatencyTracer::formatSummary(char *dest, std::size_t size) const {
+    if (size) {
+        dest[0] = '\0';
+    }
+    std::size_t len = 0;
+    for (std::size_t s=0; s<NUM_STAGES; ++s) {
+        const LatencyHistogram &h = _histograms[s];
+        len = appendf(dest, size, len, "%s%s:%u/%u/%u/%u", s ? " " : "", stageName((Stage)s),
+            (unsigned)h.count(), (unsigned)h.quantileUsec(0.5f), (unsigned)h.quantileUsec(0.99f), (unsigned)h.maxUsec());
+    }
+    return len;
+}
+
+std::size_t LatencyTracer::formatHistogram(Stage stage, char *dest, std::size_t size) const {
+    const LatencyHistogram &h = _histograms[stage];
+    std::size_t len = appendf(dest, size, 0, "%s", stageName(stage));
+    for (std::size_t i=0; i<LatencyHistogram::NUM_BUCKETS; ++i) {
+        if (h.bucketCount(i)) {
+            len = appendf(dest, size, len, " %u:%u", (unsigned)LatencyHistogram::bucketLimitUsec(i), (unsigned)h.bucketCount(i));
+        }
+    }
+    return len;
+}
+
+TEST_CASE("LatencyTracer sorts command latencies into histograms", "[latencytracer]") {
+    LatencyTracer tracer;
+    CommandTimestamps stamps;
+    EventClockT::time_point t0 = EventClockT::time_point(std::chrono::seconds(1));
+    stamps.received = t0;
+    stamps.dispatched = t0 + std::chrono::microseconds(3);
+    stamps.replied = t0 + std::chrono::microseconds(100);
+    SECTION("Commands that don't move only fill the queue & execute stages") {
+        tracer.record(stamps, "M105", -1);
+        REQUIRE(tracer.histogram(LatencyTracer::STAGE_QUEUE).count() == 1);
+        //3 us lies in [2, 4)
+        REQUIRE(tracer.histogram(LatencyTracer::STAGE_QUEUE).bucketCount(2) == 1);
+        REQUIRE(tracer.histogram(LatencyTracer::STAGE_EXECUTE).maxUsec() == 97);
+        REQUIRE(tracer.histogram(LatencyTracer::STAGE_PLAN).count() == 0);
+        REQUIRE(tracer.histogram(LatencyTracer::STAGE_TOTAL).count() == 0);
+    }
+    SECTION("Moves fill every stage") {
+        stamps.planned = t0 + std::chrono::microseconds(50);
+        stamps.firstStep = t0 + std::chrono::microseconds(1000);
+        tracer.record(stamps, "G1", 5);
+        REQUIRE(tracer.histogram(LatencyTracer::STAGE_PLAN).maxUsec() == 47);
+        REQUIRE(tracer.histogram(LatencyTracer::STAGE_FIRST_STEP).maxUsec() == 950);
+        REQUIRE(tracer.histogram(LatencyTracer::STAGE_TOTAL).maxUsec() == 1000);
+        char buffer[256];
+        tracer.formatHistogram(LatencyTracer::STAGE_TOTAL, buffer, sizeof(buffer));
+        REQUIRE(std::string(buffer) == "total 1024:1");
+    }
+    SECTION("Quantiles are bounded by the bucket limits") {
+        for (int i=0; i<99; ++i) {
+            tracer.record(stamps, "M105", -1);
+        }
+        stamps.replied = t0 + std::chrono::milliseconds(50);
+        tracer.record(stamps, "M105", -1);
+        const LatencyHistogram &exec = tracer.histogram(LatencyTracer::STAGE_EXECUTE);
+        //97 us lies in [64, 128)
+        REQUIRE(exec.quantileUsec(0.5f) == 128);
+        REQUIRE(exec.quantileUsec(0.99f) == 128);
+        REQUIRE(exec.maxUsec() == 49997);
+        char buffer[256];
+        tracer.formatSummary(buffer, sizeof(buffer));
+        REQUIRE(std::string(buffer) == "queue:100/3/3/3 exec:100/128/128/49997 plan:0/0/0/0 step:0/0/0/0 total:0/0/0/0");
+    }
+}
+
+TEST_CASE("LatencyTracer writes traced commands to the file in the background", "[latencytracer]") {
+    const char *path = "test-printipi-latency-trace.txt";
+    auto readLines = [&]() {
+        std::ifstream file(path);
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(file, line)) {
+            lines.push_back(line);
+        }
+        return lines;
+    };
+    CommandTimestamps stamps;
+    EventClockT::time_point t0 = EventClockT::time_point(std::chrono::seconds(1));
+    stamps.received = t0;
+    stamps.dispatched = t0 + std::chrono::microseconds(3);
+    stamps.replied = t0 + std::chrono::microseconds(100);
+    {
+        LatencyTracer tracer;
+        tracer.openTraceFile(path);
+        tracer.record(stamps, "M105", 7);
+        //the line reaches the file while the tracer is still open (i.e. it wouldn't be lost if the process were killed now)
+        auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (readLines().size() < 2 && std::chrono::steady_clock::now() < timeout) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::vector<std::string> lines = readLines();
+        REQUIRE(lines.size() == 2);
+        REQUIRE(lines[1] == "1000000 M105 7 3 97 -1 -1 -1");
+        for (int i=0; i<3; ++i) {
+            tracer.record(stamps, "G1", 8+i);
+        }
+    }
+    //anything still queued is written out when the tracer is destroyed
+    std::vector<std::string> lines = readLines();
+    REQUIRE(lines.size() == 5);
+    REQUIRE(lines[4] == "1000000 G1 10 3 97 -1 -1 -1");
+    remove(path);
+}
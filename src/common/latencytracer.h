@@ -0,0 +1,138 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef COMMON_LATENCYTRACER_H
+#define COMMON_LATENCYTRACER_H
+
+#include <array>
+#include <memory> //for unique_ptr
+#include <string>
+#include <cstdint>
+#include "platforms/auto/chronoclock.h" //for EventClockT
+
+/* 
+ * The times at which a single command passed through each stage of processing.
+ * A default-constructed time_point marks a stage the command hasn't (or won't) pass through.
+ */
+struct CommandTimestamps {
+    //the line (or binary record) was fully received by the Com channel
+    EventClockT::time_point received;
+    //State first attempted to execute it (it may be retried, e.g. while the motion planner is busy)
+    EventClockT::time_point dispatched;
+    //the move it describes was handed to the MotionPlanner (moves only)
+    EventClockT::time_point planned;
+    //it was replied to
+    EventClockT::time_point replied;
+    //the first step of its move was queued to the hardware scheduler (moves only)
+    EventClockT::time_point firstStep;
+    inline static bool isSet(const EventClockT::time_point &t) {
+        return t != EventClockT::time_point();
+    }
+};
+
+/* 
+ * Histogram of latencies, with power-of-two sized buckets so that adding a sample is cheap and never allocates.
+ * Bucket 0 counts latencies under 1 us, and bucket i counts those in [2^(i-1), 2^i) us.
+ */
+class LatencyHistogram {
+    public:
+        static const std::size_t NUM_BUCKETS = 32;
+    private:
+        std::array<uint32_t, NUM_BUCKETS> _buckets;
+        uint32_t _count;
+        uint32_t _maxUsec;
+    public:
+        LatencyHistogram();
+        void add(EventClockT::duration latency);
+        void clear();
+        inline uint32_t count() const {
+            return _count;
+        }
+        inline uint32_t maxUsec() const {
+            return _maxUsec;
+        }
+        inline uint32_t bucketCount(std::size_t bucket) const {
+            return _buckets[bucket];
+        }
+        //@return the (exclusive) upper bound of @bucket, in us
+        static inline uint32_t bucketLimitUsec(std::size_t bucket) {
+            return (uint32_t)1 << bucket;
+        }
+        //@return an upper bound for the @fraction quantile (e.g. 0.99 for p99), in us.
+        //  This is the limit of the bucket containing the quantile, but never more than the largest latency seen.
+        uint32_t quantileUsec(float fraction) const;
+};
+
+/* 
+ * LatencyTracer collects the time spent by commands in each stage between being received from the host and moving the motors,
+ * in order to tune buffering depth & host streaming strategies.
+ * The histograms are reported by M881, and each command can optionally be written to a trace file as well.
+ * Tracing a command only copies its line into a lock-free ring; a background (non real-time) thread writes the ring to the file
+ *   and flushes it, so the event loop never makes a syscall for it, and the trace survives the process being killed.
+ */
+class LatencyTracer {
+    public:
+        enum Stage {
+            //received -> dispatched: time spent queued behind earlier commands
+            STAGE_QUEUE,
+            //dispatched -> replied: time spent executing, including waits for the motion planner or heaters
+            STAGE_EXECUTE,
+            //dispatched -> planned (moves only)
+            STAGE_PLAN,
+            //planned -> first step queued (moves only)
+            STAGE_FIRST_STEP,
+            //received -> first step queued (moves only)
+            STAGE_TOTAL,
+            NUM_STAGES
+        };
+    private:
+        //owns the trace file, the ring of lines waiting to be written to it and the thread that writes them (see latencytracer.cpp)
+        class TraceWriter;
+        std::array<LatencyHistogram, NUM_STAGES> _histograms;
+        std::unique_ptr<TraceWriter> _traceWriter;
+    public:
+        LatencyTracer();
+        LatencyTracer(LatencyTracer &&other);
+        //writes out any lines still queued for the trace file before closing it
+        ~LatencyTracer();
+        //Write each command's timestamps to @path (one line per command).
+        //throws std::runtime_error if the file can't be opened.
+        void openTraceFile(const std::string &path);
+        //add the latencies of a command which has passed through all of its stages.
+        //@opcode and @lineNumber are only used to label the command in the trace file.
+        void record(const CommandTimestamps &stamps, const char *opcode, int32_t lineNumber);
+        inline const LatencyHistogram& histogram(Stage stage) const {
+            return _histograms[stage];
+        }
+        void clear();
+        //@return the short name used to label @stage in reports (e.g. "queue")
+        static const char* stageName(Stage stage);
+        //Write "<stage>:<count>/<p50>/<p99>/<max>" (in us) for every stage into @dest, which has room for @size characters.
+        //Returns the length of the full text, which may be >= @size if it was truncated (same semantics as snprintf).
+        std::size_t formatSummary(char *dest, std::size_t size) const;
+        //Write "<stage> <bucket limit (us)>:<count> ..." for each non-empty bucket of @stage into @dest.
+        //Same return semantics as formatSummary.
+        std::size_t formatHistogram(Stage stage, char *dest, std::size_t size) const;
+};
+
+#endif
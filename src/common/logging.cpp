@@ -23,6 +23,16 @@
 
 #include "logging.h"
 
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <cstdlib> //for atexit
+#if USE_PTHREAD
+    #include <pthread.h> //for pthread_setschedparam
+#endif
+#include "catch.hpp"
+
 namespace logging {
 
 #if DO_LOG == 1
@@ -33,4 +43,191 @@ bool _verbose = false;
 
 #endif
 
+namespace {
+    //number of messages that can be queued. Must be a power of 2.
+    const std::size_t RING_SIZE = 512;
+    const std::size_t RING_MASK = RING_SIZE - 1;
+    //how long the writer thread sleeps when there's nothing to write
+    const std::chrono::milliseconds WRITER_IDLE_SLEEP(2);
+
+    enum WriterState {
+        WRITER_NOT_STARTED,
+        WRITER_STARTING,
+        WRITER_RUNNING,
+        WRITER_STOPPING,
+        WRITER_STOPPED
+    };
+
+    //Bounded multi-producer/single-consumer ring (based on Dmitry Vyukov's bounded MPMC queue).
+    //Each slot's sequence number indicates whether it's free to be written (sequence == pos),
+    //  or holds a message ready to be read (sequence == pos+1).
+    //All of these are zero-initialized before any static constructors run, so logging is safe during static initialization.
+    LogMessage ring[RING_SIZE];
+    std::atomic<std::size_t> ringSequences[RING_SIZE];
+    std::atomic<std::size_t> enqueuePos;
+    std::size_t dequeuePos;
+    std::atomic<std::size_t> numDropped;
+    std::atomic<int> writerState;
+    std::thread *writerThread;
+
+    //format & write all queued messages. Must only be called from one thread at a time.
+    //returns the number of messages written.
+    std::size_t drain() {
+        char buffer[1024];
+        std::size_t numWritten = 0;
+        FILE *lastFile = nullptr;
+        while (true) {
+            std::size_t slot = dequeuePos & RING_MASK;
+            if (ringSequences[slot].load(std::memory_order_acquire) != dequeuePos+1) {
+                break; //no more messages ready
+            }
+            const LogMessage &msg = ring[slot];
+            msg.formatInto(buffer, sizeof(buffer));
+            fputs(buffer, msg.file);
+            if (lastFile && lastFile != msg.file) {
+                //keep ordering between stdout & stderr sensible
+                fflush(lastFile);
+            }
+            lastFile = msg.file;
+            //release the slot for the producer that's one lap ahead
+            ringSequences[slot].store(dequeuePos + RING_SIZE, std::memory_order_release);
+            ++dequeuePos;
+            ++numWritten;
+        }
+        if (std::size_t dropped = numDropped.exchange(0)) {
+            fprintf(stdout, "[WARN] logging: %zu messages were dropped because the log buffer was full\n", dropped);
+        }
+        if (numWritten) {
+            fflush(stdout);
+            fflush(stderr);
+        }
+        return numWritten;
+    }
+
+    void writerLoop() {
+        #if USE_PTHREAD
+            //the writer may have been started from a real-time thread; it must never compete with it.
+            struct sched_param sp;
+            sp.sched_priority = 0;
+            pthread_setschedparam(pthread_self(), SCHED_OTHER, &sp);
+        #endif
+        while (writerState.load() == WRITER_RUNNING) {
+            if (!drain()) {
+                std::this_thread::sleep_for(WRITER_IDLE_SLEEP);
+            }
+        }
+        drain();
+    }
+
+    void stopWriter() {
+        int expected = WRITER_RUNNING;
+        if (!writerState.compare_exchange_strong(expected, WRITER_STOPPING)) {
+            return;
+        }
+        if (writerThread->get_id() == std::this_thread::get_id()) {
+            //exit() was called from the writer thread (e.g. by a signal handler); it can't join itself.
+            writerThread->detach();
+            drain();
+        } else {
+            writerThread->join();
+        }
+        writerState.store(WRITER_STOPPED);
+    }
+
+    void startWriter() {
+        int expected = WRITER_NOT_STARTED;
+        if (!writerState.compare_exchange_strong(expected, WRITER_STARTING)) {
+            return;
+        }
+        for (std::size_t i=0; i<RING_SIZE; ++i) {
+            ringSequences[i].store(i, std::memory_order_relaxed);
+        }
+        enqueuePos.store(0);
+        dequeuePos = 0;
+        writerState.store(WRITER_RUNNING);
+        writerThread = new std::thread(writerLoop);
+        //write out everything that's queued upon exit. Exit handlers registered earlier run after this, and will log synchronously.
+        std::atexit(stopWriter);
+    }
+}
+
+LogMessage* reserveMessage(bool *isRunning) {
+    int state = writerState.load(std::memory_order_acquire);
+    if (state == WRITER_NOT_STARTED) {
+        //lazily start the writer on the first log message
+        startWriter();
+        state = writerState.load(std::memory_order_acquire);
+    }
+    *isRunning = (state == WRITER_RUNNING);
+    if (!*isRunning) {
+        return nullptr;
+    }
+    std::size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+        std::size_t seq = ringSequences[pos & RING_MASK].load(std::memory_order_acquire);
+        std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+        if (diff == 0) {
+            //slot is free; try to claim it
+            if (enqueuePos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+                LogMessage *msg = &ring[pos & RING_MASK];
+                msg->ringPos = pos;
+                return msg;
+            }
+        } else if (diff < 0) {
+            //ring is full; drop the message rather than wait.
+            ++numDropped;
+            return nullptr;
+        } else {
+            //another producer claimed this slot first
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void commitMessage(LogMessage *msg) {
+    ringSequences[msg->ringPos & RING_MASK].store(msg->ringPos+1, std::memory_order_release);
+}
+
+void flush() {
+    if (writerState.load() != WRITER_RUNNING) {
+        return;
+    }
+    //wait for the writer to catch up with everything that's been queued so far
+    std::size_t target = enqueuePos.load();
+    while (true) {
+        std::size_t slot = (target-1) & RING_MASK;
+        std::size_t seq = ringSequences[slot].load(std::memory_order_acquire);
+        if (target == 0 || seq >= target-1 + RING_SIZE) {
+            break;
+        }
+        std::this_thread::sleep_for(WRITER_IDLE_SLEEP);
+    }
+    //the writer releases a slot once the message is in stdio's buffer, but may not have flushed that yet
+    fflush(stdout);
+    fflush(stderr);
+}
+
+TEST_CASE("Log messages are packed and formatted correctly", "[logging]") {
+    LogMessage msg;
+    const char *format = "%s %i %f %c %s";
+    _LogArgs<const char*, int, float, char, const char*>::pack(msg.payload, msg.payload + LOG_PAYLOAD_SIZE, "hello", -3, 2.5f, 'x', "world");
+    msg.format = format;
+    msg.formatter = &_formatPacked<const char*, int, float, char, const char*>;
+    char buffer[256];
+    msg.formatInto(buffer, sizeof(buffer));
+    REQUIRE(std::string(buffer) == "hello -3 2.500000 x world");
+
+    SECTION("Strings that don't fit are truncated, without affecting the other arguments") {
+        std::string longStr(LOG_PAYLOAD_SIZE*2, 'a');
+        _LogArgs<const char*, int>::pack(msg.payload, msg.payload + LOG_PAYLOAD_SIZE, longStr.c_str(), 42);
+        msg.format = "%s %i";
+        msg.formatter = &_formatPacked<const char*, int>;
+        char bigBuffer[LOG_PAYLOAD_SIZE*3];
+        msg.formatInto(bigBuffer, sizeof(bigBuffer));
+        std::string result(bigBuffer);
+        REQUIRE(result.size() < longStr.size());
+        REQUIRE(result.substr(result.size()-3) == " 42");
+    }
+}
+
 }
@@ -26,6 +26,9 @@
 
 #include <stdio.h>
 #include <inttypes.h> //allow use of PRId64 by other files that make use of logging
+#include <cstring> //for memcpy, strlen
+#include <algorithm> //for std::min
+#include <type_traits> //for std::is_arithmetic, etc
 #include "compileflags.h"
 
 //64-bit printf specifier
@@ -33,24 +36,42 @@
     #define PRId64 "lld"
 #endif
 
+//Expands to nothing at runtime (the arguments aren't evaluated), but still has the compiler verify the format string
+//  and consider the arguments used.
+#define _NO_LOG(format, args...) \
+    do { \
+        if (false) { \
+            printf(format, ## args); \
+        } \
+    } while (0)
+
 #if DO_LOG
     //NOTE: these logging functions must be implemented as macros, instead of templated functions
     // in order to get format verification at compile time.
+    //The message itself is formatted & written by a background thread (see logging::log), so that logging never blocks the caller.
     #define _LOG(tag, enableFunc, outputFile, format, args...) \
         if (enableFunc()) { \
-            fprintf(outputFile, "[" tag "] " format, ## args); \
+            _NO_LOG(format, ## args); \
+            logging::log(outputFile, "[" tag "] " format, ## args); \
         }
 #else
-    #include <tuple>
-    //make a tuple with the arguments and make it as (void) to avoid unused variable warnings.
-    #define _LOG(args...) do { (void)std::make_tuple(##args); } while(0);
+    #define _LOG(tag, enableFunc, outputFile, format, args...) _NO_LOG(format, ## args)
 #endif
 
 #define LOGE(format, args...) _LOG("ERR ",   logging::isInfoEnabled,    stderr, format, ##args)
 #define LOGW(format, args...) _LOG("WARN",    logging::isInfoEnabled,    stdout, format, ##args)
 #define LOG(format, args...)  _LOG("INFO",    logging::isInfoEnabled,    stdout, format, ##args)
-#define LOGD(format, args...) _LOG("DBG ",   logging::isDebugEnabled,   stdout, format, ##args)
-#define LOGV(format, args...) _LOG("VERB", logging::isVerboseEnabled, stdout, format, ##args)
+//Debug & verbose logging can be compiled out entirely by raising MIN_LOG_LEVEL (release builds do this by default)
+#if MIN_LOG_LEVEL <= 1
+    #define LOGD(format, args...) _LOG("DBG ",   logging::isDebugEnabled,   stdout, format, ##args)
+#else
+    #define LOGD(format, args...) _NO_LOG(format, ##args)
+#endif
+#if MIN_LOG_LEVEL <= 0
+    #define LOGV(format, args...) _LOG("VERB", logging::isVerboseEnabled, stdout, format, ##args)
+#else
+    #define LOGV(format, args...) _NO_LOG(format, ##args)
+#endif
 
 
 #define _UNIQUE_NAME_LINE2( name, line ) name##line
@@ -77,10 +98,126 @@
  * This provides some functions that allow for logging information to stdout.
  * Use LOG for information logging, LOGE to log an error, LOGW for warnings, LOGD for debug logging, and LOGV for verbose debug logging.
  * LOG, LOGE, etc are not a part of the logging namespace because they are implemented as macros
+ *
+ * Messages are not formatted by the caller. Instead, the format string pointer and the raw arguments are copied into 
+ *   a preallocated, lock-free ring buffer, and a background thread formats and writes them out.
+ * If the ring is full, the message is dropped (and the drop is reported later) rather than making the caller wait.
+ * String arguments are copied at the time of the call, so it's safe to log temporaries (e.g. std::string::c_str()).
  */
 
 namespace logging {
 
+    //Room for the (packed) arguments of one log message. Strings that don't fit are truncated.
+    const std::size_t LOG_PAYLOAD_SIZE = 240;
+
+    //Describes how to copy a single log argument into a message payload, and how to read it back out.
+    //Numbers, enums & (non-string) pointers are copied bitwise.
+    template <typename T> struct LogArg {
+        static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value, 
+            "Log arguments must be numbers, pointers or C strings");
+        //number of bytes that must be reserved in the payload for this argument
+        static const std::size_t FIXED_SIZE = sizeof(T);
+        static char* pack(char *dest, const char *end, T value) {
+            (void)end; //room is reserved via FIXED_SIZE
+            memcpy(dest, &value, sizeof(T));
+            return dest + sizeof(T);
+        }
+        static T unpack(const char *&src) {
+            T value;
+            memcpy(&value, src, sizeof(T));
+            src += sizeof(T);
+            return value;
+        }
+    };
+    //C strings are copied into the payload (including the null terminator), and read back as a pointer into the payload
+    template <> struct LogArg<const char*> {
+        static const std::size_t FIXED_SIZE = 1;
+        static char* pack(char *dest, const char *end, const char *value) {
+            if (value == nullptr) {
+                value = "(null)";
+            }
+            std::size_t len = std::min(strlen(value), (std::size_t)(end-dest-1));
+            memcpy(dest, value, len);
+            dest[len] = '\0';
+            return dest + len + 1;
+        }
+        static const char* unpack(const char *&src) {
+            const char *value = src;
+            src += strlen(src) + 1;
+            return value;
+        }
+    };
+    template <> struct LogArg<char*> : public LogArg<const char*> {};
+
+    template <typename ...Args> struct _LogArgs;
+    template <> struct _LogArgs<> {
+        static const std::size_t FIXED_SIZE = 0;
+        static void pack(char *dest, const char *end) {
+            (void)dest; (void)end;
+        }
+        template <typename ...Unpacked> static int format(char *dest, std::size_t size, const char *format, const char *src, Unpacked ...unpacked) {
+            (void)src;
+            return snprintf(dest, size, format, unpacked...);
+        }
+    };
+    template <typename T, typename ...Rest> struct _LogArgs<T, Rest...> {
+        static const std::size_t FIXED_SIZE = LogArg<T>::FIXED_SIZE + _LogArgs<Rest...>::FIXED_SIZE;
+        static void pack(char *dest, const char *end, T first, Rest ...rest) {
+            //leave room for the arguments that follow
+            dest = LogArg<T>::pack(dest, end - _LogArgs<Rest...>::FIXED_SIZE, first);
+            _LogArgs<Rest...>::pack(dest, end, rest...);
+        }
+        template <typename ...Unpacked> static int format(char *dest, std::size_t size, const char *format, const char *src, Unpacked ...unpacked) {
+            //unpack in a separate statement to guarantee the arguments are read in order
+            auto value = LogArg<T>::unpack(src);
+            return _LogArgs<Rest...>::format(dest, size, format, src, unpacked..., value);
+        }
+    };
+
+    //Signature of the function that formats a packed message (instantiated for each distinct list of argument types)
+    typedef int (*LogFormatter)(char *dest, std::size_t size, const char *format, const char *payload);
+    template <typename ...Args> int _formatPacked(char *dest, std::size_t size, const char *format, const char *payload) {
+        return _LogArgs<Args...>::format(dest, size, format, payload);
+    }
+
+    //A message waiting to be written by the background logging thread.
+    struct LogMessage {
+        FILE *file;
+        const char *format;
+        LogFormatter formatter;
+        char payload[LOG_PAYLOAD_SIZE];
+        //position in the ring; used by commitMessage
+        std::size_t ringPos;
+        inline int formatInto(char *dest, std::size_t size) const {
+            return formatter(dest, size, format, payload);
+        }
+    };
+
+    //Reserve a slot in the ring for a new message; returns nullptr if the background writer isn't running (log synchronously instead)
+    //  or if the ring is full (the message is dropped).
+    //Every non-null slot must be handed back via commitMessage once it's filled in.
+    LogMessage* reserveMessage(bool *isRunning);
+    void commitMessage(LogMessage *msg);
+    //write out all queued messages (blocks until they're written & flushed). Useful before a deliberate crash,
+    //  or before writing directly to stdout/stderr's file descriptors.
+    void flush();
+
+    template <typename ...Args> void log(FILE *file, const char *format, Args ...args) {
+        static_assert(_LogArgs<Args...>::FIXED_SIZE <= LOG_PAYLOAD_SIZE, "Too many log arguments");
+        bool isRunning;
+        LogMessage *msg = reserveMessage(&isRunning);
+        if (msg) {
+            msg->file = file;
+            msg->format = format;
+            msg->formatter = &_formatPacked<Args...>;
+            _LogArgs<Args...>::pack(msg->payload, msg->payload + LOG_PAYLOAD_SIZE, args...);
+            commitMessage(msg);
+        } else if (!isRunning) {
+            //before the writer is started or after it's been shut down (i.e. exit handlers), log synchronously
+            fprintf(file, format, args...);
+        }
+    }
+
 #if DO_LOG == 1
 
     extern bool _info;
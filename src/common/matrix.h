@@ -32,18 +32,19 @@
  * Notably, they can be used to adjust coordinates to a different coordinate-space in order to account for an unlevel bed.
  */
 class Matrix3x3 {
-    //r0, r1, r2 each represent one row of the matrix.
-    Vector3f r0, r1, r2;
+    //c0, c1, c2 each represent one column of the matrix.
+    //  Storing columns lets transform() be 3 vector multiply-adds rather than 3 dot products (which need horizontal adds).
+    Vector3f c0, c1, c2;
     public:
-        Matrix3x3() : r0(), r1(), r2() {}
+        Matrix3x3() : c0(), c1(), c2() {}
         Matrix3x3(float a00, float a01, float a02,
                 float a10, float a11, float a12,
                 float a20, float a21, float a22) :
-            r0(a00, a01, a02),
-            r1(a10, a11, a12),
-            r2(a20, a21, a22) {}
+            c0(a00, a10, a20),
+            c1(a01, a11, a21),
+            c2(a02, a12, a22) {}
         template <typename VecT> VecT transform(const VecT &xyz) const {
-            return VecT(r0.dot(xyz), r1.dot(xyz), r2.dot(xyz));
+            return VecT(c0*xyz.x() + c1*xyz.y() + c2*xyz.z());
         }
 
         static inline Matrix3x3 identity() {
@@ -0,0 +1,81 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "simd.h"
+#include "vector4.h"
+#include "matrix.h"
+#include "catch.hpp"
+
+TEST_CASE("simd::Lanes4<float> matches the scalar implementation", "[simd]") {
+    typedef simd::Lanes4<float>::type Lanes;
+    typedef simd::ScalarLanes4<float> Scalar;
+    //compare each lane of the selected backend against the scalar reference
+    auto REQUIRE_LANES_EQ = [](const Lanes &a, const Scalar &b) {
+        for (std::size_t i=0; i<4; ++i) {
+            REQUIRE(a[i] == Approx(b[i]));
+        }
+    };
+    const float in[][4] = { {2.f, -3.f, 1.5f, 7.f}, {-1.5f, 1.5f, 0.5f, -2.f}, {1e3f, 2e-3f, -4e2f, 0.f}, {0.f, 0.f, 0.f, 0.f} };
+    for (const float *a : in) {
+        for (const float *b : in) {
+            Lanes la(a[0], a[1], a[2], a[3]), lb(b[0], b[1], b[2], b[3]);
+            Scalar sa(a[0], a[1], a[2], a[3]), sb(b[0], b[1], b[2], b[3]);
+            REQUIRE_LANES_EQ(la + lb, sa + sb);
+            REQUIRE_LANES_EQ(la - lb, sa - sb);
+            REQUIRE_LANES_EQ(-la, -sa);
+            REQUIRE_LANES_EQ(la * lb, sa * sb);
+            REQUIRE_LANES_EQ(la * b[1], sa * b[1]);
+            REQUIRE_LANES_EQ(la.cross3(lb), sa.cross3(sb));
+            REQUIRE(la.dot3(lb) == Approx(sa.dot3(sb)));
+        }
+    }
+    REQUIRE_LANES_EQ(Lanes::splat(3.5f), Scalar::splat(3.5f));
+    REQUIRE_LANES_EQ(Lanes(), Scalar());
+}
+
+TEST_CASE("Vector4f and Matrix3x3 math operations are accurate", "[simd]") {
+    SECTION("Vector4f operations act on all 4 components") {
+        Vector4f v = Vector4f(2, -3, 1.5, 4) + Vector4f(-1.5, 1.5, 0.5, 1)*2 - Vector4f(Vector3f(1, 1, 1), 1.f);
+        REQUIRE(v.x() == Approx(-2));
+        REQUIRE(v.y() == Approx(-1));
+        REQUIRE(v.z() == Approx(1.5));
+        REQUIRE(v.e() == Approx(5));
+        REQUIRE((-v/2).e() == Approx(-2.5));
+        //the e component must not leak into xyz math
+        REQUIRE(v.xyz().magSq() == Approx(7.25));
+        REQUIRE(v.xyz().cross(Vector3f(0, 0, 1)).mag() == Approx(std::sqrt(5.f)));
+    }
+    SECTION("Matrix3x3 transforms vectors") {
+        Matrix3x3 m(1, 2, 3,
+                    4, 5, 6,
+                    7, 8, 10);
+        Vector3f t = m.transform(Vector3f(1, -1, 2));
+        REQUIRE(t.x() == Approx(5));
+        REQUIRE(t.y() == Approx(11));
+        REQUIRE(t.z() == Approx(19));
+        Vector3f r = Matrix3x3::rotationAboutPositiveZ(M_PI/2).transform(Vector3f(1, 0, 3));
+        REQUIRE(std::fabs(r.x()) < 1e-6);
+        REQUIRE(r.y() == Approx(1));
+        REQUIRE(r.z() == Approx(3));
+    }
+}
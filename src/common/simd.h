@@ -0,0 +1,195 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef COMMON_SIMD_H
+#define COMMON_SIMD_H
+
+#include <cstddef> //for std::size_t
+#include "compileflags.h" //for USE_SIMD
+
+//Pick a SIMD backend for 4 lanes of floats based on what the compiler is targeting.
+//  x86 gets SSE2 (always available on x86-64). ARM gets NEON only when building with e.g. -mfpu=neon (Raspberry Pi 2 and later);
+//  the original Pi has no NEON, and so uses the scalar implementation.
+#if USE_SIMD && defined(__SSE2__)
+    #include <emmintrin.h>
+    #define SIMD_BACKEND_SSE 1
+#elif USE_SIMD && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+    #include <arm_neon.h>
+    #define SIMD_BACKEND_NEON 1
+#endif
+
+/* 
+ * Lanes4 types hold 4 numbers that are operated on together, and are the storage behind Vector3 & Vector4.
+ * Vector3 only uses the first 3 lanes, and Vector4 keeps its e component in the 4th.
+ *
+ * simd::Lanes4<F>::type selects the implementation: simd::Float4 for floats if the target has SIMD instructions,
+ *   otherwise simd::ScalarLanes4<F>, which does the same operations one lane at a time.
+ */
+namespace simd {
+
+template <typename F> class ScalarLanes4 {
+    F _v[4];
+    public:
+        //initialize all lanes to 0
+        ScalarLanes4() : _v{0, 0, 0, 0} {}
+        ScalarLanes4(F a, F b, F c, F d) : _v{a, b, c, d} {}
+        static ScalarLanes4 splat(F s) {
+            return ScalarLanes4(s, s, s, s);
+        }
+        F operator[](std::size_t idx) const {
+            return _v[idx];
+        }
+        ScalarLanes4 operator+(const ScalarLanes4 &o) const {
+            return ScalarLanes4(_v[0]+o._v[0], _v[1]+o._v[1], _v[2]+o._v[2], _v[3]+o._v[3]);
+        }
+        ScalarLanes4 operator-(const ScalarLanes4 &o) const {
+            return ScalarLanes4(_v[0]-o._v[0], _v[1]-o._v[1], _v[2]-o._v[2], _v[3]-o._v[3]);
+        }
+        ScalarLanes4 operator-() const {
+            return ScalarLanes4(-_v[0], -_v[1], -_v[2], -_v[3]);
+        }
+        //lane-wise multiplication
+        ScalarLanes4 operator*(const ScalarLanes4 &o) const {
+            return ScalarLanes4(_v[0]*o._v[0], _v[1]*o._v[1], _v[2]*o._v[2], _v[3]*o._v[3]);
+        }
+        ScalarLanes4 operator*(F s) const {
+            return ScalarLanes4(s*_v[0], s*_v[1], s*_v[2], s*_v[3]);
+        }
+        //dot product of the first 3 lanes
+        F dot3(const ScalarLanes4 &o) const {
+            return _v[0]*o._v[0] + _v[1]*o._v[1] + _v[2]*o._v[2];
+        }
+        //cross product of the first 3 lanes. The 4th lane of the result is 0.
+        ScalarLanes4 cross3(const ScalarLanes4 &o) const {
+            return ScalarLanes4(_v[1]*o._v[2] - _v[2]*o._v[1], _v[2]*o._v[0] - _v[0]*o._v[2], _v[0]*o._v[1] - _v[1]*o._v[0], 0);
+        }
+};
+
+#if SIMD_BACKEND_SSE || SIMD_BACKEND_NEON
+//4 floats, operated on with SSE2 or NEON instructions.
+//The storage is 16-byte aligned, but is accessed with unaligned loads & stores, 
+//  since C++11 operator new doesn't honor over-alignment (and 32-bit ARM malloc only guarantees 8 bytes).
+class Float4 {
+    #if SIMD_BACKEND_SSE
+        typedef __m128 NativeT;
+        static inline NativeT load(const float *v) { return _mm_loadu_ps(v); }
+        static inline void store(float *dest, NativeT v) { _mm_storeu_ps(dest, v); }
+    #else
+        typedef float32x4_t NativeT;
+        static inline NativeT load(const float *v) { return vld1q_f32(v); }
+        static inline void store(float *dest, NativeT v) { vst1q_f32(dest, v); }
+    #endif
+    alignas(16) float _v[4];
+    explicit Float4(NativeT v) {
+        store(_v, v);
+    }
+    inline NativeT native() const {
+        return load(_v);
+    }
+    public:
+        //initialize all lanes to 0
+        Float4() : _v{0, 0, 0, 0} {}
+        Float4(float a, float b, float c, float d) : _v{a, b, c, d} {}
+        #if SIMD_BACKEND_SSE
+            static Float4 splat(float s) {
+                return Float4(_mm_set1_ps(s));
+            }
+            Float4 operator+(const Float4 &o) const {
+                return Float4(_mm_add_ps(native(), o.native()));
+            }
+            Float4 operator-(const Float4 &o) const {
+                return Float4(_mm_sub_ps(native(), o.native()));
+            }
+            Float4 operator-() const {
+                //flip the sign bits, so that -0 and NaN behave as with scalar negation
+                return Float4(_mm_xor_ps(native(), _mm_set1_ps(-0.f)));
+            }
+            Float4 operator*(const Float4 &o) const {
+                return Float4(_mm_mul_ps(native(), o.native()));
+            }
+            Float4 operator*(float s) const {
+                return Float4(_mm_mul_ps(native(), _mm_set1_ps(s)));
+            }
+            float dot3(const Float4 &o) const {
+                NativeT m = _mm_mul_ps(native(), o.native());
+                NativeT y = _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1));
+                NativeT z = _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 2, 2, 2));
+                return _mm_cvtss_f32(_mm_add_ss(_mm_add_ss(m, y), z));
+            }
+            Float4 cross3(const Float4 &o) const {
+                //a x b = (a * b.yzx - a.yzx * b).yzx
+                NativeT a = native(), b = o.native();
+                NativeT aYzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+                NativeT bYzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+                NativeT c = _mm_sub_ps(_mm_mul_ps(a, bYzx), _mm_mul_ps(aYzx, b));
+                c = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+                //clear the 4th lane, which may hold inf-inf (NaN) if the inputs' 4th lanes were infinite
+                return Float4(_mm_and_ps(c, _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1))));
+            }
+        #else
+            static Float4 splat(float s) {
+                return Float4(vdupq_n_f32(s));
+            }
+            Float4 operator+(const Float4 &o) const {
+                return Float4(vaddq_f32(native(), o.native()));
+            }
+            Float4 operator-(const Float4 &o) const {
+                return Float4(vsubq_f32(native(), o.native()));
+            }
+            Float4 operator-() const {
+                return Float4(vnegq_f32(native()));
+            }
+            Float4 operator*(const Float4 &o) const {
+                return Float4(vmulq_f32(native(), o.native()));
+            }
+            Float4 operator*(float s) const {
+                return Float4(vmulq_n_f32(native(), s));
+            }
+            float dot3(const Float4 &o) const {
+                float32x4_t m = vmulq_f32(native(), o.native());
+                float32x2_t xy = vget_low_f32(m);
+                return vget_lane_f32(vpadd_f32(xy, xy), 0) + vgetq_lane_f32(m, 2);
+            }
+            Float4 cross3(const Float4 &o) const {
+                //NEON has no general lane shuffle, and rotating just 3 of the 4 lanes costs more than it saves.
+                return Float4(_v[1]*o._v[2] - _v[2]*o._v[1], _v[2]*o._v[0] - _v[0]*o._v[2], _v[0]*o._v[1] - _v[1]*o._v[0], 0);
+            }
+        #endif
+        float operator[](std::size_t idx) const {
+            return _v[idx];
+        }
+};
+#endif
+
+template <typename F> struct Lanes4 {
+    typedef ScalarLanes4<F> type;
+};
+#if SIMD_BACKEND_SSE || SIMD_BACKEND_NEON
+template <> struct Lanes4<float> {
+    typedef Float4 type;
+};
+#endif
+
+}
+
+#endif
@@ -0,0 +1,148 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "statuspublisher.h"
+
+#include <stdexcept> //for runtime_error
+#include <cstring> //for strerror
+#include <cerrno>
+#include <ctime> //for clock_gettime
+#include <sys/mman.h> //for shm_open, mmap
+#include <fcntl.h> //for O_* constants
+#include <unistd.h> //for ftruncate, close
+#include <sys/stat.h> //for fstat
+#include "common/logging.h"
+#include "catch.hpp"
+
+//mark the segment @name (if any) as stale, so that readers that have it mapped notice once it's replaced or removed
+static void markStale(const std::string &name) {
+    int fd = shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+    if (fd == -1) {
+        return;
+    }
+    struct stat st;
+    //a truncated segment can't be mapped (accessing it would raise SIGBUS), but nor can it be read
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(struct printipi_status)) {
+        void *mem = mmap(nullptr, sizeof(struct printipi_status), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mem != MAP_FAILED) {
+            __atomic_store_n(&static_cast<struct printipi_status*>(mem)->version, PRINTIPI_STATUS_STALE, __ATOMIC_RELEASE);
+            munmap(mem, sizeof(struct printipi_status));
+        }
+    }
+    close(fd);
+}
+
+StatusPublisher::StatusPublisher(const std::string &name) : _name(name), _fd(-1), _status(nullptr) {
+    //replace any segment left over from a previous run (e.g. one that was killed before it could remove it)
+    markStale(name);
+    shm_unlink(name.c_str());
+    _fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (_fd == -1) {
+        throw std::runtime_error("Unable to create shared memory object " + name + ": " + strerror(errno));
+    }
+    void *mem = MAP_FAILED;
+    if (ftruncate(_fd, sizeof(struct printipi_status)) == 0) {
+        mem = mmap(nullptr, sizeof(struct printipi_status), PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    }
+    if (mem == MAP_FAILED) {
+        int err = errno;
+        close(_fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Unable to map shared memory object " + name + ": " + strerror(err));
+    }
+    //the new segment is zero-filled, so sequence starts at 0 (consistent)
+    _status = static_cast<struct printipi_status*>(mem);
+    _status->version = PRINTIPI_STATUS_VERSION;
+    _status->size = sizeof(struct printipi_status);
+}
+
+StatusPublisher::~StatusPublisher() {
+    __atomic_store_n(&_status->version, PRINTIPI_STATUS_STALE, __ATOMIC_RELEASE);
+    munmap(_status, sizeof(struct printipi_status));
+    close(_fd);
+    shm_unlink(_name.c_str());
+}
+
+struct printipi_status& StatusPublisher::beginUpdate() {
+    printipi_status_begin_write(_status);
+    return *_status;
+}
+
+void StatusPublisher::endUpdate() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    _status->timestamp_usec = (int64_t)now.tv_sec*1000000 + now.tv_nsec/1000;
+    ++_status->update_count;
+    printipi_status_end_write(_status);
+}
+
+TEST_CASE("StatusPublisher shares a consistent snapshot", "[statuspublisher]") {
+    StatusPublisher publisher("/printipi-status-test");
+    //map the segment separately, as a reader would
+    int fd = shm_open("/printipi-status-test", O_RDONLY, 0);
+    REQUIRE(fd != -1);
+    void *mem = mmap(nullptr, sizeof(struct printipi_status), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    REQUIRE(mem != MAP_FAILED);
+    const struct printipi_status *shared = static_cast<const struct printipi_status*>(mem);
+    struct printipi_status copy;
+
+    REQUIRE(shared->version == PRINTIPI_STATUS_VERSION);
+    REQUIRE(shared->size == sizeof(struct printipi_status));
+    SECTION("Completed updates are visible") {
+        struct printipi_status &status = publisher.beginUpdate();
+        status.position[2] = 12.5f;
+        status.line_number = 42;
+        publisher.endUpdate();
+        REQUIRE(printipi_status_read(shared, &copy, 1) == 0);
+        REQUIRE(copy.position[2] == 12.5f);
+        REQUIRE(copy.line_number == 42);
+        REQUIRE(copy.update_count == 1);
+    }
+    SECTION("Reads fail while an update is in progress") {
+        publisher.beginUpdate().line_number = 7;
+        REQUIRE(printipi_status_read(shared, &copy, 3) == -1);
+        publisher.endUpdate();
+        REQUIRE(printipi_status_read(shared, &copy, 1) == 0);
+        REQUIRE(copy.line_number == 7);
+    }
+    SECTION("Readers of a replaced segment see that it's stale") {
+        StatusPublisher replacement("/printipi-status-test");
+        REQUIRE(shared->version == PRINTIPI_STATUS_STALE);
+    }
+    munmap(mem, sizeof(struct printipi_status));
+}
+
+TEST_CASE("StatusPublisher marks its segment stale once destroyed", "[statuspublisher]") {
+    void *mem;
+    {
+        StatusPublisher publisher("/printipi-status-test");
+        int fd = shm_open("/printipi-status-test", O_RDONLY, 0);
+        REQUIRE(fd != -1);
+        mem = mmap(nullptr, sizeof(struct printipi_status), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        REQUIRE(mem != MAP_FAILED);
+    }
+    REQUIRE(static_cast<const struct printipi_status*>(mem)->version == PRINTIPI_STATUS_STALE);
+    munmap(mem, sizeof(struct printipi_status));
+}
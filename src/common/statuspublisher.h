@@ -0,0 +1,56 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef COMMON_STATUSPUBLISHER_H
+#define COMMON_STATUSPUBLISHER_H
+
+#include <string>
+#include "statussnapshot.h"
+
+/* 
+ * StatusPublisher owns a POSIX shared memory segment holding a printipi_status (see statussnapshot.h).
+ * State fills it periodically, and any number of monitoring processes may read it without involving the firmware.
+ */
+class StatusPublisher {
+    std::string _name;
+    int _fd;
+    struct printipi_status *_status;
+    public:
+        //Create (or replace) the shared memory object @name, e.g. "/printipi-status".
+        //throws std::runtime_error on failure.
+        StatusPublisher(const std::string &name=PRINTIPI_STATUS_DEFAULT_NAME);
+        //unmap & remove the shared memory object
+        ~StatusPublisher();
+        StatusPublisher(const StatusPublisher &) = delete;
+        StatusPublisher& operator=(const StatusPublisher &) = delete;
+
+        inline const std::string& name() const {
+            return _name;
+        }
+        //@return the snapshot, to be modified in place.
+        //Readers retry until endUpdate() is called, rather than see a partially written snapshot.
+        struct printipi_status& beginUpdate();
+        void endUpdate();
+};
+
+#endif
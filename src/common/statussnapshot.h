@@ -0,0 +1,132 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Layout of the status snapshot that Printipi publishes in POSIX shared memory (see StatusPublisher).
+ * Monitoring tools can map the segment read-only and poll it as often as they like,
+ *   rather than sending M105/M114/M119 through the printer's command channel.
+ *
+ * This header is plain C, so that readers needn't be built with the firmware; util/printipi-status.c is an example.
+ *
+ * The snapshot is guarded by a seqlock: the firmware makes `sequence` odd while it writes,
+ *   and even again once done. Use printipi_status_read() to take a consistent copy.
+ *
+ * A mapping stays valid after the firmware exits (or after a newer instance replaces the segment),
+ *   so the firmware sets `version` to PRINTIPI_STATUS_STALE once it abandons a segment; readers should then re-open it by name.
+ * If the firmware is killed outright, nothing can mark the segment; readers can detect this from `update_count` no longer advancing.
+ */
+
+#ifndef COMMON_STATUSSNAPSHOT_H
+#define COMMON_STATUSSNAPSHOT_H
+
+#include <stdint.h>
+#include <string.h> /* for memcpy */
+
+/* default shared memory object name (i.e. /dev/shm/printipi-status) */
+#define PRINTIPI_STATUS_DEFAULT_NAME "/printipi-status"
+/* incremented whenever the layout of struct printipi_status changes */
+#define PRINTIPI_STATUS_VERSION 1
+/* value of `version` in a segment that's no longer being updated */
+#define PRINTIPI_STATUS_STALE 0
+
+#define PRINTIPI_STATUS_MAX_AXES 8
+#define PRINTIPI_STATUS_MAX_HEATERS 4
+#define PRINTIPI_STATUS_MAX_FANS 4
+#define PRINTIPI_STATUS_MAX_ENDSTOPS 8
+
+#define PRINTIPI_STATUS_HEATER_HOTEND 0
+#define PRINTIPI_STATUS_HEATER_BED 1
+
+struct printipi_status_heater {
+    float target_c;
+    float measured_c;
+    uint32_t type; /* PRINTIPI_STATUS_HEATER_HOTEND or _BED */
+};
+
+struct printipi_status {
+    /* set when the segment is created, and to PRINTIPI_STATUS_STALE once it's abandoned */
+    uint32_t version; /* PRINTIPI_STATUS_VERSION */
+    uint32_t size; /* sizeof(struct printipi_status) */
+    /* seqlock counter; odd while an update is in progress */
+    uint32_t sequence;
+    /* number of updates published so far */
+    uint32_t update_count;
+    /* when the snapshot was taken, in microseconds of CLOCK_MONOTONIC */
+    int64_t timestamp_usec;
+
+    /* cartesian position of the effector (mm), as of the last step queued */
+    float position[4]; /* x, y, z, e */
+    uint32_t num_axes;
+    int32_t axis_steps[PRINTIPI_STATUS_MAX_AXES]; /* mechanical position of each axis, in steps */
+
+    uint32_t num_heaters;
+    struct printipi_status_heater heaters[PRINTIPI_STATUS_MAX_HEATERS];
+    uint32_t num_fans;
+    float fan_duty[PRINTIPI_STATUS_MAX_FANS]; /* 0.0 - 1.0 */
+    uint32_t num_endstops;
+    uint8_t endstop_triggered[PRINTIPI_STATUS_MAX_ENDSTOPS];
+
+    uint8_t is_moving;
+    uint8_t is_homed;
+    uint8_t reserved[2];
+    /* commands received from the host but not yet replied to */
+    uint32_t pending_commands;
+    /* free slots in the motion planner */
+    uint32_t free_planner_slots;
+    /* number of gcode files being read (the host channel plus any nested M32 files) */
+    uint32_t num_com_channels;
+    /* line number of the last numbered line accepted from the host */
+    int32_t line_number;
+};
+
+/* firmware side: bracket every modification of @s with these */
+static inline void printipi_status_begin_write(struct printipi_status *s) {
+    __atomic_store_n(&s->sequence, s->sequence + 1, __ATOMIC_RELAXED);
+    /* make the odd sequence visible before any of the data stores */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+static inline void printipi_status_end_write(struct printipi_status *s) {
+    __atomic_store_n(&s->sequence, s->sequence + 1, __ATOMIC_RELEASE);
+}
+
+/* reader side: copy a consistent snapshot of @shared into @out.
+ * returns 0 on success, or -1 if the firmware was mid-update on each of @max_tries attempts. */
+static inline int printipi_status_read(const struct printipi_status *shared, struct printipi_status *out, int max_tries) {
+    int i;
+    for (i = 0; i < max_tries; ++i) {
+        uint32_t before = __atomic_load_n(&shared->sequence, __ATOMIC_ACQUIRE);
+        uint32_t after;
+        if (before & 1) {
+            continue;
+        }
+        memcpy(out, shared, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&shared->sequence, __ATOMIC_RELAXED);
+        if (before == after) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+#endif
@@ -28,18 +28,27 @@
 #include <string>
 #include <tuple>
 #include <array>
+#include "simd.h"
 
 //mathematical vector utility
+//
+//The components are stored in the first 3 lanes of a simd::Lanes4, so Vector3f math uses SSE/NEON where available.
+//The 4th lane is padding, and its value is unspecified (Vector4 keeps its e component there).
 template <typename F> class Vector3 {
-	F _x, _y, _z;
+	public:
+		typedef typename simd::Lanes4<F>::type LanesT;
+	private:
+		LanesT _v;
 	public:
 		//default initialize: all components are zeroed
-		Vector3() : _x(0), _y(0), _z(0) {}
+		Vector3() : _v() {}
 		//initialize from components
-		Vector3(F x, F y, F z) : _x(x), _y(y), _z(z) {}
+		Vector3(F x, F y, F z) : _v(x, y, z, 0) {}
 		//initialize from another Vector3, possibly of a different precision
 		template <typename T2> Vector3(const Vector3<T2> &v)
-		  : _x(v.x()), _y(v.y()), _z(v.z()) {}
+		  : _v(v.x(), v.y(), v.z(), 0) {}
+		//initialize from the first 3 lanes of @v
+		explicit Vector3(const LanesT &v) : _v(v) {}
 
 		//cast to a tuple of <x, y, z>
 		std::tuple<F, F, F> tuple() const {
@@ -68,11 +77,13 @@ template <typename F> class Vector3 {
 			return str();
 		}
 		//@return x component
-		F x() const { return _x; }
+		F x() const { return _v[0]; }
 		//@return y component
-		F y() const { return _y; }
+		F y() const { return _v[1]; }
 		//@return z component
-		F z() const { return _z; }
+		F z() const { return _v[2]; }
+		//@return the underlying storage (including the padding lane)
+		const LanesT& lanes() const { return _v; }
 		//@return the square of the magnitude (length) of the vector.
 		//equivalent to this->mag() * this->mag(), but less verbose and explicitly avoids the sqrt operation.
 		F magSq() const { 
@@ -100,7 +111,7 @@ template <typename F> class Vector3 {
 
 		//unary negation operator (x = -y)
 		Vector3<F> operator-() const {
-			return *this * -1;
+			return Vector3<F>(-_v);
 		}
 		//Normalize the vector
 		//@return a vector of magnitude 1, but with the same direction as `this'
@@ -111,21 +122,21 @@ template <typename F> class Vector3 {
 		//operators:
 
 		Vector3<F> operator+(const Vector3<F> &v) const {
-			return Vector3<F>(x() + v.x(), y() + v.y(), z() + v.z());
+			return Vector3<F>(_v + v._v);
 		}
 		Vector3<F>& operator+=(const Vector3<F> &v) {
 			return *this = (*this + v);
 		}
 
 		Vector3<F> operator-(const Vector3<F> &v) const {
-			return *this + (-v);
+			return Vector3<F>(_v - v._v);
 		}
 		Vector3<F>& operator-=(const Vector3<F> &v) {
 			return *this = (*this - v);
 		}
 
 		Vector3<F> operator*(F s) const {
-			return Vector3<F>(s*x(), s*y(), s*z());
+			return Vector3<F>(_v * s);
 		}
 		Vector3<F>& operator*=(F s) {
 			return *this = (*this * s);
@@ -140,7 +151,7 @@ template <typename F> class Vector3 {
 
 		//The vector dot product: this . v
 		F dot(const Vector3<F> &v) const {
-			return x() * v.x() + y() * v.y() + z() * v.z();
+			return _v.dot3(v._v);
 		}
 		F dot(F ox, F oy, F oz) const {
 			return dot(Vector3<F>(ox, oy, oz));
@@ -151,7 +162,7 @@ template <typename F> class Vector3 {
 		//|   vx  vy  vz  |
 		// = <uy*vz - uz*vy, uz*vx - ux*vz, ux*vy - uy*vx>
 		Vector3<F> cross(const Vector3<F> &v) const {
-			return Vector3<F>(y()*v.z() - z()*v.y(), z()*v.x() - x()*v.z(), x()*v.y() - y()*v.x());
+			return Vector3<F>(_v.cross3(v._v));
 		}
 		Vector3<F> cross(F ox, F oy, F oz) const {
 			return cross(Vector3<F>(ox, oy, oz));
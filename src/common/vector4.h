@@ -28,21 +28,22 @@
 
 //4-Vector composed of an (x, y, z) point in cartesian space plus an e (Extruded-length) component
 template <typename F> class Vector4 {
-	//cartesian components
+	typedef typename Vector3<F>::LanesT LanesT;
+	//cartesian components, with the extruder location stored in the padding lane.
+	//  This lets every operation act on all 4 components at once.
 	Vector3<F> _xyz;
-	//extruder location
-	F _e;
+	explicit Vector4(const LanesT &v) : _xyz(v) {}
 	public:
 		//initialize to all 0's
-		Vector4() : _xyz(), _e(0) {}
+		Vector4() : _xyz() {}
 		//initialize from components
-		Vector4(F x, F y, F z, F e) : _xyz(x, y, z), _e(e) {}
+		Vector4(F x, F y, F z, F e) : _xyz(LanesT(x, y, z, e)) {}
 		//initialize from a cartesian (x, y, z) point plus an extruder coordinate
 		//
 		//allow for initialization from a different precision (eg a Vector3<double>)
-		template <typename T2> Vector4(const Vector3<T2> &xyz, T2 e) : _xyz(xyz.x(), xyz.y(), xyz.z()), _e(e) {}
+		template <typename T2> Vector4(const Vector3<T2> &xyz, T2 e) : _xyz(LanesT(xyz.x(), xyz.y(), xyz.z(), e)) {}
 		//initialize from another Vector4, possibly of a different precision
-		template <typename T2> Vector4(const Vector4<T2> &v) : _xyz(v.x(), v.y(), v.z()), _e(v.e()) {}
+		template <typename T2> Vector4(const Vector4<T2> &v) : _xyz(LanesT(v.x(), v.y(), v.z(), v.e())) {}
 
 		//cast to a tuple of <x, y, z, e>
 		std::tuple<F, F, F, F> tuple() const {
@@ -76,7 +77,7 @@ template <typename F> class Vector4 {
 		}
 		//return the e (extruder) component
 		const F e() const {
-			return _e;
+			return _xyz.lanes()[3];
 		}
 		//return the x component
 		const F x() const {
@@ -93,26 +94,26 @@ template <typename F> class Vector4 {
 
 		//unary negation operator (x = -y)
 		Vector4<F> operator-() const {
-			return *this * -1;
+			return Vector4<F>(-_xyz.lanes());
 		}
 
 		//operators:
 		Vector4<F> operator+(const Vector4<F> &v) const {
-			return Vector4<F>(x() + v.x(), y() + v.y(), z() + v.z(), e() + v.e());
+			return Vector4<F>(_xyz.lanes() + v._xyz.lanes());
 		}
 		Vector4<F>& operator+=(const Vector4<F> &v) {
 			return *this = (*this + v);
 		}
 
 		Vector4<F> operator-(const Vector4<F> &v) const {
-			return *this + (-v);
+			return Vector4<F>(_xyz.lanes() - v._xyz.lanes());
 		}
 		Vector4<F>& operator-=(const Vector4<F> &v) {
 			return *this = (*this - v);
 		}
 
 		Vector4<F> operator*(F s) const {
-			return Vector4<F>(s*x(), s*y(), s*z(), s*e());
+			return Vector4<F>(_xyz.lanes() * s);
 		}
 		Vector4<F>& operator*=(F s) {
 			return *this = (*this * s);
@@ -56,6 +56,15 @@
 #else
     #define DO_LOG 1
 #endif
+//LOGV & LOGD are compiled out entirely if below this level: 0 = verbose, 1 = debug, 2 = info (errors, warnings & info are always compiled in)
+//Release builds default to 2. Override with DEFINES=-DDMIN_LOG_LEVEL=<n>
+#ifdef DMIN_LOG_LEVEL
+    #define MIN_LOG_LEVEL DMIN_LOG_LEVEL
+#elif defined(BUILD_TYPE_release)
+    #define MIN_LOG_LEVEL 2
+#else
+    #define MIN_LOG_LEVEL 0
+#endif
 #ifdef DNO_LOG_M105
     #define NO_LOG_M105 1
 #else
@@ -76,6 +85,20 @@
 	#define ENABLE_TESTS 0
 #endif
 
+//vector math uses SSE2/NEON when the target supports it (see common/simd.h). Define DNO_SIMD to use plain scalar code instead.
+#ifdef DNO_SIMD
+	#define USE_SIMD 0
+#else
+	#define USE_SIMD 1
+#endif
+
+//record (and optionally abort on) heap allocations made from within the event loop. See common/allocaudit.h
+#ifdef DALLOC_AUDIT
+	#define ALLOC_AUDIT 1
+#else
+	#define ALLOC_AUDIT 0
+#endif
+
 
 //Now expose some primitive typedefs:
 
@@ -0,0 +1,295 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "binaryprotocol.h"
+#include <cstring> //for memcpy
+#include <string>
+#include <vector>
+#include "catch.hpp"
+
+namespace gparse {
+namespace binproto {
+
+uint16_t crc16(const uint8_t *data, std::size_t length, uint16_t crc) {
+    for (std::size_t i=0; i<length; ++i) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit=0; bit<8; ++bit) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+int payloadLength(uint8_t type, uint8_t textLength) {
+    switch (type) {
+        case RECORD_LINEAR_MOVE:
+        case RECORD_RAPID_MOVE:
+            return 4*sizeof(float);
+        case RECORD_ARC_CW:
+        case RECORD_ARC_CCW:
+            return 6*sizeof(float);
+        case RECORD_FEEDRATE:
+            return sizeof(float);
+        case RECORD_MCODE:
+            return sizeof(uint16_t) + 2*sizeof(float);
+        case RECORD_TEXT:
+            return 1 + textLength;
+        case RECORD_EXIT:
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+std::size_t encodeRecord(uint8_t type, uint16_t seq, const uint8_t *payload, std::size_t payloadLength, uint8_t *dest) {
+    dest[0] = SYNC;
+    dest[1] = type;
+    dest[2] = seq & 0xff;
+    dest[3] = seq >> 8;
+    memcpy(dest + HEADER_LENGTH, payload, payloadLength);
+    std::size_t length = HEADER_LENGTH + payloadLength;
+    uint16_t crc = crc16(dest+1, length-1);
+    dest[length++] = crc & 0xff;
+    dest[length++] = crc >> 8;
+    return length;
+}
+
+Decoder::Result Decoder::feed(uint8_t byte) {
+    discard(_completeLength);
+    _record[_length++] = byte;
+    return decode();
+}
+
+Decoder::Result Decoder::resume() {
+    discard(_completeLength);
+    return decode();
+}
+
+Decoder::Result Decoder::decode() {
+    while (_length) {
+        if (_record[0] != SYNC) {
+            //not synchronized to the start of a record; skip until the next SYNC
+            discardToNextSync();
+            continue;
+        }
+        if (_length < 2) {
+            return NEED_MORE;
+        }
+        if (payloadLength(type()) < 0) {
+            //unknown record type, so the SYNC byte must have been part of a corrupted record
+            _isResyncing = true;
+            discardToNextSync();
+            continue;
+        }
+        if (_length <= HEADER_LENGTH || _length < expectedLength()) {
+            return NEED_MORE;
+        }
+        std::size_t length = expectedLength();
+        uint16_t crc = _record[length-2] | (_record[length-1] << 8);
+        if (crc == crc16(&_record[1], length-1-CRC_LENGTH)) {
+            //record is complete. It stays in _record (for toCommand(), etc) until the next call to feed() or resume().
+            _isResyncing = false;
+            _completeLength = length;
+            return COMPLETE;
+        }
+        if (!_isResyncing) {
+            //skip the whole record, rather than resynchronizing on a SYNC byte within its payload
+            _isResyncing = true;
+            discard(length);
+            return BAD_CRC;
+        }
+        //while resynchronizing, a bad crc just means that SYNC byte didn't start a record; try the next one
+        discardToNextSync();
+    }
+    return NEED_MORE;
+}
+
+void Decoder::discard(std::size_t count) {
+    if (!count) {
+        return;
+    }
+    memmove(&_record[0], &_record[count], _length - count);
+    _length -= count;
+    _completeLength = 0;
+}
+
+void Decoder::discardToNextSync() {
+    std::size_t next = 1;
+    while (next < _length && _record[next] != SYNC) {
+        ++next;
+    }
+    discard(next);
+}
+
+std::size_t Decoder::expectedLength() const {
+    uint8_t textLength = type() == RECORD_TEXT ? _record[HEADER_LENGTH] : 0;
+    return HEADER_LENGTH + payloadLength(type(), textLength) + CRC_LENGTH;
+}
+
+float Decoder::readFloat(std::size_t payloadOffset) const {
+    float value;
+    memcpy(&value, &_record[HEADER_LENGTH + payloadOffset], sizeof(value));
+    return value;
+}
+
+Command Decoder::toCommand() const {
+    switch (type()) {
+        case RECORD_LINEAR_MOVE:
+        case RECORD_RAPID_MOVE:
+        case RECORD_ARC_CW:
+        case RECORD_ARC_CCW: {
+            unsigned gNumber = type() == RECORD_LINEAR_MOVE ? 1 : type() == RECORD_RAPID_MOVE ? 0 : type() == RECORD_ARC_CW ? 2 : 3;
+            Command cmd('G', gNumber);
+            const char labels[] = {'X', 'Y', 'Z', 'E', 'I', 'J'};
+            std::size_t numParams = payloadLength(type()) / sizeof(float);
+            for (std::size_t i=0; i<numParams; ++i) {
+                cmd.setParam(labels[i], readFloat(i*sizeof(float)));
+            }
+            return cmd;
+        }
+        case RECORD_FEEDRATE: {
+            Command cmd('G', 1);
+            cmd.setParam('F', readFloat(0));
+            return cmd;
+        }
+        case RECORD_MCODE: {
+            uint16_t mNumber = _record[HEADER_LENGTH] | (_record[HEADER_LENGTH+1] << 8);
+            Command cmd('M', mNumber);
+            cmd.setParam('S', readFloat(sizeof(uint16_t)));
+            cmd.setParam('P', readFloat(sizeof(uint16_t) + sizeof(float)));
+            return cmd;
+        }
+        case RECORD_TEXT:
+            return Command(std::string((const char*)&_record[HEADER_LENGTH+1], _record[HEADER_LENGTH]));
+        case RECORD_EXIT: {
+            Command cmd('M', 880);
+            cmd.setParam('S', 0);
+            return cmd;
+        }
+        default:
+            return Command();
+    }
+}
+
+TEST_CASE("Binary records are decoded into Commands", "[binproto]") {
+    std::array<uint8_t, MAX_RECORD_LENGTH> buffer;
+    Decoder decoder;
+    //G1 X1 Y2 E0.5 (Z absent)
+    float move[] = {1.f, 2.f, NAN, 0.5f};
+    std::size_t length = encodeRecord(RECORD_LINEAR_MOVE, 7, (const uint8_t*)move, sizeof(move), buffer.data());
+    REQUIRE(length == 22);
+    //garbage before the record is skipped
+    REQUIRE(decoder.feed(0x00) == Decoder::NEED_MORE);
+    for (std::size_t i=0; i<length-1; ++i) {
+        REQUIRE(decoder.feed(buffer[i]) == Decoder::NEED_MORE);
+    }
+    REQUIRE(decoder.feed(buffer[length-1]) == Decoder::COMPLETE);
+    REQUIRE(decoder.seq() == 7);
+    Command cmd = decoder.toCommand();
+    REQUIRE(cmd.isG1());
+    REQUIRE(cmd.getX() == 1.f);
+    REQUIRE(cmd.getY() == 2.f);
+    REQUIRE(!cmd.hasZ());
+    REQUIRE(cmd.getE() == 0.5f);
+
+    //a corrupted payload is detected
+    buffer[6] ^= 0x10;
+    Decoder::Result result = Decoder::NEED_MORE;
+    for (std::size_t i=0; i<length; ++i) {
+        result = decoder.feed(buffer[i]);
+    }
+    REQUIRE(result == Decoder::BAD_CRC);
+
+    //text records carry anything else
+    const char text[] = "\x06M117 a";
+    length = encodeRecord(RECORD_TEXT, 8, (const uint8_t*)text, 7, buffer.data());
+    for (std::size_t i=0; i<length; ++i) {
+        result = decoder.feed(buffer[i]);
+    }
+    REQUIRE(result == Decoder::COMPLETE);
+    REQUIRE(decoder.toCommand().isM117());
+    REQUIRE(decoder.toCommand().getSpecialStringParam() == "a");
+}
+
+TEST_CASE("The binary decoder resynchronizes after a corrupted record without mistaking its payload for records", "[binproto]") {
+    //feed bytes to the decoder, recording the seq of each complete record and the number of bad crcs
+    Decoder decoder;
+    std::vector<uint16_t> seqs;
+    int numBadCrcs = 0;
+    auto feed = [&](const uint8_t *bytes, std::size_t length) {
+        for (std::size_t i=0; i<length; ++i) {
+            for (Decoder::Result result = decoder.feed(bytes[i]); result != Decoder::NEED_MORE; result = decoder.resume()) {
+                if (result == Decoder::COMPLETE) {
+                    seqs.push_back(decoder.seq());
+                } else {
+                    ++numBadCrcs;
+                }
+            }
+        }
+    };
+    //a TEXT record whose payload contains what looks like the header of a 207-byte TEXT record
+    const char text[] = "\x0b" "abcdef" "\xfe\x07\x05\x00\xc8";
+    std::array<uint8_t, MAX_RECORD_LENGTH> bad;
+    std::size_t badLength = encodeRecord(RECORD_TEXT, 1, (const uint8_t*)text, 12, bad.data());
+    //followed by enough valid records to complete that fake record
+    std::vector<uint8_t> good;
+    float move[] = {1.f, 2.f, 3.f, 4.f};
+    for (uint16_t seq=2; seq<14; ++seq) {
+        std::array<uint8_t, MAX_RECORD_LENGTH> record;
+        std::size_t length = encodeRecord(RECORD_LINEAR_MOVE, seq, (const uint8_t*)move, sizeof(move), record.data());
+        good.insert(good.end(), record.begin(), record.begin()+length);
+    }
+    std::vector<uint16_t> expectedSeqs;
+    for (uint16_t seq=2; seq<14; ++seq) {
+        expectedSeqs.push_back(seq);
+    }
+
+    SECTION("a corrupted payload byte is reported once, and the SYNC within the payload is skipped") {
+        bad[HEADER_LENGTH+1] ^= 0x01;
+        feed(bad.data(), badLength);
+        REQUIRE(numBadCrcs == 1);
+        feed(good.data(), good.size());
+        REQUIRE(numBadCrcs == 1);
+        REQUIRE(seqs == expectedSeqs);
+    }
+    SECTION("a corrupted length ends the record early; the fake record that follows doesn't swallow the valid ones") {
+        //the record now ends within the text, just before the fake header
+        bad[HEADER_LENGTH] = 4;
+        feed(bad.data(), badLength);
+        REQUIRE(numBadCrcs == 1);
+        REQUIRE(seqs.empty());
+        feed(good.data(), good.size());
+        REQUIRE(numBadCrcs == 1);
+        REQUIRE(seqs == expectedSeqs);
+    }
+    SECTION("a corrupted type byte is skipped without a bad crc") {
+        bad[1] = 0x55;
+        feed(bad.data(), badLength);
+        feed(good.data(), good.size());
+        REQUIRE(numBadCrcs == 0);
+        REQUIRE(seqs == expectedSeqs);
+    }
+}
+
+}
+}
@@ -0,0 +1,138 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GPARSE_BINARYPROTOCOL_H
+#define GPARSE_BINARYPROTOCOL_H
+
+#include <array>
+#include <cstdint> //for uint8_t, etc
+#include <cstddef> //for size_t
+#include "command.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+    #error "gparse binary protocol records are little-endian and are decoded with memcpy; big-endian hosts are not supported"
+#endif
+
+namespace gparse {
+namespace binproto {
+
+/* 
+ * A compact binary alternative to text gcode, for hosts that stream pre-digested jobs (see util/gcode2bin.py).
+ *
+ * A host enters binary mode by sending "M880 S1" (which is replied to with "ok", like any other line).
+ * From then on, every record has the form:
+ *   [SYNC:u8] [type:u8] [seq:u16] [payload] [crc:u16]
+ * All multi-byte values are little-endian. Floats are IEEE-754 binary32; a NaN parameter is treated as absent.
+ * The crc is CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) over the type, seq and payload bytes.
+ * seq plays the role of a gcode line number (modulo 2^16): it must increment by 1 per record, and it is what's reported in
+ *   "ok N<seq> P<..> B<..>" replies and "Resend: <seq>" requests. Replies are always text.
+ * The EXIT record returns the channel to text mode.
+ */
+const uint8_t SYNC = 0xFE;
+
+enum RecordType {
+    RECORD_LINEAR_MOVE = 0x01, //G1: float X, Y, Z, E
+    RECORD_RAPID_MOVE  = 0x02, //G0: float X, Y, Z, E
+    RECORD_ARC_CW      = 0x03, //G2: float X, Y, Z, E, I, J
+    RECORD_ARC_CCW     = 0x04, //G3: float X, Y, Z, E, I, J
+    RECORD_FEEDRATE    = 0x05, //G1 F: float F
+    RECORD_MCODE       = 0x06, //M<number>: u16 number, float S, float P
+    RECORD_TEXT        = 0x07, //any other line, as text: u8 length, followed by that many characters
+    RECORD_EXIT        = 0x7F, //return to text mode (acknowledged as "M880 S0")
+};
+
+//[SYNC] [type] [seq:2]
+const std::size_t HEADER_LENGTH = 4;
+const std::size_t CRC_LENGTH = 2;
+//the longest possible record: a TEXT record with 255 characters
+const std::size_t MAX_RECORD_LENGTH = HEADER_LENGTH + 1 + 255 + CRC_LENGTH;
+
+uint16_t crc16(const uint8_t *data, std::size_t length, uint16_t crc=0xFFFF);
+
+//Return the length of the payload of a record of the given type, or -1 if the type is unknown.
+//@textLength is only used for RECORD_TEXT.
+int payloadLength(uint8_t type, uint8_t textLength=0);
+
+//Write a complete record, including sync, header & crc, into @dest (which must have room for MAX_RECORD_LENGTH bytes).
+//returns the number of bytes written
+std::size_t encodeRecord(uint8_t type, uint16_t seq, const uint8_t *payload, std::size_t payloadLength, uint8_t *dest);
+
+/* 
+ * Decoder reassembles records from a byte stream (one byte at a time, so it can share the input path used by text gcode).
+ * It has a fixed-size buffer, so decoding never allocates.
+ *
+ * After a corrupted record, the bytes that follow can't be trusted to start at a record boundary
+ *   (e.g. if the type or TEXT length byte was corrupted, or if a SYNC byte within a payload was mistaken for the start of a record).
+ * So the decoder resynchronizes by trying each SYNC byte it has buffered as the start of a record, and only leaves that state
+ *   once a record passes its crc. Candidates that fail are dropped silently, so one corrupted record yields one BAD_CRC.
+ */
+class Decoder {
+    std::array<uint8_t, MAX_RECORD_LENGTH> _record;
+    //number of bytes in _record
+    std::size_t _length;
+    //length of the record at the front of _record that was last returned as COMPLETE; it's dropped on the next feed() or resume()
+    std::size_t _completeLength;
+    bool _isResyncing;
+    public:
+        enum Result {
+            //the record isn't complete yet (or the byte was discarded while searching for a SYNC byte)
+            NEED_MORE,
+            //a record with a valid crc is ready; see type(), seq(), toCommand()
+            COMPLETE,
+            //a complete record was received, but its crc didn't match; it should be resent
+            BAD_CRC,
+        };
+        Decoder() : _length(0), _completeLength(0), _isResyncing(false) {}
+        Result feed(uint8_t byte);
+        //While resynchronizing, one byte can complete several buffered records.
+        //So after feed() returns anything other than NEED_MORE, call resume() until it does.
+        Result resume();
+        //drop any partially-received record
+        inline void reset() {
+            _length = 0;
+            _completeLength = 0;
+            _isResyncing = false;
+        }
+        //the following are only valid after feed() or resume() returns COMPLETE
+        inline uint8_t type() const {
+            return _record[1];
+        }
+        inline uint16_t seq() const {
+            return _record[2] | (_record[3] << 8);
+        }
+        //convert the record to the equivalent Command (without a line number)
+        Command toCommand() const;
+    private:
+        Result decode();
+        //remove the first @count buffered bytes
+        void discard(std::size_t count);
+        //discard bytes up to the next SYNC byte after the start of the buffer
+        void discardToNextSync();
+        float readFloat(std::size_t payloadOffset) const;
+        std::size_t expectedLength() const;
+};
+
+}
+}
+
+#endif
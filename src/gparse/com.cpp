@@ -22,19 +22,44 @@
  */
 
 #include "com.h"
+#include <algorithm> //for std::min
+#include <sstream>
+#include <cstring> //for strncpy
+#include <sys/socket.h>
+#include <sys/un.h> //for sockaddr_un
+#include <unistd.h> //for close
+#include <fcntl.h> //for open
+#include <sys/stat.h> //for fstat
+#include "common/logging.h"
+#include "platforms/auto/thisthreadsleep.h" //for SleepT
+#include "catch.hpp"
 
 namespace gparse {
 
 bool Com::tendCom() {
-    if (!_parsed.empty()) { 
-        return true;
+    if (_server) {
+        _server->tendClients();
+        if (_server->takeControllerChanged()) {
+            resetForNewController();
+        }
+        char chr;
+        while (!isQueueFull() && _server->getChar(chr)) {
+            receiveChar(chr);
+        }
+        //the controlling host hanging up is only noticed upon reading from it,
+        //  and State mustn't get the chance to reply to its commands after that
+        if (_server->takeControllerChanged()) {
+            resetForNewController();
+        }
+        return _numCommands != 0;
     }
-    if (!hasReadFile()) {
-        return false;
+    if (!_readFd) {
+        return _numCommands != 0;
     }
     //clear any eof bit possibly set previously (if a stream and not a file)
     _readFd->clear();
-    char chr;
+    //get() returns an int so that a 0xFF byte (valid in binary records) is distinguishable from eof
+    int chr;
     //a call to get() may hang, especially if using a stream.
     //rdbuf().in_avail() returns the expected number of characters that can be immediately read,
     //  0 indicates: "Further calls may either retrieve more characters or return traits_type::eof()"
@@ -43,54 +68,538 @@ bool Com::tendCom() {
     //  source: http://compgroups.net/comp.lang.c+/non-blocking-file-access-possible-in-c+/1017634#5544477932267335993
     //the case of 0 is acceptable, as that is either a character or EOF
     //the case of -1
-    while(_readFd->rdbuf()->in_avail() != 0 && (chr = _readFd->get()) != std::char_traits<char>::eof()) {
-        if (chr == '\n') {
-            _parsed = Command(_pending);
-            _pending = "";
-            return !_parsed.empty(); //it's possible we got a blank line, or a comment.
-        } else if (chr != '\r') {
-            _pending += chr;
-        }
+    //read ahead until the command queue fills.
+    while(!isQueueFull() && _readFd->rdbuf()->in_avail() != 0 && (chr = _readFd->get()) != std::char_traits<char>::eof()) {
+        receiveChar(chr);
+    }
+    if (isQueueFull()) {
+        //the rest of the line(s) may already be sitting in the stream's buffer, where polling can't see them.
+        _hasBufferedInput = true;
+        return true;
     }
+    _hasBufferedInput = false;
     //at this point, we have reached an EOF
     // we are either reading from a stream, in which case there may be more to come,
     // or we are reading from a file, in which case we should parse any pending command:
     if (_dieOnEof) {
         _isAtEof = true;
-        _parsed = Command(_pending);
-        _pending = "";
-        return !_parsed.empty();
+        acceptLine();
+    }
+    return _numCommands != 0;
+}
+
+ComPollFd ComPollFd::open(const std::string &filename) {
+    //O_NOCTTY: opening a tty here must not make it our controlling terminal
+    int fd = ::open(filename.c_str(), O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+    struct stat st;
+    if (fd != -1 && (fstat(fd, &st) == -1 || S_ISREG(st.st_mode))) {
+        close(fd);
+        fd = -1;
+    }
+    return ComPollFd(fd);
+}
+
+ComPollFd::~ComPollFd() {
+    if (_fd != -1) {
+        close(_fd);
     }
-    return false;
+}
+
+void Com::receiveChar(char chr) {
+    if (_isBinary) {
+        receiveBinary(chr);
+    } else if (chr == '\n') {
+        acceptLine();
+    } else if (chr != '\r') {
+        _pending += chr;
+    }
+}
+
+void Com::acceptLine() {
+    Command cmd(_pending);
+    _pending = "";
+    if (!cmd.isChecksumValid()) {
+        requestResend("checksum mismatch");
+        return;
+    }
+    acceptCommand(std::move(cmd));
+}
+
+void Com::receiveBinary(uint8_t byte) {
+    binproto::Decoder::Result result = _binaryDecoder.feed(byte);
+    //stop if the record was M880 S0 (EXIT), which resets the decoder
+    while (result != binproto::Decoder::NEED_MORE && _isBinary) {
+        if (result == binproto::Decoder::BAD_CRC) {
+            requestResend("checksum mismatch");
+        } else {
+            Command cmd = _binaryDecoder.toCommand();
+            //seq is the line number modulo 2^16; extend it to the line number nearest the one expected
+            int32_t expected = _lastLineNumber+1;
+            cmd.setLineNumber(expected + (int16_t)(uint16_t)(_binaryDecoder.seq() - (uint16_t)expected));
+            acceptCommand(std::move(cmd));
+        }
+        result = _binaryDecoder.resume();
+    }
+}
+
+void Com::acceptCommand(Command &&cmd) {
+    //Validate the line numbering & checksum used by hosts that stream multiple lines at once.
+    //A bad line is discarded and the host asked to resend from the first line we're missing.
+    if (cmd.hasLineNumber()) {
+        //M110 sets the line number, so it needn't follow the previous one
+        if (!cmd.isM110() && cmd.getLineNumber() != _lastLineNumber+1) {
+            requestResend("Line Number is not Last Line Number+1");
+            return;
+        }
+        _lastLineNumber = cmd.getLineNumber();
+    }
+    if (cmd.isM110() && cmd.hasParam('N')) {
+        //M110 N<n> (as opposed to N<n> M110)
+        _lastLineNumber = (int32_t)cmd.getFloatParam('N');
+    }
+    if (cmd.isM880()) {
+        //switch to/from the binary protocol. The switch happens now, rather than when the command is executed,
+        //  because any input that follows is already in the new format.
+        _isBinary = cmd.getS(0) != 0;
+        _binaryDecoder.reset();
+    }
+    if (!cmd.empty()) { //it's possible we got a blank line, or a comment.
+        std::size_t idx = (_commandsBegin + _numCommands) % _commands.size();
+        _commands[idx] = std::move(cmd);
+        _rejectionReasons[idx] = nullptr;
+        _commandTimestamps[idx] = CommandTimestamps();
+        _commandTimestamps[idx].received = EventClockT::now();
+        ++_numCommands;
+    }
+}
+
+void Com::requestResend(const char *reason) {
+    LOGW("Com: rejecting line (%s); requesting resend of line %i\n", reason, (int)(_lastLineNumber+1));
+    if (!_numCommands) {
+        writeRejection(reason, _lastLineNumber);
+    } else {
+        //hosts match replies to lines in order, so the earlier commands must be replied to first.
+        //There is always room, as input is only read while the queue isn't full.
+        std::size_t idx = (_commandsBegin + _numCommands) % _commands.size();
+        _commands[idx] = Command();
+        _commands[idx].setLineNumber(_lastLineNumber);
+        _rejectionReasons[idx] = reason;
+        ++_numCommands;
+    }
+}
+
+void Com::writeRejection(const char *reason, int32_t lastLineNumber) {
+    write(Response::fromFormat(ResponseError, "%s, Last Line: %i", reason, (int)lastLineNumber));
+    write(Response::fromFormat(ResponseResend, "%i", (int)(lastLineNumber+1)));
+    //the rejected line still consumes one "ok", so that hosts counting acknowledgements stay in sync
+    write(Response::Ok);
+}
+
+void Com::popCommand() {
+    _commandsBegin = (_commandsBegin+1) % _commands.size();
+    --_numCommands;
+}
+
+void Com::resetForNewController() {
+    //the new host starts its own line numbering, in text mode, and mustn't be sent replies to the old host's lines
+    dropQueuedCommands();
+    _pending.clear();
+    _lastLineNumber = 0;
+    _isBinary = false;
+    _binaryDecoder.reset();
+}
+
+void Com::dropQueuedCommands() {
+    //State dispatches only the oldest command, and must still be allowed to reply to it if it's underway
+    bool isExecuting = _numCommands && CommandTimestamps::isSet(_commandTimestamps[_commandsBegin].dispatched);
+    if (isExecuting) {
+        _numCommands = 1;
+    } else {
+        _numCommands = 0;
+        _commandsBegin = 0;
+    }
+    _isFrontOrphaned = isExecuting;
+    _rejectionReasons.fill(nullptr);
 }
 
 bool Com::hasReadFile() const {
-    return (bool)_readFd;
+    return _readFd || _server;
 }
 bool Com::hasWriteFile() const {
-    return (bool)_writeFd;
+    return _writeFd || _server;
+}
+std::size_t Com::getPollFds(struct pollfd *dest, std::size_t maxFds) const {
+    std::size_t numFds = 0;
+    auto addFd = [&](int fd, short events) {
+        if (numFds < maxFds) {
+            dest[numFds].fd = fd;
+            dest[numFds].events = events;
+            dest[numFds].revents = 0;
+        }
+        ++numFds;
+    };
+    if (_server) {
+        //new connections, controller input and monitor hang-ups all require tending
+        addFd(_server->listenFd(), POLLIN);
+        for (int fd : _server->clientFds()) {
+            //the controlling host also needs tending once it can accept output that was held back (see UnixSocketServer::write)
+            bool isWaitingToWrite = fd == _server->clientFds()[0] && _server->hasPendingOutput();
+            addFd(fd, isWaitingToWrite ? POLLIN | POLLOUT : POLLIN);
+        }
+    } else if (_pollFd.get() != -1) {
+        addFd(_pollFd.get(), POLLIN);
+    }
+    return numFds;
+}
+
+bool Com::hasInputWithoutPoll() const {
+    if (_numCommands) {
+        return true;
+    }
+    if (_server) {
+        return _server->hasBufferedInput();
+    }
+    return _readFd && (_pollFd.get() == -1 || _hasBufferedInput);
+}
+
+bool Com::hasInputAfterPoll(const struct pollfd *fds, std::size_t numFds) {
+    bool hasInput = hasInputWithoutPoll();
+    for (std::size_t i=0; i<numFds; ++i) {
+        if (fds[i].revents) {
+            hasInput = true;
+        }
+        if (!_server && (fds[i].revents & (POLLHUP | POLLERR | POLLNVAL)) && !(fds[i].revents & POLLIN)) {
+            _pollFd = ComPollFd();
+        }
+    }
+    return hasInput;
 }
+
 bool Com::isAtEof() const {
-    return _isAtEof && _parsed.empty();
+    return _isAtEof && _numCommands == 0;
 }
 const Command& Com::getCommand() const {
-    return _parsed;
+    static const Command noCommand;
+    return _numCommands ? _commands[_commandsBegin] : noCommand;
 }
 
-void Com::reply(const Response &resp) {
+void Com::reply(const Response &resp, unsigned numFreePlannerSlots) {
+    if (resp.isComment()) {
+        write(resp);
+        return;
+    }
+    if (_isFrontOrphaned) {
+        //the host that sent the command is gone, and its line number means nothing to the current host
+        _isFrontOrphaned = false;
+        popCommand();
+        return;
+    }
+    //The pending command has been replied to, so remove it from the queue.
+    //We must check that the response wasn't a comment, as a comment doesn't count as acknowledgement of a command.
+    int32_t lineNumber = getCommand().getLineNumber();
+    if (_numCommands) {
+        popCommand();
+    }
+    //rejections of lines received after this command are sent right after its reply, freeing their slots too
+    std::size_t numRejections = 0;
+    while (numRejections < _numCommands && _rejectionReasons[(_commandsBegin + numRejections) % _commands.size()]) {
+        ++numRejections;
+    }
+    if (resp.isBareOk() && lineNumber >= 0) {
+        //Hosts that number their lines are told how much more they can send: "ok N<line> P<free planner slots> B<free command slots>"
+        unsigned numFreeSlots = _commands.size() - _numCommands + numRejections;
+        write(Response::fromFormat(ResponseOk, "N%i P%u B%u", (int)lineNumber, numFreePlannerSlots, numFreeSlots));
+    } else {
+        write(resp);
+    }
+    for (; numRejections; --numRejections) {
+        writeRejection(_rejectionReasons[_commandsBegin], _commands[_commandsBegin].getLineNumber());
+        popCommand();
+    }
+}
+
+void Com::write(const Response &resp) {
     //Only send a response if we have an output stream,
     //  and the response either isn't a comment, or it is a comment and we're configured to send comments.
     if (hasWriteFile() && (_doSendGcodeComments || !resp.isComment())) {
-        std::string respStr = resp.toString();
-        (*_writeFd) << respStr;
-        _writeFd->put('\n');
+        std::size_t avail = _writeBuffer.size() - _writeBufferLength;
+        std::size_t len = resp.format(_writeBuffer.data() + _writeBufferLength, avail);
+        if (len+1 > avail) {
+            //not enough room for the reply and its newline; send what's been buffered and then format at the start of the buffer.
+            flush();
+            avail = _writeBuffer.size();
+            //overly long replies are truncated to leave room for the newline
+            len = std::min(resp.format(_writeBuffer.data(), avail), avail-1);
+        }
+        _writeBufferLength += len;
+        _writeBuffer[_writeBufferLength++] = '\n';
+    }
+}
+
+void Com::flush() {
+    if (_writeBufferLength && _server) {
+        _server->write(_writeBuffer.data(), _writeBufferLength);
+    } else if (_writeBufferLength && _writeFd) {
+        _writeFd->write(_writeBuffer.data(), _writeBufferLength);
         _writeFd->flush();
     }
-    if (!resp.isComment()) {
-        //The pending command has been replied to, so reset it.
-        //We must check that the response wasn't a comment, as a comment doesn't count as acknowledgement of a command.
-        _parsed = Command();
+    _writeBufferLength = 0;
+}
+
+TEST_CASE("Com batches replies until flushed", "[com]") {
+    std::ostringstream out;
+    Com com(nullptr, Com::shareOwnership<std::ostream*>(&out));
+    com.reply(Response::Ok);
+    com.reply(Response(ResponseWarning, "test"));
+    com.reply(Response(ResponseOk, {std::make_pair("T", 65.f), std::make_pair("B", 20.5f)}));
+    REQUIRE(out.str() == "");
+    com.flush();
+    REQUIRE(out.str() == "ok\n// warning: test\nok T:65.000000 B:20.500000\n");
+}
+
+TEST_CASE("Com validates line numbers & checksums and requests resends", "[com]") {
+    std::stringstream in;
+    std::ostringstream out;
+    Com com(Com::shareOwnership<std::istream*>(&in), Com::shareOwnership<std::ostream*>(&out));
+    //the second line is corrupt, and the fourth skips a line number
+    in << "N1 G28*18\nN2 G1 X1*98\nN2 G1 X1*99\nN4 M105\nN3 M105*36\n";
+    REQUIRE(com.tendCom());
+    com.flush();
+    //the rejections must follow the replies to the lines before them
+    REQUIRE(out.str() == "");
+    //the valid lines were queued, and each reply reports the free space
+    REQUIRE(com.getCommand().isG28());
+    com.reply(Response::Ok, 1);
+    REQUIRE(com.getCommand().isG1());
+    com.reply(Response::Ok, 0);
+    REQUIRE(com.getCommand().isM105());
+    REQUIRE(com.getCommand().getLineNumber() == 3);
+    com.reply(Response(ResponseOk, "T:20"));
+    com.flush();
+    REQUIRE(out.str() ==
+        "ok N1 P1 B5\nError:checksum mismatch, Last Line: 1\nResend: 2\nok\n"
+        "ok N2 P0 B7\nError:Line Number is not Last Line Number+1, Last Line: 2\nResend: 3\nok\n"
+        "ok T:20\n");
+    //with nothing awaiting a reply, a rejection is sent immediately
+    out.str("");
+    in << "N5 M105\n";
+    REQUIRE(!com.tendCom());
+    com.flush();
+    REQUIRE(out.str() == "Error:Line Number is not Last Line Number+1, Last Line: 3\nResend: 4\nok\n");
+    REQUIRE(!com.tendCom());
+    //M110 sets the line number of the next line
+    out.str("");
+    in << "M110 N100\nN101 M105*39\n";
+    REQUIRE(com.tendCom());
+    REQUIRE(com.getCommand().isM110());
+    com.reply(Response::Ok);
+    REQUIRE(com.getCommand().isM105());
+    com.reply(Response::Ok);
+    com.flush();
+    REQUIRE(out.str() == "ok\nok N101 P0 B8\n");
+}
+
+TEST_CASE("Com accepts binary records once negotiated", "[com]") {
+    std::stringstream in;
+    std::ostringstream out;
+    Com com(Com::shareOwnership<std::istream*>(&in), Com::shareOwnership<std::ostream*>(&out));
+    std::array<uint8_t, binproto::MAX_RECORD_LENGTH> record;
+    auto sendRecord = [&](uint8_t type, uint16_t seq, const void *payload, std::size_t length) {
+        std::size_t recordLength = binproto::encodeRecord(type, seq, (const uint8_t*)payload, length, record.data());
+        in.write((const char*)record.data(), recordLength);
+    };
+    in << "M880 S1\n";
+    float move[] = {1.f, NAN, NAN, 0.f};
+    //give the E parameter a 0xFF byte, which mustn't be mistaken for EOF
+    uint32_t eBits = 0x3F8000FF;
+    memcpy(&move[3], &eBits, sizeof(eBits));
+    sendRecord(binproto::RECORD_LINEAR_MOVE, 1, move, sizeof(move));
+    //seq 3 is out of order, as seq 2 is missing
+    sendRecord(binproto::RECORD_EXIT, 3, nullptr, 0);
+    sendRecord(binproto::RECORD_EXIT, 2, nullptr, 0);
+    in << "M105\n";
+    REQUIRE(com.tendCom());
+    REQUIRE(com.getCommand().isM880());
+    com.reply(Response::Ok);
+    REQUIRE(com.getCommand().isG1());
+    REQUIRE(com.getCommand().getX() == 1.f);
+    REQUIRE(com.getCommand().getE() == move[3]);
+    REQUIRE(!com.getCommand().hasY());
+    com.reply(Response::Ok);
+    com.flush();
+    //the out-of-order record is rejected once the records before it have been acknowledged
+    REQUIRE(out.str() == "ok\nok N1 P0 B6\nError:Line Number is not Last Line Number+1, Last Line: 1\nResend: 2\nok\n");
+    //the EXIT record is acknowledged as M880 S0, after which text is accepted again
+    REQUIRE(com.getCommand().isM880());
+    REQUIRE(com.getCommand().getS() == 0);
+    com.reply(Response::Ok);
+    REQUIRE(com.getCommand().isM105());
+}
+
+
+//connect to the unix socket at @path, returning the client's fd
+static int connectUnixSocket(const char *path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path)-1);
+    REQUIRE(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    return fd;
+}
+//read whatever is available on @fd (waiting briefly for it to arrive)
+static std::string readAvailable(int fd) {
+    usleep(20000);
+    char buffer[256];
+    ssize_t numRead = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    return numRead > 0 ? std::string(buffer, numRead) : std::string();
+}
+
+TEST_CASE("Com serves a controlling host and read-only monitors over a unix socket", "[com]") {
+    const char *path = "PRINTIPI_TEST_SOCKET";
+    Com com(std::unique_ptr<UnixSocketServer>(new UnixSocketServer(path)));
+    int controller = connectUnixSocket(path);
+    int monitor = connectUnixSocket(path);
+    REQUIRE(!com.tendCom());
+    REQUIRE(com.server()->clientFds().size() == 2);
+
+    //commands from the monitor are ignored
+    REQUIRE(send(monitor, "G28\n", 4, 0) == 4);
+    usleep(20000);
+    REQUIRE(!com.tendCom());
+
+    //commands from the controller are parsed & the reply is seen by everyone
+    REQUIRE(send(controller, "G1 X1\n", 6, 0) == 6);
+    usleep(20000);
+    REQUIRE(com.tendCom());
+    REQUIRE(com.getCommand().isG1());
+    com.reply(Response::Ok);
+    com.flush();
+    REQUIRE(readAvailable(controller) == "ok\n");
+    REQUIRE(readAvailable(monitor) == "ok\n");
+
+    WHEN("The controlling host disconnects") {
+        //leave a partial line behind; it must not be prepended to the next host's command
+        REQUIRE(send(controller, "G1 X", 4, 0) == 4);
+        usleep(20000);
+        REQUIRE(!com.tendCom());
+        close(controller);
+        controller = -1;
+        usleep(20000);
+        REQUIRE(!com.tendCom());
+        THEN("The monitor becomes the controlling host") {
+            REQUIRE(com.server()->clientFds().size() == 1);
+            REQUIRE(send(monitor, "G28\n", 4, 0) == 4);
+            usleep(20000);
+            REQUIRE(com.tendCom());
+            REQUIRE(com.getCommand().isG28());
+        }
+    }
+    if (controller != -1) {
+        close(controller);
     }
+    close(monitor);
+}
+
+TEST_CASE("Commands queued by a host that gives up control aren't replied to the next host", "[com]") {
+    const char *path = "PRINTIPI_TEST_SOCKET";
+    Com com(std::unique_ptr<UnixSocketServer>(new UnixSocketServer(path)));
+    int hostA = connectUnixSocket(path);
+    int hostB = connectUnixSocket(path);
+    REQUIRE(!com.tendCom());
+    //the last line is out of sequence, so its rejection is queued behind the others
+    const char *lines = "N1 G1 X1\nN2 G1 X2\nN4 G1 X3\n";
+    REQUIRE(send(hostA, lines, strlen(lines), 0) == (ssize_t)strlen(lines));
+    usleep(20000);
+    REQUIRE(com.tendCom());
+    REQUIRE(com.numPendingCommands() == 3);
+    SECTION("Queued commands are dropped") {
+        close(hostA);
+        usleep(20000);
+        REQUIRE(!com.tendCom());
+        REQUIRE(com.numPendingCommands() == 0);
+    }
+    SECTION("A command that's already executing is finished, but its reply is only seen by its host") {
+        //as State does when it first attempts the command
+        com.getCommandTimestamps().dispatched = EventClockT::now();
+        close(hostA);
+        usleep(20000);
+        REQUIRE(com.tendCom());
+        REQUIRE(com.numPendingCommands() == 1);
+        REQUIRE(com.getCommand().getLineNumber() == 1);
+        com.reply(Response::Ok);
+        REQUIRE(com.numPendingCommands() == 0);
+    }
+    com.flush();
+    REQUIRE(readAvailable(hostB) == "");
+    //the new host numbers its lines from scratch
+    REQUIRE(send(hostB, "N1 G28\n", 7, 0) == 7);
+    usleep(20000);
+    REQUIRE(com.tendCom());
+    REQUIRE(com.getCommand().isG28());
+    com.reply(Response::Ok);
+    com.flush();
+    REQUIRE(readAvailable(hostB) == "ok N1 P0 B8\n");
+    close(hostB);
+}
+
+TEST_CASE("The controlling host receives all output, even if it reads slowly", "[com]") {
+    const char *path = "PRINTIPI_TEST_SOCKET";
+    Com com(std::unique_ptr<UnixSocketServer>(new UnixSocketServer(path)));
+    int controller = connectUnixSocket(path);
+    int monitor = connectUnixSocket(path);
+    REQUIRE(!com.tendCom());
+    //send far more than the socket buffers hold, without anyone reading it
+    std::string sent;
+    for (int i=0; sent.size() < 1024*1024; ++i) {
+        std::string line = "ok T:" + std::to_string(i) + "\n";
+        com.server()->write(line.data(), line.size());
+        sent += line;
+    }
+    REQUIRE(com.server()->hasPendingOutput());
+    std::array<struct pollfd, 4> fds;
+    REQUIRE(com.getPollFds(fds.data(), fds.size()) == 3);
+    REQUIRE((fds[1].events & POLLOUT));
+    //the monitor misses some output, but the controller receives everything, in order
+    std::string received;
+    char buffer[4096];
+    while (received.size() < sent.size()) {
+        ssize_t numRead = recv(controller, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (numRead > 0) {
+            received.append(buffer, numRead);
+        } else {
+            com.tendCom();
+        }
+    }
+    REQUIRE(received == sent);
+    REQUIRE(!com.server()->hasPendingOutput());
+    close(controller);
+    close(monitor);
+}
+
+TEST_CASE("Com exposes descriptors that become readable on host input", "[com]") {
+    const char *path = "PRINTIPI_TEST_SOCKET";
+    Com com(std::unique_ptr<UnixSocketServer>(new UnixSocketServer(path)));
+    int controller = connectUnixSocket(path);
+    std::array<struct pollfd, 4> fds;
+    //the listening socket is readable until the controller has been accepted
+    REQUIRE(com.getPollFds(fds.data(), fds.size()) == 1);
+    REQUIRE(!com.tendCom());
+    REQUIRE(com.getPollFds(fds.data(), fds.size()) == 2);
+    REQUIRE(!com.hasInputWithoutPoll());
+    REQUIRE(SleepT::poll_for(std::chrono::milliseconds(0), fds.data(), 2) == 0);
+    REQUIRE(!com.hasInputAfterPoll(fds.data(), 2));
+
+    REQUIRE(send(controller, "G28\n", 4, 0) == 4);
+    //a long sleep ends as soon as the host sends data
+    REQUIRE(SleepT::poll_for(std::chrono::seconds(10), fds.data(), 2) == 1);
+    REQUIRE(com.hasInputAfterPoll(fds.data(), 2));
+    REQUIRE(com.tendCom());
+    //a command awaiting its reply needs tending, whether or not there's more data
+    REQUIRE(com.hasInputWithoutPoll());
+    com.reply(Response::Ok);
+    REQUIRE(!com.hasInputWithoutPoll());
+    close(controller);
 }
 
 }
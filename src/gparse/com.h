@@ -27,8 +27,13 @@
 #include <string>
 #include <fstream>
 #include <memory> //for std::unique_ptr
+#include <array>
+#include <poll.h> //for pollfd
 #include "command.h"
 #include "response.h"
+#include "unixsocketserver.h"
+#include "binaryprotocol.h"
+#include "common/latencytracer.h" //for CommandTimestamps
 
 namespace gparse {
 
@@ -39,12 +44,35 @@ template <> class ComStreamOwnershipMarker<std::istream*> {
     friend class Com;
     std::istream* argument;
     bool hasOwnership;
+    //when opened by name, the file is re-opened by Com to obtain a descriptor that can be polled for input
+    std::string filename;
     public:
         ComStreamOwnershipMarker(std::istream *argument, bool hasOwnership) : argument(argument), hasOwnership(hasOwnership) {}
-        ComStreamOwnershipMarker(const char *filename) : argument(new std::ifstream(filename, std::ios_base::in)), hasOwnership(true) {}
-        ComStreamOwnershipMarker(const std::string &filename) : argument(new std::ifstream(filename, std::ios_base::in)), hasOwnership(true) {}
+        ComStreamOwnershipMarker(const char *filename) : argument(new std::ifstream(filename, std::ios_base::in)), hasOwnership(true), filename(filename) {}
+        ComStreamOwnershipMarker(const std::string &filename) : argument(new std::ifstream(filename, std::ios_base::in)), hasOwnership(true), filename(filename) {}
         ComStreamOwnershipMarker(std::nullptr_t) : argument(nullptr), hasOwnership(true) {}
 };
+
+//Owns a file descriptor that is only used to wait for input on a Com's read stream (see Com::getPollFds).
+//The descriptor is closed on destruction.
+class ComPollFd {
+    int _fd;
+    public:
+        explicit ComPollFd(int fd=-1) : _fd(fd) {}
+        //open @filename for polling. Regular files are always readable, so for them (or on error) no fd is kept.
+        static ComPollFd open(const std::string &filename);
+        inline ComPollFd(ComPollFd &&other) : _fd(other._fd) {
+            other._fd = -1;
+        }
+        inline ComPollFd& operator=(ComPollFd &&other) {
+            std::swap(_fd, other._fd);
+            return *this;
+        }
+        ~ComPollFd();
+        inline int get() const {
+            return _fd;
+        }
+};
 template <> class ComStreamOwnershipMarker<std::ostream*> {
     friend class Com;
     std::ostream* argument;
@@ -81,16 +109,42 @@ class Com {
     //Have to use unique_ptrs because fstreams aren't movable for gcc < 5.0
     std::unique_ptr<std::istream, ComStreamDeleter> _readFd;
     std::unique_ptr<std::ostream, ComStreamDeleter> _writeFd;
+    //Instead of streams, a Com may serve hosts connected to a unix socket
+    std::unique_ptr<UnixSocketServer> _server;
+    //becomes readable when the host sends data on _readFd; -1 if the stream can't be polled.
+    ComPollFd _pollFd;
     //store any partially-received line that hasn't been fully parsed
     std::string _pending;
-    //The last parsed command that is awaiting a reply
-    Command _parsed;
+    //Parsed commands awaiting a reply, oldest (i.e. getCommand()) first.
+    //  Input is read ahead until this fills, so that hosts that stream numbered lines can be told how much room is left (see reply).
+    std::array<Command, 8> _commands;
+    //when each entry of _commands passed through each stage of processing (see common/latencytracer.h)
+    std::array<CommandTimestamps, std::tuple_size<decltype(_commands)>::value> _commandTimestamps;
+    //A line that fails validation while earlier commands await their replies is queued in _commands as a placeholder
+    //  (holding the last accepted line number), so that its rejection is sent after those replies (see requestResend).
+    //  This is the reason for the rejection, or nullptr if the entry is an actual command.
+    std::array<const char*, std::tuple_size<decltype(_commands)>::value> _rejectionReasons;
+    std::size_t _commandsBegin, _numCommands;
+    //Set when the host that sent the oldest entry of _commands has given up control of the socket while it was executing.
+    //  It's still replied to (State expects to finish it), but the reply isn't sent to the new host.
+    bool _isFrontOrphaned;
+    //line number of the last accepted line; the next numbered line must be 1 greater (or be M110).
+    int32_t _lastLineNumber;
+    //Set once the host has switched this channel to the binary protocol (M880 S1); see binaryprotocol.h
+    bool _isBinary;
+    binproto::Decoder _binaryDecoder;
+    //Replies are formatted into this buffer and then written out in batches by flush(),
+    //  avoiding both heap allocations and a syscall per reply.
+    std::array<char, 1024> _writeBuffer;
+    std::size_t _writeBufferLength;
     //Some hosts will accept lines starting with "//" and treat them as comments (useful for debugging). Others may not.
     bool _doSendGcodeComments;
     //Most of the time, the files being read from are actually streams of some sort, and so an EOF just means the data isn't yet ready.
     //But when reading from an ACTUAL file, an EOF actually does indicate the end of commands.
     bool _dieOnEof;
     bool _isAtEof;
+    //set when tendCom() returned before draining _readFd, so input may be buffered inside the stream
+    bool _hasBufferedInput;
     public:
         //Whenever you pass a file pointer to the Com constructor, you must explicitly mark who the owner should be.
         //If you wish for the caller to retain ownership, call Com(..., shareOwnership(file), ...)
@@ -111,9 +165,43 @@ class Com {
             bool doSendGcodeComments=true) 
           : _readFd(readStream.argument, ComStreamDeleter(readStream.hasOwnership)), 
             _writeFd(writeStream.argument, ComStreamDeleter(writeStream.hasOwnership)),
+            _pollFd(readStream.filename.empty() ? ComPollFd() : ComPollFd::open(readStream.filename)),
+            _commandsBegin(0),
+            _numCommands(0),
+            _isFrontOrphaned(false),
+            _lastLineNumber(0),
+            _isBinary(false),
+            _writeBufferLength(0),
             _doSendGcodeComments(doSendGcodeComments), 
             _dieOnEof(dieOnEof),
-            _isAtEof(false) {
+            _isAtEof(false),
+            _hasBufferedInput(false) {
+            //preallocate room for a typical line, so that receiving commands doesn't touch the heap
+            _pending.reserve(256);
+        }
+        //Communicate with any hosts that connect to the unix socket served by @server.
+        //  Replies are sent to every connected host, but only the controlling host's commands are read.
+        inline Com(std::unique_ptr<UnixSocketServer> &&server, bool doSendGcodeComments=true)
+          : _readFd(nullptr, ComStreamDeleter()),
+            _writeFd(nullptr, ComStreamDeleter()),
+            _server(std::move(server)),
+            _commandsBegin(0),
+            _numCommands(0),
+            _isFrontOrphaned(false),
+            _lastLineNumber(0),
+            _isBinary(false),
+            _writeBufferLength(0),
+            _doSendGcodeComments(doSendGcodeComments),
+            _dieOnEof(false),
+            _isAtEof(false),
+            _hasBufferedInput(false) {
+            _pending.reserve(256);
+        }
+        Com(Com &&) = default;
+        Com& operator=(Com &&) = default;
+        //any replies that are still buffered are written out before closing the streams
+        inline ~Com() {
+            flush();
         }
 
         //returns true if there is a command ready to be interpreted.
@@ -121,6 +209,31 @@ class Com {
 
         bool hasReadFile() const;
         bool hasWriteFile() const;
+        //returns the socket server, or nullptr if this Com is stream-based
+        inline UnixSocketServer* server() const {
+            return _server.get();
+        }
+
+        //write the descriptors that become ready when a host sends data to this Com into @dest (at most @maxFds of them).
+        //  A socket host that has output held back for it is also polled for being writable.
+        //returns the number of descriptors this Com has, which may exceed @maxFds.
+        std::size_t getPollFds(struct pollfd *dest, std::size_t maxFds) const;
+        //returns true if tendCom() may have work to do even though none of the poll fds are readable:
+        //  a command is awaiting its reply, input is buffered in user-space, or the stream can't be polled at all.
+        bool hasInputWithoutPoll() const;
+        //given the results of polling the descriptors from getPollFds (in the same order), return true if tendCom() has work to do.
+        //A stream that has hung up (e.g. the writer of a pipe exited) would poll as ready forever,
+        //  so it stops being polled and is instead tended unconditionally.
+        bool hasInputAfterPoll(const struct pollfd *fds, std::size_t numFds);
+
+        //@return the number of commands received but not yet replied to
+        inline std::size_t numPendingCommands() const {
+            return _numCommands;
+        }
+        //@return the line number of the last numbered line accepted (0 if none, or as set by M110)
+        inline int32_t lastLineNumber() const {
+            return _lastLineNumber;
+        }
 
         //if reading with dieOnEof=true, and the last command has been parsed (but not necessarily responded to),
         //  then this function will return true
@@ -128,10 +241,46 @@ class Com {
 
         //returns any pending command.
         //
-        //sequential calls to getCommand() will all return the same command, until reply() is called, at which point the next command will be parsed.
+        //sequential calls to getCommand() will all return the same command, until reply() is called, at which point the next command will be returned.
         const Command& getCommand() const;
+        //returns the timestamps of the pending command, which State fills in as the command is processed.
+        //Only valid while there is a pending command.
+        inline CommandTimestamps& getCommandTimestamps() {
+            return _commandTimestamps[_commandsBegin];
+        }
         
-        void reply(const Response &resp);
+        //queue a reply to the pending command (or a comment, if @resp.isComment()).
+        //If the command was numbered, a bare "ok" is extended to "ok N<line> P<@numFreePlannerSlots> B<free command slots>".
+        //The reply is buffered; it won't be seen by the host until flush() is called or the buffer fills.
+        void reply(const Response &resp, unsigned numFreePlannerSlots=0);
+        //write all buffered replies to the output stream.
+        //State calls this once per wide onIdleCpu interval.
+        void flush();
+    private:
+        inline bool isQueueFull() const {
+            return _numCommands == _commands.size();
+        }
+        //handle one received character, queueing the command once its line (or binary record) is complete
+        void receiveChar(char chr);
+        //parse the line in _pending, and pass it to acceptCommand
+        void acceptLine();
+        //handle one byte while in binary mode
+        void receiveBinary(uint8_t byte);
+        //validate a received command's line number, and add the command to the queue
+        void acceptCommand(Command &&cmd);
+        //reject a line that failed validation, and ask the host to resend everything after the last accepted line.
+        //  The rejection is queued behind any commands that haven't yet been replied to.
+        void requestResend(const char *reason);
+        //write the replies that reject a line, given the line number that was last accepted before it
+        void writeRejection(const char *reason, int32_t lastLineNumber);
+        //remove the oldest entry from _commands
+        void popCommand();
+        //forget everything received from a socket host that's no longer in control
+        void resetForNewController();
+        //forget the commands (and rejections) queued by a host that's no longer in control, other than one that's already executing
+        void dropQueuedCommands();
+        //format @resp into the write buffer
+        void write(const Response &resp);
         
             
 };
@@ -22,11 +22,13 @@
  */
 
 #include "command.h"
+#include <cstdio> //for snprintf
+#include <cstdlib> //for strtol
 
 namespace gparse {
 
 
-Command::Command(std::string const& cmd) : opcodeStr(0) {
+Command::Command(std::string const& cmd) : opcodeStr(0), lineNumber(-1), checksum(-1), computedChecksum(0) {
     arguments.fill(GPARSE_ARG_NOT_PRESENT); //initialize all arguments to default value
     //possible GCodes to handle:
     //N123 M105*nn
@@ -43,7 +45,13 @@ Command::Command(std::string const& cmd) : opcodeStr(0) {
     //skip leading spaces
     for(; it != cmd.end() && (*it == ' ' || *it == '\t'); ++it) {} 
     //Check for a line-number
-    if (cmd[0] == 'N' || cmd[0] == 'n') {
+    if (it != cmd.end() && (*it == 'N' || *it == 'n')) {
+        const char *numStart = cmd.c_str() + (it+1-cmd.begin());
+        char *afterNum;
+        long num = strtol(numStart, &afterNum, 10);
+        if (afterNum != numStart && num >= 0) {
+            lineNumber = num;
+        }
         do {
             ++it;
         } while (it != cmd.end() && *it != ' ' && *it != '\n' && *it != '\t' && *it != '*' && *it != ';');
@@ -60,6 +68,9 @@ Command::Command(std::string const& cmd) : opcodeStr(0) {
         for (; it != cmd.end() && (*it == ' ' || *it == '\t'); ++it) { //skip spaces
         }
         if (it == cmd.end() || *it == '*' || *it == ';' || *it == '\n') { //exit if end of line
+            if (it != cmd.end() && *it == '*') {
+                parseChecksum(cmd, it);
+            }
             return;
         }
         //now at a LETTER, assuming valid command.
@@ -105,6 +116,28 @@ Command::Command(std::string const& cmd) : opcodeStr(0) {
     }
 }
 
+void Command::parseChecksum(std::string const& cmd, std::string::const_iterator star) {
+    //the checksum is the xor of every character before the '*'
+    for (std::string::const_iterator it=cmd.begin(); it != star; ++it) {
+        computedChecksum ^= (uint8_t)*it;
+    }
+    const char *numStart = cmd.c_str() + (star+1-cmd.begin());
+    char *afterNum;
+    long num = strtol(numStart, &afterNum, 10);
+    //a '*' without a number is still a (failed) checksum
+    checksum = (afterNum != numStart && num >= 0 && num <= 255) ? num : 256;
+}
+
+Command::Command(char letter, unsigned number) : opcodeStr(upper(letter)), lineNumber(-1), checksum(-1), computedChecksum(0) {
+    arguments.fill(GPARSE_ARG_NOT_PRESENT);
+    //append the decimal digits, most significant first, exactly as if they had been parsed from text
+    char digits[12];
+    int numDigits = snprintf(digits, sizeof(digits), "%u", number);
+    for (int i=0; i<numDigits; ++i) {
+        opcodeStr = (opcodeStr << 8) + digits[i];
+    }
+}
+
 bool Command::isFirstChar(char c) const {
     //Check if the first character of the opcode is `c'
     char s[4];
@@ -125,8 +158,12 @@ bool Command::isFirstChar(char c) const {
 }
 
 std::string Command::getOpcode() const {
-    //return opcode;
-    std::string ret;
+    char s[5];
+    getOpcode(s);
+    return std::string(s);
+}
+
+void Command::getOpcode(char dest[5]) const {
     char s[4];
     //extract bytes from opcodeStr.
     //cannot just cast to char* due to endianness.
@@ -134,28 +171,55 @@ std::string Command::getOpcode() const {
     s[1] = (char)((opcodeStr & 0xff0000u) >> 16);
     s[2] = (char)((opcodeStr & 0xff00u) >> 8);
     s[3] = (char)(opcodeStr & 0xffu);
+    std::size_t len = 0;
     for (int i=0; i<4; ++i) {
-        if (s[i]) { //add non-zero characters to the string
-            ret += s[i];
+        if (s[i]) { //copy the non-zero characters
+            dest[len++] = s[i];
         }
     }
-    return ret;
+    dest[len] = '\0';
 }
 
 std::string Command::toGCode() const {
-    std::string r=getOpcode();
+    //measure, then format directly into the string
+    std::string r(toGCode(nullptr, 0), '\0');
+    toGCode(&r[0], r.size()+1);
+    return r;
+}
+
+std::size_t Command::toGCode(char *dest, std::size_t size) const {
+    std::size_t len = 0;
+    //append to dest, tracking the full length even after the output is truncated
+    auto append = [&](int written) {
+        if (written > 0) {
+            len += written;
+        }
+    };
+    auto remaining = [&]() {
+        return len < size ? size - len : 0;
+    };
+    auto at = [&]() {
+        return len < size ? dest + len : nullptr;
+    };
+    if (size) {
+        dest[0] = '\0';
+    }
+    for (int i=3; i>=0; --i) {
+        //add non-zero characters of the opcode
+        char c = (char)((opcodeStr >> (8*i)) & 0xffu);
+        if (c) {
+            append(snprintf(at(), remaining(), "%c", c));
+        }
+    }
     for (char c='A'; c<='Z'; ++c) {
         if (hasParam(c)) {
-            r += ' ';
-            r += c;
-            r += std::to_string(getFloatParam(c));
+            append(snprintf(at(), remaining(), " %c%f", c, getFloatParam(c)));
         }
     }
     if (!getSpecialStringParam().empty()) {
-        r += ' ';
-        r += getSpecialStringParam();
+        append(snprintf(at(), remaining(), " %s", getSpecialStringParam().c_str()));
     }
-    return r;
+    return len;
 }
 
 bool Command::hasParam(char label) const {
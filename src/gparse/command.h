@@ -23,7 +23,7 @@
  
 
 /*#List of commands on Reprap Wiki:
-cmds = ['G0', 'G1', 'G2', 'G3', 'G4', 'G10', 'G20', 'G21', 'G28', 'G29', 'G30', 'G31', 'G32', 'G90', 'G91', 'G92', 'M0', 'M1', 'M3', 'M4', 'M5', 'M7', 'M8', 'M9', 'M10', 'M11', 'M17', 'M18', 'M20', 'M21', 'M22', 'M23', 'M24', 'M25', 'M26', 'M27', 'M28', 'M29', 'M30', 'M32', 'M40', 'M41', 'M42', 'M43', 'M80', 'M81', 'M82', 'M83', 'M84', 'M92', 'M98', 'M99', 'M103', 'M104', 'M105', 'M106', 'M107', 'M108', 'M109', 'M110', 'M111', 'M112', 'M113', 'M114', 'M115', 'M116', 'M117', 'M118', 'M119', 'M120', 'M121', 'M122', 'M123', 'M124', 'M126', 'M127', 'M128', 'M129', 'M130', 'M131', 'M132', 'M133', 'M134', 'M135', 'M136', 'M140', 'M141', 'M142', 'M143', 'M144', 'M160', 'M190', 'M200', 'M201', 'M202', 'M203', 'M204', 'M205', 'M206', 'M207', 'M208', 'M209', 'M210', 'M220', 'M221', 'M226', 'M227', 'M228', 'M229', 'M230', 'M240', 'M241', 'M245', 'M246', 'M280', 'M300', 'M301', 'M302', 'M303', 'M304', 'M305', 'M400', 'M420', 'M540', 'M550', 'M551', 'M552', 'M553', 'M554', 'M555', 'M556', 'M557', 'M558', 'M559', 'M560', 'M561', 'M562', 'M563', 'M564', 'M565', 'M566', 'M567', 'M568', 'M569', 'M665', 'M906', 'M998', 'M999']
+cmds = ['G0', 'G1', 'G2', 'G3', 'G4', 'G10', 'G20', 'G21', 'G28', 'G29', 'G30', 'G31', 'G32', 'G90', 'G91', 'G92', 'M0', 'M1', 'M3', 'M4', 'M5', 'M7', 'M8', 'M9', 'M10', 'M11', 'M17', 'M18', 'M20', 'M21', 'M22', 'M23', 'M24', 'M25', 'M26', 'M27', 'M28', 'M29', 'M30', 'M32', 'M40', 'M41', 'M42', 'M43', 'M80', 'M81', 'M82', 'M83', 'M84', 'M92', 'M98', 'M99', 'M103', 'M104', 'M105', 'M106', 'M107', 'M108', 'M109', 'M110', 'M111', 'M112', 'M113', 'M114', 'M115', 'M116', 'M117', 'M118', 'M119', 'M120', 'M121', 'M122', 'M123', 'M124', 'M126', 'M127', 'M128', 'M129', 'M130', 'M131', 'M132', 'M133', 'M134', 'M135', 'M136', 'M140', 'M141', 'M142', 'M143', 'M144', 'M160', 'M190', 'M200', 'M201', 'M202', 'M203', 'M204', 'M205', 'M206', 'M207', 'M208', 'M209', 'M210', 'M220', 'M221', 'M226', 'M227', 'M228', 'M229', 'M230', 'M240', 'M241', 'M245', 'M246', 'M280', 'M300', 'M301', 'M302', 'M303', 'M304', 'M305', 'M400', 'M420', 'M540', 'M550', 'M551', 'M552', 'M553', 'M554', 'M555', 'M556', 'M557', 'M558', 'M559', 'M560', 'M561', 'M562', 'M563', 'M564', 'M565', 'M566', 'M567', 'M568', 'M569', 'M665', 'M880', 'M881', 'M906', 'M998', 'M999']
 #code to generate isXXXX() functions:
 arguments = [", ".join("'%s'" %c for c in cmd) for cmd in cmds]
 funcs = ["inline bool is%s() const { return isOpcode(bigEndianStr(%s)); }" %(cmd, args) for (cmd, args) in zip(cmds, arguments)]
@@ -37,6 +37,7 @@ print pretty
 #include <string>
 #include <array>
 #include <cstdint> //for uint32_t
+#include <cstddef> //for size_t
 #include <cmath> //for NAN
 #define GPARSE_ARG_NOT_PRESENT NAN
 
@@ -79,19 +80,56 @@ class Command {
     //format: M117 Message To Display
     //both of these are valid commands, and the ONLY way to reliably parse M117 is to detect the opcode, and then store everything that follows (up until a comment) into one string.
     std::string specialStringParam;
+    //Hosts that stream several lines at once prefix each line with a line number (N123) and suffix it with a checksum (*71),
+    //  so that corrupted or dropped lines can be detected & resent.
+    //lineNumber and checksum are -1 if not present in the line.
+    int32_t lineNumber;
+    int32_t checksum;
+    //xor of every character in the line preceding the '*'
+    uint8_t computedChecksum;
     public:
         //default initialization. All parameters will be initialized to GPARSE_ARG_NOT_PRESENT (typically NaN)
-        inline Command() : opcodeStr(0) {
+        inline Command() : opcodeStr(0), lineNumber(-1), checksum(-1), computedChecksum(0) {
             arguments.fill(GPARSE_ARG_NOT_PRESENT); //initialize all arguments to default value
         }
         //initialize the command object from a line of GCode
         Command(std::string const&);
+        //initialize a command with the given opcode (e.g. 'G', 1 for G1) and no parameters.
+        //Used to build commands from the binary protocol without going through text.
+        Command(char letter, unsigned number);
         inline bool empty() const {
             return opcodeStr == 0;
         }
         std::string getOpcode() const;
+        //write the opcode (at most 4 characters, e.g. "M105") and a null terminator into @dest.
+        //Unlike the std::string version, this never allocates.
+        void getOpcode(char dest[5]) const;
         std::string toGCode() const;
+        //write the gcode representation of this command into @dest, which has room for @size characters (including null terminator).
+        //Returns the length of the full representation, which may be >= @size if it was truncated (same semantics as snprintf).
+        //Unlike the std::string version, this never allocates.
+        std::size_t toGCode(char *dest, std::size_t size) const;
         bool hasParam(char label) const;
+        //set a parameter. Setting it to GPARSE_ARG_NOT_PRESENT (NaN) leaves it absent.
+        inline void setParam(char label, float value) {
+            setArgument(label, value);
+        }
+        inline void setLineNumber(int32_t number) {
+            lineNumber = number;
+        }
+        inline bool hasLineNumber() const {
+            return lineNumber >= 0;
+        }
+        inline int32_t getLineNumber() const {
+            return lineNumber;
+        }
+        inline bool hasChecksum() const {
+            return checksum >= 0;
+        }
+        //returns true if the line had no checksum, or if the checksum matches the line's contents
+        inline bool isChecksumValid() const {
+            return !hasChecksum() || checksum == computedChecksum;
+        }
 
         // get a param, or @def if it wasn't set in this gcode command
         float getFloatParam(char label, float def) const;
@@ -358,6 +396,8 @@ class Command {
         inline bool isM568() const { return isOpcode(bigEndianStr('M', '5', '6', '8')); }
         inline bool isM569() const { return isOpcode(bigEndianStr('M', '5', '6', '9')); }
         inline bool isM665() const { return isOpcode(bigEndianStr('M', '6', '6', '5')); }
+        inline bool isM880() const { return isOpcode(bigEndianStr('M', '8', '8', '0')); }
+        inline bool isM881() const { return isOpcode(bigEndianStr('M', '8', '8', '1')); }
         inline bool isM906() const { return isOpcode(bigEndianStr('M', '9', '0', '6')); }
         inline bool isM998() const { return isOpcode(bigEndianStr('M', '9', '9', '8')); }
         inline bool isM999() const { return isOpcode(bigEndianStr('M', '9', '9', '9')); }
@@ -387,6 +427,7 @@ class Command {
             return duty;
         }
         bool isFirstChar(char c) const;
+        void parseChecksum(std::string const& cmd, std::string::const_iterator star);
 };
 
 }
@@ -26,8 +26,11 @@
 #define GPARSE_RESPONSE_H
 
 #include <string>
-#include <sstream>
+#include <array>
+#include <cstdio> //for snprintf
+#include <cstdarg> //for va_list
 #include <utility> //for std::pair
+#include <algorithm> //for std::min
 #include <initializer_list>
 
 namespace gparse {
@@ -35,78 +38,158 @@ namespace gparse {
 enum ResponseCode {
     ResponseOk,
     ResponseWarning,
+    //"Error:..." and "Resend: N" are sent when a line fails its line-number or checksum validation
+    ResponseError,
+    ResponseResend,
 };
 
 /* 
- * Response objects encapsulate a single response from the client (us) to a gcode Command sent by the host.
- * When converted to strings, they typically appear like "ok" or "ok T:153.7"
- *
- * It was decided to make a thin wrapper around the raw string responses in order to standardize the 'ok', '!!' (error), etc response prefixes.
+ * Response represents a single line to be sent back to the host in reply to a Command.
+ * The text is stored in a fixed-size buffer so that constructing & formatting the standard responses never touches the heap.
+ * Text that doesn't fit in the buffer is truncated.
  */
 class Response {
-    ResponseCode code;
-    std::string rest;
+    public:
+        //maximum length of the text following the response code
+        static const std::size_t MAX_REST_LENGTH = 255;
+    private:
+        ResponseCode code;
+        std::array<char, MAX_REST_LENGTH+1> rest;
+        std::size_t restLength;
     public:
         // Response::Ok provides easy access to a response formatted as "ok"
         static const Response Ok;
 
-        //Construct a response from a code, followed by an optional extra string (implicitly joined by a space)
-        inline Response(ResponseCode code, const std::string &rest="") : code(code), rest(rest) {
-        }
         //Construct a response from a code, followed by an optional extra C string (implicitly joined by a space)
-        inline Response(ResponseCode code, const char* rest) : code(code), rest(rest) {
+        inline Response(ResponseCode code, const char* rest="") : code(code), restLength(0) {
+            this->rest[0] = '\0';
+            append(rest);
+        }
+        //Construct a response from a code, followed by an extra string (implicitly joined by a space)
+        inline Response(ResponseCode code, const std::string &rest) : code(code), restLength(0) {
+            this->rest[0] = '\0';
+            append(rest);
+        }
+
+        //Construct a response from a code, followed by printf-style formatted text.
+        //Example: Response::fromFormat(ResponseResend, "%i", lineNumber)
+        __attribute__ ((format (printf, 2, 3))) static inline Response fromFormat(ResponseCode code, const char *fmt, ...) {
+            Response resp(code);
+            va_list args;
+            va_start(args, fmt);
+            resp.appendFormattedV(fmt, args);
+            va_end(args);
+            return resp;
         }
 
         //Construct a response from a code, a set of Key:Value pairs, and then an extra string (all 3 are joined by spaced)
-        //@pairs is given as any container whose elements are std::pairs<std::string, std::string>,
+        //@pairs is given as any container whose elements are std::pairs<Key, Value>,
         //  in which std::pair::first is the key, and std::pair::second is the value.
-        template <typename Container> Response(ResponseCode code, const Container &pairs, const std::string &rest="")
-          : code(code), rest(joinPairsAndStr(pairs, rest)) {}
+        //  Keys and values may be strings, C strings, floats or integers; numbers are formatted without allocating.
+        template <typename Container> Response(ResponseCode code, const Container &pairs, const char *rest="")
+          : code(code), restLength(0) {
+            this->rest[0] = '\0';
+            joinPairsAndStr(pairs, rest);
+        }
 
         //Construct a response from a code and a set of Key:Value pairs (joined by a space)
-        //Allow construction, using an std::initializer_list of std::pair<std::string, std::string> (or const char*, etc) for @pairs.
-        //Example: Response(ResponseOk, {make_pair("T", "65"), make_pair("B", "20")})
+        //Allow construction, using an std::initializer_list of std::pair<const char*, T> for @pairs.
+        //Example: Response(ResponseOk, {make_pair("T", 65.f), make_pair("B", 20.f)})
         //This specialization is only needed in gcc-4.6, where automatic deduction of a std::initializer_list as Container would cause a warning in the other version
-        template <typename T> Response(ResponseCode code, std::initializer_list<T> pairs, const std::string &rest="")
-          : code(code), rest(joinPairsAndStr(pairs, rest)) {}
+        template <typename T> Response(ResponseCode code, std::initializer_list<T> pairs, const char *rest="")
+          : code(code), restLength(0) {
+            this->rest[0] = '\0';
+            joinPairsAndStr(pairs, rest);
+        }
 
-        //Convert the Response object to a string
-        //Note: no newline character is appended to the end; the string is a single line of text.
-        inline std::string toString() const {
+        //Write the response into @dest, which has room for @size characters (including the null terminator).
+        //Returns the length of the full response, which may be >= @size if the output was truncated (same semantics as snprintf).
+        //Note: no newline character is appended to the end; the text is a single line.
+        inline std::size_t format(char *dest, std::size_t size) const {
+            int len;
             switch (code) {
                 case ResponseOk:
-                    return "ok" + (rest.empty() ? "" : " " + rest);
+                    len = restLength ? snprintf(dest, size, "ok %s", rest.data()) : snprintf(dest, size, "ok");
+                    break;
                 case ResponseWarning:
-                    return "// warning: " + rest;
+                    len = snprintf(dest, size, "// warning: %s", rest.data());
+                    break;
+                case ResponseError:
+                    len = snprintf(dest, size, "Error:%s", rest.data());
+                    break;
+                case ResponseResend:
+                    len = snprintf(dest, size, "Resend: %s", rest.data());
+                    break;
                 default:
-                    return rest;
+                    len = snprintf(dest, size, "%s", rest.data());
+                    break;
             }
+            return len < 0 ? 0 : len;
+        }
+        //Convert the Response object to a string
+        //Note: no newline character is appended to the end; the string is a single line of text.
+        inline std::string toString() const {
+            std::array<char, MAX_REST_LENGTH+32> buffer;
+            format(buffer.data(), buffer.size());
+            return std::string(buffer.data());
         }
         //return true if the response represents a comment (a line starting with // ), which the host can safely ignore
         inline bool isComment() const {
             return code == ResponseWarning;
         }
+        //return true if the response is a bare "ok", with no extra text
+        inline bool isBareOk() const {
+            return code == ResponseOk && restLength == 0;
+        }
     private:
-        template <typename Container> std::string joinPairsAndStr(const Container &pairs, const std::string &append) {
-            std::ostringstream imploded;
+        template <typename Container> void joinPairsAndStr(const Container &pairs, const char *append) {
             bool first=true;
             for (const auto& elem : pairs) {
                 //to join each pair by a space, prepend each element EXCEPT the first with a space.
                 if (first) {
                     first = false;
                 } else {
-                    imploded << ' ';
+                    this->append(" ");
                 }
-                imploded << elem.first << ':' << elem.second;
+                this->append(elem.first);
+                this->append(":");
+                this->append(elem.second);
             }
-            if (!append.empty()) {
+            if (append[0] != '\0') {
                 if (!first) {
                     //join the two strings with a space, but only if neither of them are empty
-                    imploded << ' ';
+                    this->append(" ");
                 }
-                imploded << append;
+                this->append(append);
+            }
+        }
+        inline void append(const char *str) {
+            appendFormatted("%s", str);
+        }
+        inline void append(const std::string &str) {
+            append(str.c_str());
+        }
+        //Note: floats are formatted identically to std::to_string
+        inline void append(double value) {
+            appendFormatted("%f", value);
+        }
+        inline void append(int value) {
+            appendFormatted("%i", value);
+        }
+        //append printf-style formatted text to the end of rest, truncating if it doesn't fit.
+        __attribute__ ((format (printf, 2, 3))) inline void appendFormatted(const char *fmt, ...) {
+            va_list args;
+            va_start(args, fmt);
+            appendFormattedV(fmt, args);
+            va_end(args);
+        }
+        inline void appendFormattedV(const char *fmt, va_list args) {
+            std::size_t avail = rest.size() - restLength;
+            int len = vsnprintf(rest.data() + restLength, avail, fmt, args);
+            if (len > 0) {
+                //if truncated, the buffer is full (less the null terminator)
+                restLength += std::min((std::size_t)len, avail-1);
             }
-            return imploded.str();
         }
 };
 
@@ -0,0 +1,171 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "unixsocketserver.h"
+
+#include <stdexcept> //for runtime_error
+#include <cstring> //for strerror, strncpy
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h> //for sockaddr_un
+#include <unistd.h> //for close, unlink
+#include <fcntl.h> //for O_NONBLOCK
+#include "common/logging.h"
+
+namespace gparse {
+
+UnixSocketServer::UnixSocketServer(const std::string &path, unsigned maxClients) 
+  : _path(path), _listenFd(-1), _maxClients(maxClients), _readBegin(0), _readEnd(0), _controllerChanged(false) {
+    struct sockaddr_un addr;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Unix socket path is too long: " + path);
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path)-1);
+
+    _listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (_listenFd == -1) {
+        throw std::runtime_error(std::string("Unable to create unix socket: ") + strerror(errno));
+    }
+    //remove any socket left over from a previous run
+    unlink(path.c_str());
+    if (bind(_listenFd, (struct sockaddr*)&addr, sizeof(addr)) == -1 || listen(_listenFd, maxClients) == -1) {
+        int err = errno;
+        close(_listenFd);
+        throw std::runtime_error("Unable to listen on unix socket " + path + ": " + strerror(err));
+    }
+    _clientFds.reserve(maxClients);
+    //room for plenty of replies, so that a slow controlling host doesn't cause allocations in the event loop
+    _pendingOutput.reserve(16*1024);
+    LOG("Listening for hosts on unix socket %s\n", path.c_str());
+}
+
+UnixSocketServer::~UnixSocketServer() {
+    for (int fd : _clientFds) {
+        close(fd);
+    }
+    if (_listenFd != -1) {
+        close(_listenFd);
+        unlink(_path.c_str());
+    }
+}
+
+void UnixSocketServer::tendClients() {
+    //accept all pending connections
+    int fd;
+    while ((fd = accept4(_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+        if (_clientFds.size() >= _maxClients) {
+            LOGW("Rejecting connection on %s; already have %zu clients\n", _path.c_str(), _clientFds.size());
+            close(fd);
+        } else {
+            LOG("Host connected on %s as %s\n", _path.c_str(), _clientFds.empty() ? "the controlling host" : "a read-only monitor");
+            _clientFds.push_back(fd);
+        }
+    }
+    //monitors are read-only; discard what they send, but notice when they hang up
+    for (std::size_t i=1; i<_clientFds.size(); ) {
+        char discard[64];
+        ssize_t numRead = recv(_clientFds[i], discard, sizeof(discard), MSG_DONTWAIT);
+        if (numRead == 0 || (numRead == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            disconnect(i);
+        } else if (numRead <= 0) {
+            ++i;
+        }
+        //else, read more from the same monitor
+    }
+    sendPendingOutput();
+}
+
+bool UnixSocketServer::getChar(char &chr) {
+    if (_readBegin == _readEnd) {
+        if (_clientFds.empty()) {
+            return false;
+        }
+        ssize_t numRead = recv(_clientFds[0], _readBuffer.data(), _readBuffer.size(), MSG_DONTWAIT);
+        if (numRead > 0) {
+            _readBegin = 0;
+            _readEnd = numRead;
+        } else {
+            if (numRead == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                //controlling host hung up
+                disconnect(0);
+            }
+            return false;
+        }
+    }
+    chr = _readBuffer[_readBegin++];
+    return true;
+}
+
+void UnixSocketServer::write(const char *data, std::size_t length) {
+    //monitors first, so that if the controlling host turns out to have hung up, the monitor promoted in its place has still seen this data
+    for (std::size_t i=1; i<_clientFds.size(); ) {
+        //MSG_NOSIGNAL: if the client has hung up, get EPIPE rather than a SIGPIPE
+        ssize_t numWritten = send(_clientFds[i], data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (numWritten == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            disconnect(i);
+            continue;
+        } else if (numWritten != (ssize_t)length) {
+            LOGW("Unix socket monitor %zu isn't keeping up; %zu bytes of output were lost\n", i, length - (numWritten < 0 ? 0 : numWritten));
+        }
+        ++i;
+    }
+    if (!_clientFds.empty()) {
+        //the controlling host mustn't miss any replies, and they must arrive in order
+        _pendingOutput.insert(_pendingOutput.end(), data, data+length);
+        sendPendingOutput();
+    }
+}
+
+void UnixSocketServer::sendPendingOutput() {
+    if (_pendingOutput.empty() || _clientFds.empty()) {
+        return;
+    }
+    ssize_t numWritten = send(_clientFds[0], _pendingOutput.data(), _pendingOutput.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (numWritten == -1) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            disconnect(0);
+        }
+    } else {
+        _pendingOutput.erase(_pendingOutput.begin(), _pendingOutput.begin() + numWritten);
+    }
+}
+
+void UnixSocketServer::disconnect(std::size_t clientIdx) {
+    LOG("Host disconnected from %s\n", _path.c_str());
+    close(_clientFds[clientIdx]);
+    _clientFds.erase(_clientFds.begin() + clientIdx);
+    if (clientIdx == 0) {
+        //any partial line from the old controlling host is meaningless to the new one
+        _readBegin = _readEnd = 0;
+        //likewise for output that was meant for the old controlling host
+        _pendingOutput.clear();
+        _controllerChanged = true;
+        if (!_clientFds.empty()) {
+            LOG("Promoting the oldest monitor on %s to the controlling host\n", _path.c_str());
+        }
+    }
+}
+
+}
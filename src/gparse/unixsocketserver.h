@@ -0,0 +1,116 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GPARSE_UNIXSOCKETSERVER_H
+#define GPARSE_UNIXSOCKETSERVER_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <cstddef> //for size_t
+
+namespace gparse {
+
+/* 
+ * UnixSocketServer listens on an AF_UNIX stream socket, allowing hosts (e.g. Octoprint) to connect to Printipi directly,
+ *   rather than through a pty pair created by an external program like socat.
+ * Multiple clients may be connected at once:
+ *   The oldest connection is the controlling host; only its input is read as gcode.
+ *   All other connections are read-only monitors: they receive a copy of everything sent to the controlling host,
+ *   and anything they send is discarded. When the controlling host disconnects, the oldest monitor takes its place.
+ * All socket I/O is non-blocking, so that the event loop is never stalled by a client.
+ *   The controlling host waits for a reply to every command, so output it can't yet accept is kept and retried later;
+ *   monitors that can't keep up just miss some output.
+ */
+class UnixSocketServer {
+    std::string _path;
+    int _listenFd;
+    //connected clients, oldest first. _clientFds[0] is the controlling host.
+    std::vector<int> _clientFds;
+    unsigned _maxClients;
+    //data received from the controlling host that hasn't yet been consumed by getChar
+    std::array<char, 512> _readBuffer;
+    std::size_t _readBegin, _readEnd;
+    //output for the controlling host that its socket couldn't yet accept, to be sent before anything newer
+    std::vector<char> _pendingOutput;
+    //set when the controlling host disconnects; see takeControllerChanged
+    bool _controllerChanged;
+    public:
+        //Create the socket at @path (replacing any stale socket file) and begin listening.
+        //throws std::runtime_error on failure.
+        UnixSocketServer(const std::string &path, unsigned maxClients=8);
+        //disconnect all clients and remove the socket file
+        ~UnixSocketServer();
+        UnixSocketServer(const UnixSocketServer &) = delete;
+        UnixSocketServer& operator=(const UnixSocketServer &) = delete;
+
+        //accept any pending connections, discard input from the monitors (noticing any that have disconnected),
+        //  and retry sending any output the controlling host couldn't yet accept.
+        void tendClients();
+        //read the next character sent by the controlling host.
+        //returns false if none is available without blocking.
+        bool getChar(char &chr);
+        //send @data to the controlling host and every monitor.
+        //If the controlling host's socket buffer is full, the remainder is kept and sent by later calls to write or tendClients.
+        //Monitors whose socket buffers are full miss this data (a warning is logged); clients that have hung up are disconnected.
+        void write(const char *data, std::size_t length);
+
+        inline const std::string& path() const {
+            return _path;
+        }
+        inline int listenFd() const {
+            return _listenFd;
+        }
+        //file descriptors of all connected clients; the first is the controlling host.
+        inline const std::vector<int>& clientFds() const {
+            return _clientFds;
+        }
+        inline bool hasController() const {
+            return !_clientFds.empty();
+        }
+        //returns true if data from the controlling host has been received but not yet consumed by getChar.
+        //  Such data won't cause any fd to poll as readable.
+        inline bool hasBufferedInput() const {
+            return _readBegin != _readEnd;
+        }
+        //returns true if some output couldn't yet be sent to the controlling host.
+        //  tendClients should then be called once its fd polls as writable (POLLOUT).
+        inline bool hasPendingOutput() const {
+            return !_pendingOutput.empty();
+        }
+        //returns true (once) if the controlling host has disconnected since the last call,
+        //  in which case any partially-received line should be discarded.
+        inline bool takeControllerChanged() {
+            bool changed = _controllerChanged;
+            _controllerChanged = false;
+            return changed;
+        }
+    private:
+        void disconnect(std::size_t clientIdx);
+        //send as much of _pendingOutput to the controlling host as its socket will accept
+        void sendPendingOutput();
+};
+
+}
+
+#endif
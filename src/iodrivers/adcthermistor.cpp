@@ -0,0 +1,176 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <memory> //for std::shared_ptr
+#include "adcthermistor.h"
+#include "ads1115.h"
+#include "mcp3008.h"
+#include "catch.hpp"
+
+using namespace iodrv;
+
+//in-process stand-in for drv::I2CBus, emulating an ADS1115 whose conversions complete instantly.
+//Registers are stored in device (big-endian) order and swapped on transfer, as SMBus does.
+//Every transfer fails while @isFailing is set.
+struct FakeI2CBus {
+    uint8_t address;
+    uint16_t conversion, config;
+    bool isFailing;
+    FakeI2CBus(uint16_t conversion) : address(0), conversion(conversion), config(0), isFailing(false) {}
+    static uint16_t swap(uint16_t word) {
+        return (uint16_t)((word << 8) | (word >> 8));
+    }
+    bool addressSet(uint8_t addr) {
+        address = addr;
+        return !isFailing;
+    }
+    bool writeShort(uint8_t command, uint16_t data) {
+        if (command == 0x01) {
+            config = swap(data);
+        }
+        return !isFailing;
+    }
+    int tryReadShort(uint8_t command) {
+        return isFailing ? -1 : swap(command == 0x00 ? conversion : config);
+    }
+};
+
+//emulates an MCP3008 whose every channel reads @counts
+struct FakeSpiBus {
+    int counts;
+    int lastChannel;
+    FakeSpiBus(int counts) : counts(counts), lastChannel(-1) {}
+    bool transfer(uint8_t *data, std::size_t length) {
+        if (length != 3 || data[0] != 0x01) {
+            return false;
+        }
+        lastChannel = (data[1] >> 4) & 0x7;
+        data[1] = (uint8_t)(counts >> 8);
+        data[2] = (uint8_t)counts;
+        return true;
+    }
+};
+
+struct FakeAdc {
+    float ratio;
+    bool read(float &r) {
+        r = ratio;
+        return true;
+    }
+};
+
+//ADC whose reads are released one at a time by the test, so that it knows exactly which readings the thermistor has seen.
+struct SteppedAdc {
+    struct State {
+        std::mutex mutex;
+        std::condition_variable cond;
+        int numStarted, numAllowed, numSteps;
+        bool isFailing, isReleased;
+        State() : numStarted(0), numAllowed(0), numSteps(0), isFailing(false), isReleased(false) {}
+        //let one read complete (failing or not), and wait until the thermistor has published its result
+        //  (i.e. until it begins the following read)
+        void step(bool fail) {
+            std::unique_lock<std::mutex> lock(mutex);
+            isFailing = fail;
+            ++numAllowed;
+            ++numSteps;
+            cond.notify_all();
+            cond.wait(lock, [this]() { return numStarted > numSteps; });
+        }
+        //let all further reads complete immediately, so that the thermistor can be stopped
+        void release() {
+            std::lock_guard<std::mutex> lock(mutex);
+            isReleased = true;
+            cond.notify_all();
+        }
+    };
+    std::shared_ptr<State> state;
+    bool read(float &r) {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        ++state->numStarted;
+        state->cond.notify_all();
+        state->cond.wait(lock, [this]() { return state->isReleased || state->numAllowed > 0; });
+        if (!state->isReleased) {
+            --state->numAllowed;
+        }
+        r = 0.5; //25 C
+        return !state->isFailing;
+    }
+};
+
+TEST_CASE("ADCs convert bus transfers to a ratio of Vref", "[adcthermistor]") {
+    float ratio = 0;
+    SECTION("ADS1115") {
+        Ads1115<FakeI2CBus> adc(FakeI2CBus(16384), 0x48, 1, 4.096);
+        REQUIRE(adc.read(ratio));
+        REQUIRE(ratio == Approx(0.5));
+        SECTION("bus failures are reported") {
+            FakeI2CBus failing(8192);
+            failing.isFailing = true;
+            Ads1115<FakeI2CBus> failingAdc(std::move(failing), 0x48, 1, 4.096);
+            REQUIRE(!failingAdc.read(ratio));
+            REQUIRE(ratio == Approx(0.5));
+        }
+    }
+    SECTION("MCP3008") {
+        Mcp3008<FakeSpiBus> adc(FakeSpiBus(768), 5);
+        REQUIRE(adc.read(ratio));
+        REQUIRE(ratio == Approx(0.75));
+    }
+}
+
+TEST_CASE("AdcThermistor publishes readings from its worker thread", "[adcthermistor]") {
+    //with the thermistor equal to Rseries, it's at T0
+    AdcThermistor<FakeAdc> therm(FakeAdc{0.5}, 4700, 25, 4700, 3950, std::chrono::milliseconds(1));
+    auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (therm.value() <= mathutil::ABSOLUTE_ZERO_CELCIUS && std::chrono::steady_clock::now() < timeout) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    REQUIRE(therm.value() == Approx(25));
+}
+
+TEST_CASE("AdcThermistor rides out failed reads, but not a dead ADC", "[adcthermistor]") {
+    std::shared_ptr<SteppedAdc::State> state(new SteppedAdc::State());
+    AdcThermistor<SteppedAdc> therm(SteppedAdc{state}, 4700, 25, 4700, 3950, std::chrono::milliseconds(1));
+    //destroyed before the thermistor, so that its worker isn't left waiting on a read
+    struct Releaser {
+        std::shared_ptr<SteppedAdc::State> state;
+        ~Releaser() { state->release(); }
+    } releaser{state};
+
+    state->step(false);
+    REQUIRE(therm.value() == Approx(25));
+    for (int i=1; i<AdcThermistor<SteppedAdc>::MAX_FAILED_READS; ++i) {
+        state->step(true);
+        REQUIRE(therm.value() == Approx(25));
+    }
+    SECTION("a good read resets the failure count") {
+        state->step(false);
+        state->step(true);
+        REQUIRE(therm.value() == Approx(25));
+    }
+    SECTION("sustained failure reads as absolute zero") {
+        state->step(true);
+        REQUIRE(therm.value() == mathutil::ABSOLUTE_ZERO_CELCIUS);
+    }
+}
@@ -0,0 +1,169 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IODRIVERS_ADCTHERMISTOR_H
+#define IODRIVERS_ADCTHERMISTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <memory> //for std::unique_ptr
+#include <mutex>
+#include <thread>
+#include <utility> //for std::move
+#include "compileflags.h" //for USE_PTHREAD
+#if USE_PTHREAD
+    #include <pthread.h> //for pthread_setschedparam
+#endif
+#include "iodriver.h"
+#include "common/mathutil.h" //for CtoK, etc
+#include "common/logging.h"
+
+namespace iodrv {
+
+/*
+ * AdcThermistor measures a thermistor through an external ADC (e.g. Ads1115 or Mcp3008), for use as the Thermistor of a TempControl.
+ *
+ *          Vref
+ *           \
+ *           / Rseries
+ *           \
+ *           +-----o ADC input
+ *           \
+ *           / therm
+ *           \
+ *          GND
+ *
+ * Bus transactions block (an I2C/SPI ioctl can take hundreds of microseconds), so the ADC is read on a separate, low-priority thread.
+ *   Each reading is converted to a temperature there and published atomically, so value() never blocks the event loop.
+ * A failed read (e.g. a transient bus error) keeps the last good temperature, unless MAX_FAILED_READS fail in a row,
+ *   after which the temperature is reported as absolute zero (the error value), upon which TempControl turns the heater off.
+ *
+ * AdcT must provide:
+ *   bool read(float &ratio): perform one (blocking) conversion and set @ratio to the input voltage as a proportion of Vref.
+ *     Returns false if the conversion failed.
+ * Because the worker thread owns the ADC, each AdcThermistor needs its own bus object.
+ */
+template <typename AdcT> class AdcThermistor : public IODriver {
+    public:
+        static const int MAX_FAILED_READS = 10;
+    private:
+    //state shared with the worker thread. Kept on the heap so that the driver remains movable.
+    struct Worker {
+        AdcT adc;
+        float Rseries;
+        //R0 = measured resistance at temperature T0 (in Ohms and Kelvin)
+        float T0, R0;
+        //Thermistor Beta value
+        float B;
+        std::chrono::steady_clock::duration readInterval;
+        std::atomic<float> lastTemp;
+        std::atomic<bool> isStopping;
+        std::mutex stopMutex;
+        std::condition_variable stopCond;
+        std::thread thread;
+
+        Worker(AdcT &&adc, float Rseries, float T0, float R0, float B, std::chrono::steady_clock::duration readInterval)
+          : adc(std::move(adc)), Rseries(Rseries), T0(T0), R0(R0), B(B), readInterval(readInterval),
+            lastTemp(mathutil::ABSOLUTE_ZERO_CELCIUS), isStopping(false) {}
+        void run() {
+            #if USE_PTHREAD
+                //the driver may have been created from a real-time thread; it must never compete with it.
+                struct sched_param sp;
+                sp.sched_priority = 0;
+                pthread_setschedparam(pthread_self(), SCHED_OTHER, &sp);
+            #endif
+            std::unique_lock<std::mutex> lock(stopMutex);
+            int numFailedReads = 0;
+            while (!isStopping.load()) {
+                float ratio;
+                if (adc.read(ratio)) {
+                    numFailedReads = 0;
+                    lastTemp.store(temperatureFromRatio(ratio));
+                } else if (++numFailedReads < MAX_FAILED_READS) {
+                    LOGW("AdcThermistor failed to read the ADC; keeping the last temperature\n");
+                } else {
+                    LOGE("AdcThermistor failed to read the ADC %i times in a row\n", numFailedReads);
+                    lastTemp.store(mathutil::ABSOLUTE_ZERO_CELCIUS);
+                }
+                stopCond.wait_for(lock, readInterval, [this]() { return isStopping.load(); });
+            }
+        }
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(stopMutex);
+                isStopping.store(true);
+            }
+            stopCond.notify_all();
+            thread.join();
+        }
+        float temperatureFromRatio(float ratio) const {
+            if (ratio <= 0 || ratio >= 1) {
+                //either the thermistor or Rseries is shorted/disconnected
+                LOGW("AdcThermistor reading out of range: %f\n", ratio);
+                return mathutil::ABSOLUTE_ZERO_CELCIUS;
+            }
+            float R = Rseries * ratio / (1-ratio);
+            float K = 1. / (1./T0 + log(R/R0)/B);
+            return mathutil::KtoC(K);
+        }
+    };
+    std::unique_ptr<Worker> _worker;
+    public:
+        //@adc the ADC channel connected to the thermistor
+        //@RSERIES_OHMS the resistor between the thermistor and the ADC's reference voltage
+        //@T0_C, @R0_OHMS, @BETA thermistor parameters (listed on thermistor packaging or documentation page)
+        //@readInterval how often to read the ADC
+        inline AdcThermistor(AdcT &&adc, float RSERIES_OHMS, float T0_C, float R0_OHMS, float BETA,
+            std::chrono::steady_clock::duration readInterval=std::chrono::milliseconds(100))
+          : _worker(new Worker(std::move(adc), RSERIES_OHMS, mathutil::CtoK(T0_C), R0_OHMS, BETA, readInterval)) {
+            _worker->thread = std::thread(&Worker::run, _worker.get());
+        }
+        AdcThermistor(AdcThermistor &&) = default;
+        AdcThermistor& operator=(AdcThermistor &&other) {
+            if (_worker) {
+                _worker->stop();
+            }
+            _worker = std::move(other._worker);
+            return *this;
+        }
+        inline ~AdcThermistor() {
+            if (_worker) {
+                _worker->stop();
+            }
+        }
+        //the latest temperature read by the worker thread,
+        //  or absolute zero if there hasn't been one yet, the reading was out of range or the ADC keeps failing to read
+        inline float value() const {
+            return _worker->lastTemp.load();
+        }
+        //all reading is done on the worker thread, so onIdleCpu never has work to do.
+        inline EventClockT::time_point nextIdleCpuDeadline() const {
+            return EventClockT::time_point::max();
+        }
+};
+
+}
+
+#endif
@@ -0,0 +1,102 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IODRIVERS_ADS1115_H
+#define IODRIVERS_ADS1115_H
+
+#include <chrono>
+#include <cstdint>
+#include <thread> //for std::this_thread::sleep_for
+#include <utility> //for std::move
+#include "i2cbus.h" //for drv::I2CBus
+
+namespace iodrv {
+
+/*
+ * Reads one single-ended channel of a TI ADS1115 16-bit I2C ADC, for use with AdcThermistor.
+ * Each read() starts a single-shot conversion and waits for it to complete, so it should only be called from a worker thread.
+ *
+ * BusT must provide the addressSet, writeShort and tryReadShort members of drv::I2CBus (lib/i2cbus.h), which report failed transfers.
+ *   Like SMBus, words are transferred least-significant byte first; the ADS1115 is big-endian, so they're swapped here.
+ */
+template <typename BusT=drv::I2CBus> class Ads1115 {
+    static const uint8_t REG_CONVERSION = 0x00;
+    static const uint8_t REG_CONFIG = 0x01;
+    //config register fields
+    static const uint16_t CONFIG_OS_SINGLE = 0x8000; //write: begin a conversion. read: 1 if no conversion is in progress
+    static const uint16_t CONFIG_MUX_SINGLE_0 = 0x4000; //AIN0 vs GND; add (channel<<12) for the other channels
+    static const uint16_t CONFIG_PGA_4_096V = 0x0200; //+/-4.096V full scale
+    static const uint16_t CONFIG_MODE_SINGLE = 0x0100;
+    static const uint16_t CONFIG_DR_860SPS = 0x00e0;
+    static const uint16_t CONFIG_COMP_DISABLE = 0x0003;
+    static constexpr float FULL_SCALE_V = 4.096f;
+    //a conversion at 860 samples/sec takes 1.16 ms
+    static constexpr std::chrono::microseconds CONVERSION_TIME = std::chrono::microseconds(1200);
+    static const int MAX_POLLS = 10;
+
+    BusT _bus;
+    uint8_t _address;
+    int _channel;
+    float _vref;
+    public:
+        //@bus an I2C bus that has already been opened (drv::I2CBus::busSet)
+        //@address the device address (0x48-0x4b, depending on the ADDR pin)
+        //@channel the input to read (0-3)
+        //@vref the voltage that the measured divider is referenced to (usually the ADS1115 supply voltage)
+        inline Ads1115(BusT &&bus, uint8_t address, int channel, float vref)
+          : _bus(std::move(bus)), _address(address), _channel(channel), _vref(vref) {}
+        //@return false if any bus transfer failed or the conversion never completed, in which case @ratio is left unchanged.
+        inline bool read(float &ratio) {
+            uint16_t config = CONFIG_OS_SINGLE | (CONFIG_MUX_SINGLE_0 + (_channel << 12)) | CONFIG_PGA_4_096V
+                | CONFIG_MODE_SINGLE | CONFIG_DR_860SPS | CONFIG_COMP_DISABLE;
+            if (!_bus.addressSet(_address) || !_bus.writeShort(REG_CONFIG, swapBytes(config))) {
+                return false;
+            }
+            for (int i=0; i<MAX_POLLS; ++i) {
+                std::this_thread::sleep_for(CONVERSION_TIME);
+                int status = _bus.tryReadShort(REG_CONFIG);
+                if (status < 0) {
+                    return false;
+                }
+                if (swapBytes(status) & CONFIG_OS_SINGLE) {
+                    int counts = _bus.tryReadShort(REG_CONVERSION);
+                    if (counts < 0) {
+                        return false;
+                    }
+                    ratio = (int16_t)swapBytes(counts) * (FULL_SCALE_V / 32768) / _vref;
+                    return true;
+                }
+            }
+            return false; //conversion never completed
+        }
+    private:
+        static inline uint16_t swapBytes(uint16_t word) {
+            return (uint16_t)((word << 8) | (word >> 8));
+        }
+};
+
+template <typename BusT> constexpr std::chrono::microseconds Ads1115<BusT>::CONVERSION_TIME;
+
+}
+
+#endif
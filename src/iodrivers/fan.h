@@ -39,6 +39,7 @@ class Fan : public IODriver {
     IoPin pin;
     float multiplier;
     EventClockT::duration period;
+    float dutyCycle;
     public:
         //@pin the IoPin that powers the fan.
         //  In most cases, the fan should NOT be directly powered from the microcontroller. 
@@ -50,16 +51,19 @@ class Fan : public IODriver {
         //@period the desired cycle length (in seconds) to use for PWM control. Most users will be happy keeping this at the default, 0.
         //  This is useful if using a transistor that cannot switch fast (like a relay).
         inline Fan(IoPin &&pin, DefaultIoState defaultState=IO_DEFAULT_NONE, float multiplier=1.0, EventClockT::duration period=EventClockT::duration())
-          : pin(std::move(pin)), multiplier(multiplier), period(period) {
+          : pin(std::move(pin)), multiplier(multiplier), period(period), dutyCycle(0) {
             this->pin.setDefaultState(defaultState);
             this->pin.makePwmOutput(0.0);
         }
         inline bool isFan() const { return true; }
         //called by State upon receiving an M106 gcode
         inline void setFanDutyCycle(float dutyCycle) {
-            (void)dutyCycle;
+            this->dutyCycle = dutyCycle;
             pin.pwmWrite(dutyCycle*multiplier, period);
         }
+        inline float getFanDutyCycle() const {
+            return dutyCycle;
+        }
 };
 
 }
@@ -27,6 +27,7 @@
 
 #include <cassert> //for assert
 #include <tuple> 
+#include <type_traits> //for std::is_same, std::remove_reference
 #include "schedulerbase.h" //for OnIdleCpuIntervalT
 #include "compileflags.h" //for CelciusType
 #include "common/tupleutil.h"
@@ -68,6 +69,11 @@ class IODriver {
             (void)dutyCycle;
             assert(false && "IoDriver::setFanDutyCycle() must be overriden by subclass");
         }
+        //OVERRIDE THIS (fans only): the duty cycle last given to setFanDutyCycle
+        inline float getFanDutyCycle() const {
+            assert(false && "IoDriver::getFanDutyCycle() must be overriden by subclass");
+            return 0; //for when assertions are disabled.
+        }
         //OVERRIDE THIS (hotends / beds only)
         inline void setTargetTemperature(CelciusType) { assert(false && "IoDriver::setTargetTemperature() must be overriden by subclass."); }
         //OVERRIDE THIS (hotends / beds only)
@@ -96,7 +102,37 @@ class IODriver {
             (void)interval;
             return false; 
         }
+        //@return the time at which onIdleCpu next has work to do, given that its last call returned false.
+        //IODrivers won't call onIdleCpu again before then, and the scheduler won't sleep past it.
+        //Drivers that don't override this have their onIdleCpu called on every interval.
+        inline EventClockT::time_point nextIdleCpuDeadline() const {
+            return EventClockT::time_point();
+        }
 };
 
+//Given pointers to IODriver::f and T::f, IsOverridden::value is true if T provides its own implementation of f.
+template <typename BaseMemberPtr, typename MemberPtr> struct IsOverridden : std::integral_constant<bool, 
+    !std::is_same<BaseMemberPtr, MemberPtr>::value> {};
+
+//The following traits determine the role of an IODriver type (which may be a reference) at compile time, 
+//  based on which parts of the IODriver interface it overrides.
+//This allows IODrivers to build its views (fans(), heaters(), etc) and to skip drivers in peekNextEvent without any runtime checks.
+//GeneratesEvents<T>::value is true if T may ever produce OutputEvents.
+template <typename T> struct GeneratesEvents : IsOverridden<decltype(&IODriver::peekNextEvent), 
+    decltype(&std::remove_reference<T>::type::peekNextEvent)> {};
+//HasIdleCpuWork<T>::value is true if T::onIdleCpu may do anything.
+template <typename T> struct HasIdleCpuWork : IsOverridden<decltype(&IODriver::onIdleCpu), 
+    decltype(&std::remove_reference<T>::type::onIdleCpu)> {};
+template <typename T> struct IsFanType : IsOverridden<decltype(&IODriver::isFan), 
+    decltype(&std::remove_reference<T>::type::isFan)> {};
+//Whether a heater controls a hotend or a heated bed may only be known at runtime, so both are grouped together.
+template <typename T> struct IsHeaterType : std::integral_constant<bool,
+    IsOverridden<decltype(&IODriver::isHotend), decltype(&std::remove_reference<T>::type::isHotend)>::value ||
+    IsOverridden<decltype(&IODriver::isHeatedBed), decltype(&std::remove_reference<T>::type::isHeatedBed)>::value> {};
+template <typename T> struct IsServoType : IsOverridden<decltype(&IODriver::isServo), 
+    decltype(&std::remove_reference<T>::type::isServo)> {};
+template <typename T> struct IsEndstopType : IsOverridden<decltype(&IODriver::isEndstop), 
+    decltype(&std::remove_reference<T>::type::isEndstop)> {};
+
 }
 #endif
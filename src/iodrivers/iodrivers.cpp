@@ -0,0 +1,78 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "iodrivers.h"
+#include "catch.hpp"
+
+using namespace iodrv;
+
+//requests more cpu time while busy, and otherwise reports a fixed deadline
+struct PeriodicDriver : public IODriver {
+    EventClockT::time_point deadline;
+    bool isBusy;
+    int numCalls;
+    PeriodicDriver(EventClockT::time_point deadline) : deadline(deadline), isBusy(false), numCalls(0) {}
+    bool onIdleCpu(OnIdleCpuIntervalT interval) {
+        (void)interval; //unused
+        ++numCalls;
+        return isBusy;
+    }
+    EventClockT::time_point nextIdleCpuDeadline() const {
+        return deadline;
+    }
+};
+
+TEST_CASE("IODrivers only calls onIdleCpu when it's due", "[iodrivers]") {
+    EventClockT::time_point later = EventClockT::now() + std::chrono::seconds(3600);
+    typedef IODrivers<std::tuple<IODriver, PeriodicDriver> > DriversT;
+    static_assert(std::is_same<DriversT::IdleCpuIndices, IndexList<1> >::value, "Only drivers that override onIdleCpu should be serviced");
+    DriversT drivers(std::make_tuple(IODriver(), PeriodicDriver(later)));
+    PeriodicDriver &periodic = std::get<1>(drivers.tuple());
+    SECTION("A waiting driver is called once, and then not until its deadline") {
+        REQUIRE(!drivers.onIdleCpu(OnIdleCpuIntervalWide));
+        REQUIRE(!drivers.onIdleCpu(OnIdleCpuIntervalShort));
+        REQUIRE(periodic.numCalls == 1);
+        bool isDeadlineReported = drivers.nextIdleCpuDeadline() == later;
+        REQUIRE(isDeadlineReported);
+    }
+    SECTION("A driver whose deadline has passed is called on every interval") {
+        periodic.deadline = EventClockT::time_point(std::chrono::seconds(1));
+        REQUIRE(!drivers.onIdleCpu(OnIdleCpuIntervalShort));
+        REQUIRE(!drivers.onIdleCpu(OnIdleCpuIntervalShort));
+        REQUIRE(periodic.numCalls == 2);
+        bool isDeadlineReported = drivers.nextIdleCpuDeadline() == periodic.deadline;
+        REQUIRE(isDeadlineReported);
+    }
+    SECTION("A busy driver is called on every interval, without limiting the scheduler's sleep") {
+        periodic.isBusy = true;
+        REQUIRE(drivers.onIdleCpu(OnIdleCpuIntervalShort));
+        REQUIRE(drivers.onIdleCpu(OnIdleCpuIntervalShort));
+        REQUIRE(periodic.numCalls == 2);
+        bool isUnlimited = drivers.nextIdleCpuDeadline() == EventClockT::time_point::max();
+        REQUIRE(isUnlimited);
+        periodic.isBusy = false;
+        REQUIRE(!drivers.onIdleCpu(OnIdleCpuIntervalShort));
+        REQUIRE(!drivers.onIdleCpu(OnIdleCpuIntervalShort));
+        REQUIRE(periodic.numCalls == 3);
+    }
+}
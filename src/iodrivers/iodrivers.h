@@ -26,9 +26,50 @@
 #define IODRIVERS_IODRIVERS_H
 
 #include <tuple>
+#include <array>
+#include <algorithm> //for std::min
+#include <utility> //for std::pair
+#include <type_traits> //for std::conditional, std::is_same
+#include "iodriver.h" //for GeneratesEvents, HasIdleCpuWork, IsFanType, etc
 
 namespace iodrv {
 
+namespace {
+    //helper for IndexList::contains, since C++11 constexpr functions can't contain loops
+    inline constexpr bool _IndexList__contains(std::size_t) {
+        return false;
+    }
+    template <typename ...Rest> constexpr bool _IndexList__contains(std::size_t idx, std::size_t first, Rest ...rest) {
+        return idx == first || _IndexList__contains(idx, rest...);
+    }
+}
+
+//A compile-time list of indices into a tuple of IODrivers
+template <std::size_t ...Is> struct IndexList {
+    static constexpr std::size_t size() {
+        return sizeof...(Is);
+    }
+    static constexpr bool contains(std::size_t idx) {
+        return _IndexList__contains(idx, Is...);
+    }
+    //@return the index at position @pos in the list, or @pastEnd if pos >= size()
+    static std::size_t at(std::size_t pos, std::size_t pastEnd) {
+        //pad with an extra item to avoid a zero-length array
+        static constexpr std::size_t indices[] = {Is..., 0};
+        return pos < size() ? indices[pos] : pastEnd;
+    }
+};
+
+//SelectIndices<N, Selector>::type is the IndexList of all indices I in [0, N) for which Selector::select<I>() is true
+template <std::size_t N, typename Selector, std::size_t Idx=0, typename Found=IndexList<>, bool AtEnd=(Idx == N)> struct SelectIndices;
+template <std::size_t N, typename Selector, std::size_t Idx, std::size_t ...Is> struct SelectIndices<N, Selector, Idx, IndexList<Is...>, true> {
+    typedef IndexList<Is...> type;
+};
+template <std::size_t N, typename Selector, std::size_t Idx, std::size_t ...Is> struct SelectIndices<N, Selector, Idx, IndexList<Is...>, false> {
+    typedef typename std::conditional<Selector::template select<Idx>(), IndexList<Is..., Idx>, IndexList<Is...> >::type Found;
+    typedef typename SelectIndices<N, Selector, Idx+1, Found>::type type;
+};
+
 /*
  * Container type for IODrivers.
  * Provides several conveniences, like iterators and filtering
@@ -36,10 +77,18 @@ namespace iodrv {
  */ 
 template <typename TupleT> class IODrivers {
 	TupleT drivers;
+	//the time at which each driver's onIdleCpu is next due (indexed like the tuple).
+	//  A null time_point means the driver is serviced on every interval.
+	std::array<EventClockT::time_point, std::tuple_size<TupleT>::value> _idleCpuDeadlines;
+	//the earliest of _idleCpuDeadlines
+	EventClockT::time_point _idleCpuDueTime;
+	//the earliest of _idleCpuDeadlines, excluding the drivers that are serviced on every interval
+	EventClockT::time_point _nextIdleCpuDeadline;
 	public:
 		//@ioDrivers std::tuple of IODrivers to construct from (will be moved).
 		//  Eg IODrivers(std::make_tuple(Fan(), A4988(), Endstop()))
-		IODrivers(TupleT &&ioDrivers) : drivers(std::move(ioDrivers)) {}
+		IODrivers(TupleT &&ioDrivers) : drivers(std::move(ioDrivers)), _idleCpuDeadlines(), 
+			_idleCpuDueTime(), _nextIdleCpuDeadline(EventClockT::time_point::max()) {}
 		//@return a reference to the underlying tuple of IODrivers
 		TupleT& tuple() {
 			return drivers;
@@ -53,11 +102,11 @@ template <typename TupleT> class IODrivers {
 				return true;
 			}
 		};
-        //Filter function that returns true for every item passing PredA OR PredB
+        //Filter function that returns true for every item that is in set A and passes PredA, OR is in set B and passes PredB
         //  This allows for the unionization of two iteration sets.
-        template <typename PredA, typename PredB> struct Union {
+        template <typename PredA, typename IndicesA, typename PredB, typename IndicesB> struct Union {
             bool operator()(const iteratorbase &self) {
-                return PredA()(self) || PredB()(self);
+                return (IndicesA::contains(self.index()) && PredA()(self)) || (IndicesB::contains(self.index()) && PredB()(self));
             }
         };
         //Filter function that returns true for every item passing PredA AND PredB
@@ -67,6 +116,44 @@ template <typename TupleT> class IODrivers {
                 return PredA()(self) && PredB()(self);
             }
         };
+        //Combining sets that have no runtime predicates shouldn't introduce one.
+        template <typename PredA, typename IndicesA, typename PredB, typename IndicesB> struct UnionPredicate {
+            typedef typename std::conditional<std::is_same<PredA, NoPredicate>::value && std::is_same<PredB, NoPredicate>::value,
+                NoPredicate, Union<PredA, IndicesA, PredB, IndicesB> >::type type;
+        };
+        template <typename PredA, typename PredB> struct IntersectionPredicate {
+            typedef typename std::conditional<std::is_same<PredA, NoPredicate>::value, PredB,
+                typename std::conditional<std::is_same<PredB, NoPredicate>::value, PredA, Intersection<PredA, PredB> >::type>::type type;
+        };
+        //Selectors for SelectIndices
+        template <template <typename> class Trait> struct TypeSelector {
+            template <std::size_t Idx> static constexpr bool select() {
+                return Trait<typename std::tuple_element<Idx, TupleT>::type>::value;
+            }
+        };
+        template <typename IndicesA, typename IndicesB> struct UnionSelector {
+            template <std::size_t Idx> static constexpr bool select() {
+                return IndicesA::contains(Idx) || IndicesB::contains(Idx);
+            }
+        };
+        template <typename IndicesA, typename IndicesB> struct IntersectionSelector {
+            template <std::size_t Idx> static constexpr bool select() {
+                return IndicesA::contains(Idx) && IndicesB::contains(Idx);
+            }
+        };
+        template <template <typename> class Trait> struct IndicesOfType {
+            typedef typename SelectIndices<std::tuple_size<TupleT>::value, TypeSelector<Trait> >::type type;
+        };
+        template <typename T> struct AnyType : std::true_type {};
+    public:
+        //Compile-time lists of the drivers that make up each view
+        typedef typename IndicesOfType<AnyType>::type         AllIndices;
+        typedef typename IndicesOfType<IsFanType>::type       FanIndices;
+        typedef typename IndicesOfType<IsHeaterType>::type    HeaterIndices;
+        typedef typename IndicesOfType<IsServoType>::type     ServoIndices;
+        typedef typename IndicesOfType<IsEndstopType>::type   EndstopIndices;
+        typedef typename IndicesOfType<HasIdleCpuWork>::type  IdleCpuIndices;
+    private:
 		//tupleutil::callOnIndex and callOnAll pass both the index and the tuple item as an argument to the function
 		//On the other hand, IODrivers::filter only passes the tuple item.
 		//Use this class to wrap a function object that expects only the tuple item and make it also work with (index, item)
@@ -128,6 +215,11 @@ template <typename TupleT> class IODrivers {
                 driver.setFanDutyCycle(duty);
             }
         };
+        struct _GenericGetFanDutyCycle {
+            template <typename T> float operator()(T &driver) const {
+                return driver.getFanDutyCycle();
+            }
+        };
         struct _GenericSetTargetTemperature {
             template <typename T> void operator()(T &driver, CelciusType temp) const {
                 driver.setTargetTemperature(temp);
@@ -175,6 +267,7 @@ template <typename TupleT> class IODrivers {
 		typedef IndexOptional<_GenericIsEndstop>              GenericIsEndstop;
 		typedef IndexOptional<_GenericIsEndstopTriggered>     GenericIsEndstopTriggered;
 		typedef IndexOptional<_GenericSetFanDutyCycle>        GenericSetFanDutyCycle;
+		typedef IndexOptional<_GenericGetFanDutyCycle>        GenericGetFanDutyCycle;
 		typedef IndexOptional<_GenericSetTargetTemperature>   GenericSetTargetTemperature;
 		typedef IndexOptional<_GenericGetTargetTemperature>   GenericGetTargetTemperature;
 		typedef IndexOptional<_GenericGetMeasuredTemperature> GenericGetMeasuredTemperature;
@@ -207,6 +300,10 @@ template <typename TupleT> class IODrivers {
                 iteratorbase& operator*() {
                     return *this;
                 }
+                //@return the index of the IODriver within the tuple
+                std::size_t index() const {
+                    return idx;
+                }
                 friend bool operator==(const iteratorbase &a, const iteratorbase &b) {
                     return a.idx == b.idx && a._tuple == b._tuple;
                 }
@@ -240,6 +337,9 @@ template <typename TupleT> class IODrivers {
                 void setFanDutyCycle(float duty) {
                     tupleCallOnIndex(tuple(), GenericSetFanDutyCycle(), idx, duty);
                 }
+                float getFanDutyCycle() const {
+                    return tupleCallOnIndex(tuple(), GenericGetFanDutyCycle(), idx);
+                }
                 void setTargetTemperature(CelciusType temp) {
                     tupleCallOnIndex(tuple(), GenericSetTargetTemperature(), idx, temp);
                 }
@@ -263,14 +363,17 @@ template <typename TupleT> class IODrivers {
                 }
         };
 
-    	//iterator class that also supports a filter predicate.
+    	//iterator class that visits the IODrivers listed in @Indices, and also supports a filter predicate.
     	//@Predicate function that should return false for any item that is not part of the desired set.
     	//  Note that the Predicate function cannot easily store state info, as it may be instantiated for each item.
-        template <typename Predicate=NoPredicate> class iterator : public iteratorbase {
+    	//  Sets whose membership is fully known at compile time use NoPredicate.
+        template <typename Predicate=NoPredicate, typename Indices=AllIndices> class iterator : public iteratorbase {
+            //position within Indices
+            std::size_t pos;
         	public:
-        		iterator(TupleT &drivers, std::size_t idx=0, bool filterFirst=true)
-        		 : iteratorbase(drivers, idx) {
-        		 	if (filterFirst && !Predicate()(*this)) {
+        		iterator(TupleT &drivers, std::size_t pos=0, bool filterFirst=true)
+        		 : iteratorbase(drivers, Indices::at(pos, std::tuple_size<TupleT>::value)), pos(pos) {
+        		 	if (filterFirst && !this->isAtEnd() && !Predicate()(*this)) {
         		 		++(*this);
         		 	}
         		}
@@ -278,8 +381,9 @@ template <typename TupleT> class IODrivers {
         		void operator++() {
         		 	do {
         		 		assert(!this->isAtEnd()); //illegal to increment an end iterator
-                    	++this->idx;
-                    } while (!Predicate()(*this) && !this->isAtEnd());
+                        ++pos;
+                        this->idx = Indices::at(pos, std::tuple_size<TupleT>::value);
+                    } while (!this->isAtEnd() && !Predicate()(*this));
         		}
         		//Apply the increment operator @add times
         		iterator operator+(std::size_t add) {
@@ -300,42 +404,50 @@ template <typename TupleT> class IODrivers {
 
     	//Allow one to build a filter before iterating.
     	//Also supports indexing and convenience functions that operate on the whole set.
-    	template <typename Predicate=NoPredicate> class iterinfo {
+    	//Only the drivers in @Indices are ever visited, and the functions that operate on the whole set are unrolled at compile time.
+    	//If Predicate is NoPredicate, length() and operator[] are constant-time.
+    	template <typename Predicate=NoPredicate, typename Indices=AllIndices> class iterinfo {
     		TupleT &drivers;
+            typedef std::is_same<Predicate, NoPredicate> HasNoPredicate;
 	    	public:
 	    		iterinfo(TupleT &drivers) : drivers(drivers) {}
-	    		iterator<Predicate> begin() {
-	    			return iterator<Predicate>(drivers);
+	    		iterator<Predicate, Indices> begin() {
+	    			return iterator<Predicate, Indices>(drivers);
 	    		}
-	    		iterator<Predicate> end() {
-	    			return iterator<Predicate>(drivers, std::tuple_size<TupleT>::value, false);
+	    		iterator<Predicate, Indices> end() {
+	    			return iterator<Predicate, Indices>(drivers, Indices::size(), false);
 	    		}
                 //@return the number of IODrivers included in this set.
                 std::size_t length() {
-                    return reduce([](std::size_t numSeen, const iteratorbase&) {
-                        return numSeen + 1;
-                    }, 0);
+                    return length(HasNoPredicate());
                 }
                 //@return true if there are no items in the set
                 bool empty() {
-                    return begin() == end();
+                    return Indices::size() == 0 || begin() == end();
                 }
-	    		iterator<Predicate> operator[](std::size_t idx) {
-	    			return begin() + idx;
+	    		iterator<Predicate, Indices> operator[](std::size_t idx) {
+	    			return at(idx, HasNoPredicate());
 	    		}
-                template <typename PredB> iterinfo<Union<Predicate, PredB> > unionWith(const iterinfo<PredB> &other) const {
+                template <typename PredB, typename IndicesB> 
+                  iterinfo<typename UnionPredicate<Predicate, Indices, PredB, IndicesB>::type, 
+                    typename SelectIndices<std::tuple_size<TupleT>::value, UnionSelector<Indices, IndicesB> >::type> 
+                  unionWith(const iterinfo<PredB, IndicesB> &other) const {
                     (void)other; //only used for type-deducation
-                    return iterinfo<Union<Predicate, PredB> >(drivers);
+                    return iterinfo<typename UnionPredicate<Predicate, Indices, PredB, IndicesB>::type, 
+                        typename SelectIndices<std::tuple_size<TupleT>::value, UnionSelector<Indices, IndicesB> >::type>(drivers);
                 }
-                template <typename PredB> iterinfo<Intersection<Predicate, PredB> > filter(const iterinfo<PredB> &other) const {
+                template <typename PredB, typename IndicesB> 
+                  iterinfo<typename IntersectionPredicate<Predicate, PredB>::type, 
+                    typename SelectIndices<std::tuple_size<TupleT>::value, IntersectionSelector<Indices, IndicesB> >::type> 
+                  filter(const iterinfo<PredB, IndicesB> &other) const {
                     (void)other; //only used for type-deducation
-                    return iterinfo<Intersection<Predicate, PredB> >(drivers);
+                    return iterinfo<typename IntersectionPredicate<Predicate, PredB>::type, 
+                        typename SelectIndices<std::tuple_size<TupleT>::value, IntersectionSelector<Indices, IndicesB> >::type>(drivers);
                 }
                 //apply <f> to every item in the iterator set.
+                //  Each driver is passed to f directly (rather than an iterator), so polymorphic functions are resolved at compile time.
 	    		template <typename F, typename ...Args> void apply(F &&f, Args ...args) {
-		    		for (auto &d : *this) {
-		    			f(d, args...);
-		    		}
+		    		applyEach(Indices(), f, args...);
 		    	}
 		    	//Standard 'reduce' function found in functional languages
 		    	//Return dflt if the collection is empty
@@ -344,9 +456,7 @@ template <typename TupleT> class IODrivers {
 		    	//Generalizes to f(...(dflt, ioDrivers[0]), ioDrivers[n]) for an n-item collection
 		    	template <typename F, typename Ret, typename ...Args> Ret reduce(F &&f, Ret &&dflt, Args ...args) {
 		    		Ret reduced(std::move(dflt));
-		    		for (auto &d : *this) {
-		    			reduced = f(std::move(reduced), d, args...);
-		    		}
+		    		reduceEach(Indices(), reduced, f, args...);
 		    		return reduced;
 		    	}
 		    	//Stadard 'any' function found in functional languages.
@@ -375,6 +485,41 @@ template <typename TupleT> class IODrivers {
                 template <typename F> bool all(F &&f) {
                     return all(std::move(f), DO_SHORT_CIRCUIT);
                 }
+            private:
+                std::size_t length(std::true_type) {
+                    return Indices::size();
+                }
+                std::size_t length(std::false_type) {
+                    return reduce([](std::size_t numSeen, const iteratorbase&) {
+                        return numSeen + 1;
+                    }, 0);
+                }
+                iterator<Predicate, Indices> at(std::size_t idx, std::true_type) {
+                    return iterator<Predicate, Indices>(drivers, idx, false);
+                }
+                iterator<Predicate, Indices> at(std::size_t idx, std::false_type) {
+                    return begin() + idx;
+                }
+                //Note: the elements of a braced initializer list are evaluated in order, which allows the below
+                //  functions to visit each index in turn using a parameter pack expansion
+                template <std::size_t ...Is, typename F, typename ...Args> void applyEach(IndexList<Is...>, F &f, Args ...args) {
+                    int unused[] = {0, (applyOne(std::get<Is>(drivers), iteratorbase(drivers, Is), f, args...), 0)...};
+                    (void)unused;
+                }
+                template <typename T, typename F, typename ...Args> void applyOne(T &driver, const iteratorbase &d, F &f, Args ...args) {
+                    if (Predicate()(d)) {
+                        f(driver, args...);
+                    }
+                }
+                template <std::size_t ...Is, typename Ret, typename F, typename ...Args> void reduceEach(IndexList<Is...>, Ret &reduced, F &f, Args ...args) {
+                    int unused[] = {0, (reduceOne(iteratorbase(drivers, Is), reduced, f, args...), 0)...};
+                    (void)unused;
+                }
+                template <typename Ret, typename F, typename ...Args> void reduceOne(iteratorbase &&d, Ret &reduced, F &f, Args ...args) {
+                    if (Predicate()(d)) {
+                        reduced = f(std::move(reduced), d, args...);
+                    }
+                }
     	};
 
     	//return an iterable/indexable object containing ALL the iodrivers
@@ -404,27 +549,29 @@ template <typename TupleT> class IODrivers {
         	return iterinfo<Predicate>(drivers);
     	}
     	//@return an iterable <iterinfo> object that contains only the fan IODrivers
-    	iterinfo<GenericIsFan> fans() {
-    		return filter(GenericIsFan());
+    	iterinfo<NoPredicate, FanIndices> fans() {
+    		return iterinfo<NoPredicate, FanIndices>(drivers);
     	}
     	//@return an iterable <iterinfo> object that contains only the hotend IODrivers
-    	iterinfo<GenericIsHotend> hotends() {
-    		return filter(GenericIsHotend());
+    	//  Only the heaters are checked to see if they control a hotend, since that is configured at runtime.
+    	iterinfo<GenericIsHotend, HeaterIndices> hotends() {
+    		return iterinfo<GenericIsHotend, HeaterIndices>(drivers);
     	}
     	//@return an iterable <iterinfo> object that contains only the heated bed IODrivers
-    	iterinfo<GenericIsHeatedBed> heatedBeds() {
-    		return filter(GenericIsHeatedBed());
+    	iterinfo<GenericIsHeatedBed, HeaterIndices> heatedBeds() {
+    		return iterinfo<GenericIsHeatedBed, HeaterIndices>(drivers);
     	}
-        auto heaters() -> decltype(std::declval<IODrivers<TupleT> >().hotends().unionWith(std::declval<IODrivers<TupleT> >().heatedBeds())) {
-            return hotends().unionWith(heatedBeds());
+    	//@return an iterable <iterinfo> object that contains both the hotend and heated bed IODrivers
+        iterinfo<NoPredicate, HeaterIndices> heaters() {
+            return iterinfo<NoPredicate, HeaterIndices>(drivers);
         }
     	//@return an iterable <iterinfo> object that contains only the servo IODrivers
-    	iterinfo<GenericIsServo> servos() {
-    		return filter(GenericIsServo());
+    	iterinfo<NoPredicate, ServoIndices> servos() {
+    		return iterinfo<NoPredicate, ServoIndices>(drivers);
     	}
     	//@return an iterable <iterinfo> object that contains only the endstop IODrivers
-    	iterinfo<GenericIsEndstop> endstops() {
-    		return filter(GenericIsEndstop());
+    	iterinfo<NoPredicate, EndstopIndices> endstops() {
+    		return iterinfo<NoPredicate, EndstopIndices>(drivers);
     	}
     	//apply T::lockAxis on each IODriver in the set
         void lockAllAxes() {
@@ -446,17 +593,73 @@ template <typename TupleT> class IODrivers {
 		void setFanDutyCycle(float duty) {
 			fans().apply(GenericSetFanDutyCycle(), duty);
 		}
-		//Call EVERY device's onIdleCpu handler, and return true if AT LEAST one of those handlers requests more time
+		//Call the onIdleCpu handler of each device that has work due, and return true if AT LEAST one of those handlers requests more time
 		//A request for more time is made by a specific IoDriver be returning true from its onIdleCpu handler.
+		//  It's then called on every interval until it returns false, after which it isn't called again until its nextIdleCpuDeadline().
+		//Drivers that don't override onIdleCpu are never called.
 		bool onIdleCpu(OnIdleCpuIntervalT interval) {
-			return iter().any(GenericOnIdleCpu(), NO_SHORT_CIRCUIT, interval);
+			if (IdleCpuIndices::size() == 0) {
+				return false;
+			}
+			EventClockT::time_point now = EventClockT::now();
+			if (now < _idleCpuDueTime) {
+				return false;
+			}
+			bool needCpu = false;
+			_idleCpuDueTime = _nextIdleCpuDeadline = EventClockT::time_point::max();
+			onIdleCpuEach(IdleCpuIndices(), interval, now, needCpu);
+			return needCpu;
+		}
+		//@return the earliest time at which a driver has onIdleCpu work due, or EventClockT::time_point::max() if none do.
+		//  Drivers that are serviced on every interval (because they requested more time, or don't report a deadline) aren't counted,
+		//  so the scheduler can sleep until this time.
+		EventClockT::time_point nextIdleCpuDeadline() const {
+			return _nextIdleCpuDeadline;
 		}
+        //@return the soonest event of any IODriver, and an iterator to the driver that produced it
+        //  (or a null OutputEvent and end() if no driver has a pending event).
+        //State calls this once per scheduled event, so only the drivers whose type can generate events are queried.
         std::pair<iteratorbase, OutputEvent> peekNextEvent() {
-            return iter().reduce([](std::pair<iteratorbase, OutputEvent> &&reduced, iteratorbase &d) {
-                OutputEvent curEvt = d.peekNextEvent();
-                bool isCurEvtSooner = reduced.second.isNull() || (!curEvt.isNull() && curEvt.time() < reduced.second.time());
-                return isCurEvtSooner ? std::make_pair(d, curEvt) : reduced;
-            }, std::pair<iteratorbase, OutputEvent>(iter().end(), OutputEvent()));
+            std::pair<iteratorbase, OutputEvent> soonest(iter().end(), OutputEvent());
+            peekNextEventFrom(std::integral_constant<std::size_t, 0>(), soonest);
+            return soonest;
+        }
+    private:
+        //visit each driver in turn, at compile time
+        template <std::size_t Idx> void peekNextEventFrom(std::integral_constant<std::size_t, Idx>, std::pair<iteratorbase, OutputEvent> &soonest) {
+            peekNextEventOf(std::integral_constant<std::size_t, Idx>(), soonest, 
+                GeneratesEvents<typename std::tuple_element<Idx, TupleT>::type>());
+            peekNextEventFrom(std::integral_constant<std::size_t, Idx+1>(), soonest);
+        }
+        void peekNextEventFrom(std::integral_constant<std::size_t, std::tuple_size<TupleT>::value>, std::pair<iteratorbase, OutputEvent> &) {
+        }
+        template <std::size_t Idx> void peekNextEventOf(std::integral_constant<std::size_t, Idx>, std::pair<iteratorbase, OutputEvent> &soonest, std::true_type) {
+            OutputEvent curEvt = std::get<Idx>(drivers).peekNextEvent();
+            bool isCurEvtSooner = soonest.second.isNull() || (!curEvt.isNull() && curEvt.time() < soonest.second.time());
+            if (isCurEvtSooner) {
+                soonest = std::make_pair(iteratorbase(drivers, Idx), curEvt);
+            }
+        }
+        //this driver never produces events
+        template <std::size_t Idx> void peekNextEventOf(std::integral_constant<std::size_t, Idx>, std::pair<iteratorbase, OutputEvent> &, std::false_type) {
+        }
+        template <std::size_t ...Is> void onIdleCpuEach(IndexList<Is...>, OnIdleCpuIntervalT interval, EventClockT::time_point now, bool &needCpu) {
+            int unused[] = {0, (onIdleCpuOf(std::get<Is>(drivers), _idleCpuDeadlines[Is], interval, now, needCpu), 0)...};
+            (void)unused; (void)interval; (void)now; //unused if there are no drivers with onIdleCpu work
+        }
+        template <typename T> void onIdleCpuOf(T &driver, EventClockT::time_point &deadline, OnIdleCpuIntervalT interval, EventClockT::time_point now, bool &needCpu) {
+            if (now >= deadline) {
+                if (driver.onIdleCpu(interval)) {
+                    needCpu = true;
+                    deadline = EventClockT::time_point();
+                } else {
+                    deadline = driver.nextIdleCpuDeadline();
+                }
+            }
+            _idleCpuDueTime = std::min(_idleCpuDueTime, deadline);
+            if (deadline != EventClockT::time_point()) {
+                _nextIdleCpuDeadline = std::min(_nextIdleCpuDeadline, deadline);
+            }
         }
 };
 
@@ -24,8 +24,11 @@
 #include "iopin.h"
 
 #include <cassert>
+#include <algorithm> //for std::min, std::max
 
 #include "schedulerbase.h" //for SchedulerBase::registerExitHandler
+#include "outputevent.h" //must be complete before HardwareScheduler::queue is defined
+#include "platforms/auto/hardwarescheduler.h" //for input capture
 #include "common/logging.h"
 #include "common/mathutil.h"
 //for the testsuite
@@ -62,6 +65,8 @@ IoPin& IoPin::operator=(IoPin &&other) {
 	_invertReads = other._invertReads;
     _invertWrites = other._invertWrites;
     _defaultState = other._defaultState;
+    _captureChannel = other._captureChannel;
+    other._captureChannel = -1;
     #ifndef NDEBUG
         _currentMode = other._currentMode;
         //make it so that attempted operations on the other pin raise an assertion:
@@ -84,6 +89,11 @@ bool IoPin::isNull() const {
 IoLevel IoPin::translateWriteToPrimitive(IoLevel lev) const { 
     return _invertWrites ? !lev : lev; 
 }
+EventClockT::duration IoPin::translatePulseToPrimitive(EventClockT::duration onTime, EventClockT::duration period) const {
+    EventClockT::duration clamped = std::min(period, std::max(EventClockT::duration(0), onTime));
+    //an inverted pulse train is low for onTime each period, which is the same as being high for the rest of it.
+    return _invertWrites ? period - clamped : clamped;
+}
 float IoPin::translateDutyCycleToPrimitive(float pwm) const {
     float postInversion = _invertWrites ? 1-pwm : pwm;
     float clamped = mathutil::clamp(postInversion, 0.f, 1.f);
@@ -113,6 +123,12 @@ void IoPin::makePwmOutput(float duty, EventClockT::duration desiredPeriod) {
     #endif
     _pin.makePwmOutput(translateDutyCycleToPrimitive(duty), desiredPeriod);
 }
+void IoPin::makePulseOutput(EventClockT::duration onTime, EventClockT::duration period) {
+    #ifndef NDEBUG
+        _currentMode = IOPIN_MODE_PULSE;
+    #endif
+    _pin.makePulseOutput(translatePulseToPrimitive(onTime, period), period);
+}
 IoLevel IoPin::digitalRead() const {
     #ifndef NDEBUG
         assert(_currentMode == IOPIN_MODE_INPUT);
@@ -120,6 +136,17 @@ IoLevel IoPin::digitalRead() const {
     //relay the call to the real pin, performing any inversions necessary
     return _invertReads ? !_pin.digitalRead() : _pin.digitalRead();
 }
+bool IoPin::captureInput() {
+    if (!isNull() && _captureChannel == -1) {
+        _captureChannel = HardwareScheduler().captureInput(_pin);
+    }
+    return isInputCaptured();
+}
+bool IoPin::findCapturedLevel(IoLevel lev, EventClockT::time_point since, EventClockT::time_point &at) const {
+    assert(isInputCaptured());
+    //the captured levels are those of the primitive pin, so search for the inverted level if reads are inverted
+    return HardwareScheduler().findCapturedLevel(_captureChannel, _invertReads ? !lev : lev, since, at);
+}
 void IoPin::digitalWrite(IoLevel lev) {
     #ifndef NDEBUG
         assert(_currentMode == IOPIN_MODE_OUTPUT);
@@ -134,6 +161,12 @@ void IoPin::pwmWrite(float duty, EventClockT::duration desiredPeriod) {
     //relay the call to the real pin, performing any inversions necessary
     _pin.pwmWrite(translateDutyCycleToPrimitive(duty), desiredPeriod);
 }
+void IoPin::pulseWrite(EventClockT::duration onTime, EventClockT::duration period) {
+    #ifndef NDEBUG
+        assert(_currentMode == IOPIN_MODE_PULSE);
+    #endif
+    _pin.pulseWrite(translatePulseToPrimitive(onTime, period), period);
+}
 
 void IoPin::setToDefault() {
     //set the pin to a "safe" default state:
@@ -156,11 +189,13 @@ TEST_CASE("IoPins will correctly invert writes", "[iopin]") {
         REQUIRE(p.translateWriteToPrimitive(IoLow) == IoLow);
         REQUIRE(p.translateWriteToPrimitive(IoHigh) == IoHigh);
         REQUIRE(p.translateDutyCycleToPrimitive(0.2) == Approx(0.2));
+        REQUIRE((p.translatePulseToPrimitive(std::chrono::milliseconds(2), std::chrono::milliseconds(20)) == std::chrono::milliseconds(2)));
     }
     SECTION("INVERT_WRITES will invert writes") {
         iodrv::IoPin p(iodrv::INVERT_WRITES, PrimitiveIoPin::null());
         REQUIRE(p.translateWriteToPrimitive(IoLow) == IoHigh);
         REQUIRE(p.translateWriteToPrimitive(IoHigh) == IoLow);
         REQUIRE(p.translateDutyCycleToPrimitive(0.2) == Approx(0.8));
+        REQUIRE((p.translatePulseToPrimitive(std::chrono::milliseconds(2), std::chrono::milliseconds(20)) == std::chrono::milliseconds(18)));
     }
 }
\ No newline at end of file
@@ -54,6 +54,7 @@ enum IoPinMode {
     IOPIN_MODE_INPUT,
     IOPIN_MODE_OUTPUT,
     IOPIN_MODE_PWM,
+    IOPIN_MODE_PULSE,
 };
 
 
@@ -66,6 +67,8 @@ class IoPin {
     bool _invertReads;
     bool _invertWrites;
     DefaultIoState _defaultState;
+    //channel returned by the HardwareScheduler's captureInput, or -1 if the pin's level isn't being captured
+    int _captureChannel;
     //if compiling in debug mode, we should force that all users of IoPin correctly set it to output mode before writing to it.
     #ifndef NDEBUG
         IoPinMode _currentMode;
@@ -95,7 +98,7 @@ class IoPin {
         template <typename ...Args> IoPin(IoPinInversions inversions, Args... args)
           : _pin(args...),  
           _invertReads((inversions & INVERT_READS) != 0), _invertWrites((inversions & INVERT_WRITES) != 0), 
-          _defaultState(IO_DEFAULT_NONE) {
+          _defaultState(IO_DEFAULT_NONE), _captureChannel(-1) {
             #ifndef NDEBUG
                 _currentMode = IOPIN_MODE_UNSPECIFIED;
             #endif
@@ -118,6 +121,7 @@ class IoPin {
         //  where <translated level> is the value returned by this function
         IoLevel translateWriteToPrimitive(IoLevel lev) const;
         float translateDutyCycleToPrimitive(float pwm) const;
+        EventClockT::duration translatePulseToPrimitive(EventClockT::duration onTime, EventClockT::duration period) const;
         const PrimitiveIoPin& primitiveIoPin() const;
         //set the pin as a digital output, and give it the specified state.
         //Doing these two actions together allow us to prevent the pin from ever being in an undefined state.
@@ -125,16 +129,36 @@ class IoPin {
         //set the pin as a pwm output & give it the desired duty / period.
         //Doing these two actions together allow us to prevent the pin from ever being in an undefined state.
         void makePwmOutput(float duty, EventClockT::duration desiredPeriod=EventClockT::duration(0));
+        //@return true if the platform can output exact pulses (makePulseOutput, pulseWrite) without cpu involvement.
+        static constexpr bool hasPulseOutput() {
+            return PrimitiveIoPin::hasPulseOutput();
+        }
+        //set the pin to go ACTIVE for @onTime at the start of every @period (the platform may adjust the period slightly).
+        //Only supported if hasPulseOutput().
+        void makePulseOutput(EventClockT::duration onTime, EventClockT::duration period);
         //Configure the pin as an input
         void makeDigitalInput();
         //Read a binary logic level from the pin. MUST first call makeDigitalInput() to put the pin in input mode.
         IoLevel digitalRead() const;
+        //Ask the platform to record the pin's level in the background (e.g. the rpi samples it via DMA),
+        //  so that the time of an edge can be found later with findCapturedLevel instead of by busy-polling digitalRead.
+        //@return true if the platform supports capturing this pin.
+        bool captureInput();
+        inline bool isInputCaptured() const {
+            return _captureChannel != -1;
+        }
+        //Find the earliest captured time at or after @since that the pin read @lev. MUST first call captureInput().
+        //@return true and set @at to that time if found.
+        //  Otherwise, set @at to the time up to which the level has been captured, from which a later search can resume.
+        bool findCapturedLevel(IoLevel lev, EventClockT::time_point since, EventClockT::time_point &at) const;
         //Write a binary logic level to the pin (IoHigh or IoLow). MUST first call makeDigitalOutput() to put the pin in output mode.
         void digitalWrite(IoLevel lev);
         //Set the pin to output a PWM signal. MUST first call makePwmOutput() to put the pin in pwm mode.
         //@duty proportion of time that the pin should be ACTIVE (0.0 - 1.0).
         //@desiredPeriod *desired* PWM cycle length (the actual length isn't guaranteed). Useful for decreasing fet/relay switching frequency, etc. 
         void pwmWrite(float duty, EventClockT::duration desiredPeriod=EventClockT::duration(0));
+        //Change the pulse width & period of a pin. MUST first call makePulseOutput() to put the pin in pulse mode.
+        void pulseWrite(EventClockT::duration onTime, EventClockT::duration period);
         //put the pin into its default state, as set by setDefaultState(...).
         void setToDefault();
 };
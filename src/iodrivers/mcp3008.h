@@ -0,0 +1,59 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IODRIVERS_MCP3008_H
+#define IODRIVERS_MCP3008_H
+
+#include <cstdint>
+#include <utility> //for std::move
+#include "spidevbus.h"
+
+namespace iodrv {
+
+/*
+ * Reads one single-ended channel of a Microchip MCP3008 10-bit SPI ADC (or the 4-channel MCP3004), for use with AdcThermistor.
+ * A conversion completes within the 3-byte transfer, but the transfer itself blocks, so read() should only be called from a worker thread.
+ *
+ * BusT must provide bool transfer(uint8_t *data, size_t length), exchanging @data in place (see SpiDevBus).
+ */
+template <typename BusT=SpiDevBus> class Mcp3008 {
+    BusT _bus;
+    int _channel;
+    public:
+        //@channel the input to read (0-7). The divider being measured should be referenced to the MCP3008's Vref.
+        inline Mcp3008(BusT &&bus, int channel) : _bus(std::move(bus)), _channel(channel) {}
+        inline bool read(float &ratio) {
+            //start bit, then single-ended mode + channel, then clock out the result
+            uint8_t data[3] = { 0x01, (uint8_t)(0x80 | (_channel << 4)), 0x00 };
+            if (!_bus.transfer(data, sizeof(data))) {
+                return false;
+            }
+            int counts = ((data[1] & 0x03) << 8) | data[2];
+            ratio = counts / 1024.f;
+            return true;
+        }
+};
+
+}
+
+#endif
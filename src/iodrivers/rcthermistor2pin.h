@@ -71,6 +71,9 @@ namespace iodrv {
  *    Vtoggle likely has the highest variability, so adjust that one.
  *  We can actually achieve two calibration data:
  *    One charging through only Rup, and the other charging through Rup and Rchrg
+ *
+ *  If the platform can capture the CHRG/MEAS level in the background (see IoPin::captureInput), the time of the toggle
+ *    is looked up from the captured samples every captureCheckInterval instead of busy-polling the pin.
  */
 class RCThermistor2Pin : public IODriver {
     enum ThermMode {
@@ -89,9 +92,13 @@ class RCThermistor2Pin : public IODriver {
     EventClockT::duration readInterval;
     EventClockT::duration readTimeout;
     EventClockT::duration minTimingAccuracy;
+    //when the CHRG/MEAS level is captured, how often to look for the toggle in the captured samples
+    EventClockT::duration captureCheckInterval;
 
     EventClockT::time_point startModeTime;
     EventClockT::time_point lastServiceTime;
+    //the captured samples before this time have already been searched for the toggle
+    EventClockT::time_point captureSearchFrom;
     bool isCalibrated;
     ThermMode mode;
     float lastTemp;
@@ -107,9 +114,11 @@ class RCThermistor2Pin : public IODriver {
             readInterval(readInterval), 
             readTimeout(this->readInterval.count()/10),
             minTimingAccuracy(minTimingAccuracy),
+            captureCheckInterval(std::chrono::milliseconds(1)),
             isCalibrated(false), mode(MODE_PREPARING), lastTemp(mathutil::ABSOLUTE_ZERO_CELCIUS) {
             thermPin.setDefaultState(IO_DEFAULT_HIGH_IMPEDANCE);
             chargeMeasPin.setDefaultState(IO_DEFAULT_HIGH_IMPEDANCE);
+            this->chargeMeasPin.captureInput();
             setModePreparing();
         }
         inline bool onIdleCpu(OnIdleCpuIntervalT interval) {
@@ -131,6 +140,20 @@ class RCThermistor2Pin : public IODriver {
                 } else {
                     return false;
                 }
+            } else if (chargeMeasPin.isInputCaptured()) {
+                EventClockT::time_point toggleTime;
+                if (chargeMeasPin.findCapturedLevel(IoHigh, captureSearchFrom, toggleTime)) {
+                    //the captured time is exact, so there's no need to check for preemption
+                    finishRead(toggleTime - startModeTime);
+                } else if (toggleTime - startModeTime > readTimeout) {
+                    LOG("RCThermistor2Pin read timeout\n");
+                    setModePreparing();
+                } else {
+                    //check again after captureCheckInterval (see nextIdleCpuDeadline)
+                    captureSearchFrom = toggleTime;
+                    lastServiceTime = EventClockT::now();
+                }
+                return false;
             } else {
                 EventClockT::time_point timeNow = EventClockT::now();
                 LOGV("RCThermistor2Pin onIdleCpu latency: %" PRId64 "\n", onIdleCpuTimer.clockDiff().count());
@@ -152,29 +175,46 @@ class RCThermistor2Pin : public IODriver {
                     EventClockT::time_point endReadTime = EventClockT::now();
                     if (endReadTime - lastServiceTime > minTimingAccuracy) {
                         LOGD("RCThermistor2Pin could not meet timing requirements; discarding read\n");
+                        setModePreparing();
                     } else {
-                        float duration = std::chrono::duration_cast<std::chrono::duration<float> >(endReadTime - startModeTime).count();
-                        if (mode == MODE_READING) {
-                            LOGD("time to read resistor: %f\n", duration);
-                            //now try to guess the resistance:
-                            float resistance = guessRFromTime(duration);
-                            LOGD("Resistance guess: %f\n", resistance);
-                            lastTemp = temperatureFromR(resistance);
-                            LOGD("Temperature guess: %f\n", lastTemp);
-                        } else if (mode == MODE_CALIBRATING) {
-                            updateValuesFromCalibrationData(duration);
-                            isCalibrated = true;
-                        }
+                        finishRead(endReadTime - startModeTime);
                     }
-                    setModePreparing();
                     return false;
                 }
             }
         }
+        //a read begins once the capacitor has been draining for readInterval.
+        //Once reading, the captured samples are checked every captureCheckInterval;
+        //  otherwise onIdleCpu requests more cpu time until the read completes, so no deadline is needed.
+        inline EventClockT::time_point nextIdleCpuDeadline() const {
+            if (mode == MODE_PREPARING) {
+                return startModeTime + readInterval;
+            } else if (chargeMeasPin.isInputCaptured()) {
+                return lastServiceTime + captureCheckInterval;
+            } else {
+                return EventClockT::time_point();
+            }
+        }
         inline float value() const {
             return lastTemp;
         }
     private:
+        //handle a successful read in which the capacitor took @chargeTime to reach Vtoggle, and prepare for the next read.
+        inline void finishRead(EventClockT::duration chargeTime) {
+            float duration = std::chrono::duration_cast<std::chrono::duration<float> >(chargeTime).count();
+            if (mode == MODE_READING) {
+                LOGD("time to read resistor: %f\n", duration);
+                //now try to guess the resistance:
+                float resistance = guessRFromTime(duration);
+                LOGD("Resistance guess: %f\n", resistance);
+                lastTemp = temperatureFromR(resistance);
+                LOGD("Temperature guess: %f\n", lastTemp);
+            } else if (mode == MODE_CALIBRATING) {
+                updateValuesFromCalibrationData(duration);
+                isCalibrated = true;
+            }
+            setModePreparing();
+        }
         //bring the capacitor as close to ground as possible to prepare it for a read.
         inline void setModePreparing() {
             mode = MODE_PREPARING;
@@ -188,7 +228,7 @@ class RCThermistor2Pin : public IODriver {
         //  configure the capacitor to be charged through the thermistor
         inline void setModeReading() {
             mode = MODE_READING;
-            startModeTime = lastServiceTime = EventClockT::now();
+            startModeTime = lastServiceTime = captureSearchFrom = EventClockT::now();
             //disconnect charge pin from ground and use it to measure
             chargeMeasPin.makeDigitalInput();
             //tie thermistor to high to begin drain
@@ -202,7 +242,7 @@ class RCThermistor2Pin : public IODriver {
         inline void setModeCalibrating() {
             mode = MODE_CALIBRATING;
             //TODO: Also need to ensure that the we haven't been pre-empted between grabbing the time & setting the pins.
-            startModeTime = lastServiceTime = EventClockT::now();
+            startModeTime = lastServiceTime = captureSearchFrom = EventClockT::now();
             //disconnect charge pin from ground and use it to measure
             chargeMeasPin.makeDigitalInput();
             //disconnect thermistor to drain only through Rup.
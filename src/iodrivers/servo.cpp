@@ -27,16 +27,28 @@
 namespace iodrv {
 
 void Servo::setServoAngleDegrees(float angle) {
-	highTime = getOnTime(angle);
+	EventClockT::duration newHighTime = getOnTime(angle);
+	//reprogramming the pulses can be expensive (e.g. rewriting the DMA buffer on rpi), so only do it when they change
+	if (usePulseOutput && newHighTime != highTime) {
+		pin.pulseWrite(newHighTime, cycleLength);
+	}
+	highTime = newHighTime;
 }
 
 OutputEvent Servo::peekNextEvent() const {
+	if (usePulseOutput) {
+		//the platform generates the pulses
+		return OutputEvent();
+	}
 	bool nextState = !curState;
 	EventClockT::time_point nextEventTime = lastEventTime + (curState ? highTime : (cycleLength-highTime));
 	return OutputEvent(nextEventTime, pin, nextState);
 }
 
 void Servo::consumeNextEvent() {
+	if (usePulseOutput) {
+		return;
+	}
 	OutputEvent evt = peekNextEvent();
 	this->curState = !curState; //Note: avoid evt.state(), as that has potentially been level-inverted for the pin inversions
 	this->lastEventTime = evt.time();
@@ -131,6 +143,29 @@ struct ServoTester {
     				prevInactive = curInactive;
     			}
     		}
+    		THEN("IODrivers::peekNextEvent should return the soonest event of either Servo, and skip the other IODrivers") {
+    			auto refs = std::tie(std::get<0>(ioDrivers), std::get<1>(ioDrivers), std::get<2>(ioDrivers), std::get<3>(ioDrivers), std::get<4>(ioDrivers));
+    			iodrv::IODrivers<decltype(refs)> drivers(std::move(refs));
+    			REQUIRE(!iodrv::GeneratesEvents<iodrv::IODriver>::value);
+    			REQUIRE(iodrv::GeneratesEvents<iodrv::Servo&>::value);
+    			OutputEvent evt0 = servo0.peekNextEvent();
+    			OutputEvent evt1 = servo1.peekNextEvent();
+    			bool isServo1Sooner = evt1.time() < evt0.time();
+    			auto soonest = drivers.peekNextEvent();
+    			REQUIRE(soonest.second == (isServo1Sooner ? evt1 : evt0));
+    			REQUIRE(soonest.first == drivers[isServo1Sooner ? 3 : 0]);
+    		}
+    		THEN("The IODrivers views should only contain the Servos, and be indexable") {
+    			auto refs = std::tie(std::get<0>(ioDrivers), std::get<1>(ioDrivers), std::get<2>(ioDrivers), std::get<3>(ioDrivers), std::get<4>(ioDrivers));
+    			typedef iodrv::IODrivers<decltype(refs)> DriversT;
+    			DriversT drivers(std::move(refs));
+    			static_assert(std::is_same<DriversT::ServoIndices, iodrv::IndexList<0, 3> >::value, "ServoIndices should be computed at compile time");
+    			REQUIRE(drivers.servos().length() == 2);
+    			REQUIRE(drivers.servos()[1] == drivers[3]);
+    			REQUIRE(drivers.fans().empty());
+    			REQUIRE(drivers.heaters().length() == 0);
+    			REQUIRE(drivers.servos().unionWith(drivers.fans()).length() == 2);
+    		}
 	    	GIVEN("A TestHelper that owns references to those IoDrivers") {
 				//only give the State references to the ioDrivers so that we can track changes without private member access
 				auto getIoDrivers = [&]() {
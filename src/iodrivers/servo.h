@@ -43,6 +43,9 @@ namespace iodrv {
 //The length of that pulse determines the position at which the servo should be placed, and the servo will attempt to stay at that location until the next command.
 //Typical pulse length varies from 1ms to 2ms for the full control range,
 // while the pulses must occur between 40-200 times per second.
+//
+//If the platform can output exact pulses by itself (IoPin::hasPulseOutput), the pulse train is programmed once and only reprogrammed when the angle changes.
+//Otherwise, each edge is produced as an OutputEvent via peekNextEvent/consumeNextEvent.
 class Servo : public IODriver {
 	friend struct ServoTester;
 	//constants:
@@ -50,6 +53,8 @@ class Servo : public IODriver {
 	EventClockT::duration cycleLength;
 	EventClockT::duration minOnTime, maxOnTime;
 	float minAngle, maxAngle;
+	//true if the platform generates the pulses (null pins, as used in tests, always use OutputEvents)
+	bool usePulseOutput;
 	//internal state:
 	EventClockT::time_point lastEventTime;
 	EventClockT::duration highTime;
@@ -67,12 +72,16 @@ class Servo : public IODriver {
 		inline Servo(IoPin &&pin, EventClockT::duration cycleLength, std::pair<EventClockT::duration, EventClockT::duration> minMaxOnTime,
 			std::pair<float, float> minMaxAngle=std::pair<float, float>(0, 360), float initialAngle=0)
 		 : pin(std::move(pin)) , cycleLength(cycleLength), minOnTime(minMaxOnTime.first), maxOnTime(minMaxOnTime.second), 
-		   minAngle(minMaxAngle.first), maxAngle(minMaxAngle.second),
+		   minAngle(minMaxAngle.first), maxAngle(minMaxAngle.second), usePulseOutput(IoPin::hasPulseOutput() && !this->pin.isNull()),
 		   lastEventTime(EventClockT::now()), highTime(getOnTime(initialAngle)), curState(IoLow) {
 		   	//ensure that the servo control pin is not left floating when shutdown
 		   	this->pin.setDefaultState(IO_DEFAULT_LOW);
 		   	//configure the pin for output mode
-		   	this->pin.makeDigitalOutput(IoLow);
+		   	if (usePulseOutput) {
+		   		this->pin.makePulseOutput(highTime, cycleLength);
+		   	} else {
+		   		this->pin.makeDigitalOutput(IoLow);
+		   	}
 	    }
 
 		inline bool isServo() const {
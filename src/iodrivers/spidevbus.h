@@ -0,0 +1,82 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IODRIVERS_SPIDEVBUS_H
+#define IODRIVERS_SPIDEVBUS_H
+
+#include <cstddef> //for size_t
+#include <cstdint>
+#include <cstring> //for memset
+#include <fcntl.h> //for open
+#include <unistd.h> //for close
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+#include "common/logging.h"
+
+namespace iodrv {
+
+/*
+ * Full-duplex transfers over a Linux spidev device (e.g. /dev/spidev0.0 on the Raspberry Pi), for use with SPI ADCs like Mcp3008.
+ * The device is closed on destruction.
+ */
+class SpiDevBus {
+    int _fd;
+    uint32_t _speedHz;
+    public:
+        //@deviceName path to the spidev device. The chip select is determined by the device (spidevBUS.CS).
+        //@speedHz SPI clock rate. @mode SPI mode (clock polarity & phase); MCP3008-style ADCs use mode 0.
+        inline SpiDevBus(const char *deviceName, uint32_t speedHz=1000000, uint8_t mode=SPI_MODE_0)
+          : _fd(open(deviceName, O_RDWR)), _speedHz(speedHz) {
+            if (_fd == -1) {
+                LOGE("Failed to open %s (did you remember to run as root?)\n", deviceName);
+            } else if (ioctl(_fd, SPI_IOC_WR_MODE, &mode) == -1 || ioctl(_fd, SPI_IOC_WR_MAX_SPEED_HZ, &speedHz) == -1) {
+                LOGE("Failed to configure SPI device %s\n", deviceName);
+            }
+        }
+        SpiDevBus(const SpiDevBus &other) = delete;
+        SpiDevBus& operator=(const SpiDevBus &other) = delete;
+        inline SpiDevBus(SpiDevBus &&other) : _fd(other._fd), _speedHz(other._speedHz) {
+            other._fd = -1;
+        }
+        inline ~SpiDevBus() {
+            if (_fd != -1) {
+                close(_fd);
+            }
+        }
+        //write @length bytes from @data, replacing them with the bytes read at the same time.
+        //@return false if the transfer failed.
+        inline bool transfer(uint8_t *data, std::size_t length) {
+            struct spi_ioc_transfer xfer;
+            memset(&xfer, 0, sizeof(xfer));
+            xfer.tx_buf = (uintptr_t)data;
+            xfer.rx_buf = (uintptr_t)data;
+            xfer.len = length;
+            xfer.speed_hz = _speedHz;
+            xfer.bits_per_word = 8;
+            return ioctl(_fd, SPI_IOC_MESSAGE(1), &xfer) != -1;
+        }
+};
+
+}
+
+#endif
@@ -26,6 +26,7 @@
 #define IODRIVERS_TEMPCONTROL_H
 
 #include <utility> //for std::move
+#include <algorithm> //for std::min
 
 #include "iodriver.h"
 #include "common/filters/nofilter.h"
@@ -62,6 +63,8 @@ template <typename Thermistor, typename PID=PID, typename Filter=NoFilter> class
 
     float _destTemp;
     float _filteredTemp;
+    //false until the first valid reading, and whenever the thermistor reports an error
+    bool _isThermValid;
     bool _isReading;
     EventClockT::time_point _nextPwmUpdate;
     public:
@@ -70,7 +73,7 @@ template <typename Thermistor, typename PID=PID, typename Filter=NoFilter> class
          : IODriver(), _hotType(hotType), _heater(std::move(heater)), _therm(std::move(therm)), _pid(pid), _filter(filter), 
          _pwmPeriod(pwmPeriod), _pwmUpdateInterval(pwmUpdateInterval), 
          _destTemp(mathutil::ABSOLUTE_ZERO_CELCIUS), _filteredTemp(mathutil::ABSOLUTE_ZERO_CELCIUS), 
-         _isReading(false), _nextPwmUpdate(EventClockT::now()) {
+         _isThermValid(false), _isReading(false), _nextPwmUpdate(EventClockT::now()) {
             _heater.setDefaultState(IO_DEFAULT_LOW);
             _heater.makePwmOutput(0.0);
         }
@@ -97,14 +100,26 @@ template <typename Thermistor, typename PID=PID, typename Filter=NoFilter> class
             if (interval == OnIdleCpuIntervalWide && EventClockT::now() >= _nextPwmUpdate) {
                 _nextPwmUpdate += _pwmUpdateInterval;
                 float t = _therm.value();
-                //a temperature <= absolute zero is used to signal errors.
+                //a temperature <= absolute zero is used to signal errors (or that there's no reading yet).
+                //Without a temperature, the heater can't be regulated, so it must be off rather than left at its last duty.
                 //TODO: raise a fatal error (machine shutdown) if thermistor read errors persist for more than, say, 10 sec.
                 if (t > mathutil::ABSOLUTE_ZERO_CELCIUS) {
+                    _isThermValid = true;
                     updatePwm(t);
+                } else {
+                    if (_isThermValid) {
+                        LOGE("tempcontrol: thermistor reading failed; turning the heater off\n");
+                        _isThermValid = false;
+                    }
+                    _heater.pwmWrite(0, _pwmPeriod);
                 }
             }
             return needMoreCpu;
         }
+        //the pwm is next updated at _nextPwmUpdate, but the thermistor may need servicing before then
+        inline EventClockT::time_point nextIdleCpuDeadline() const {
+            return std::min(_nextPwmUpdate, _therm.nextIdleCpuDeadline());
+        }
     private:
         inline void updatePwm(float lastTemp) {
 	        //Filter the measurement values to compensate for jitter, etc
@@ -64,6 +64,11 @@
 #define HOME_RATE_MM_SEC 10           // Speed at which to home the endstops, in mm/s
 #define MAX_EXT_RATE_MM_SEC 150       // Maximum rate at which filament should ever be extruded, in mm of filament / s
 
+//Per-axis limits. Moves that involve a slow axis are slowed down just enough to respect them, without limiting moves that don't.
+#define MAX_VEL_MM_SEC_XYZE        120, 120, 30, 150      // Maximum velocity of each axis, in mm/s
+#define MAX_ACCEL_MM_SEC2_XYZE     900, 900, 300, 2000    // Maximum acceleration of each axis, in mm/s^2
+#define MAX_STEP_RATE_XYZE         50000, 50000, 50000, 50000 // Maximum steps/sec each stepper driver can be given
+
 
 //Pin Definitions:
 //  replace the -1 placeholders with your actual pins.
@@ -159,7 +164,8 @@ class cartesian : public Machine {
                 Matrix3x3( //bed level matrix. Coordinates are leveled by multiplying them with this matrix: P(leveled) = M*P(unleveled)
             1, 0, 0,
             0, 1, 0,
-            0, 0, 1));
+            0, 0, 1),
+                KinematicLimits(Vector4f(MAX_VEL_MM_SEC_XYZE), Vector4f(MAX_ACCEL_MM_SEC2_XYZE), Vector4f(MAX_STEP_RATE_XYZE)));
         }
         inline std::tuple<Fan, Servo, TempControl<RCThermistor2Pin, PID, LowPassFilter> > 
           getIoDrivers() const {
@@ -408,6 +408,12 @@
 #define HOME_RATE_MM_SEC 10         // Speed at which to home the endstops, in mm/s
 #define MAX_EXT_RATE_MM_SEC 150     // Maximum rate at which filament should ever be extruded, in mm of filament / s
 
+//Per-axis limits. Moves are slowed down just enough that no axis exceeds them.
+//  The step rate limits apply to the A, B, C & extruder motors, and are converted to effector velocity limits by the coordinate map.
+#define MAX_VEL_MM_SEC_XYZE        120, 120, 120, 150     // Maximum velocity of each axis, in mm/s
+#define MAX_ACCEL_MM_SEC2_XYZE     900, 900, 900, 2000    // Maximum acceleration of each axis, in mm/s^2
+#define MAX_STEP_RATE_ABCE         50000, 50000, 50000, 50000 // Maximum steps/sec each stepper driver can be given
+
 
 
 //#define DEFAULT_MAX_FEEDRATE {5000, 5000, 5000, 10000} // (mm/sec)
@@ -658,7 +664,8 @@ class firepickdelta : public Machine {
                 Matrix3x3(
                 1.000000000, 0.000000000, 0.000000000, 
                 0.000005356, 1.000000000, 0.000000000, 
-                0.000000000, 0.000000000, 1.000000000));
+                0.000000000, 0.000000000, 1.000000000),
+                KinematicLimits(Vector4f(MAX_VEL_MM_SEC_XYZE), Vector4f(MAX_ACCEL_MM_SEC2_XYZE), Vector4f(MAX_STEP_RATE_ABCE)));
         }
 
         //Expose default and maximum velocities:
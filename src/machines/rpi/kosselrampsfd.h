@@ -351,6 +351,7 @@
 #include "common/filters/lowpassfilter.h"
 #include "common/matrix.h"
 #include "motion/constantacceleration.h"
+#include "motion/scurveacceleration.h"
 #include "iodrivers/a4988.h"
 #include "motion/lineardeltacoordmap.h"
 #include "iodrivers/rcthermistor2pin.h"
@@ -382,10 +383,17 @@
 
 //Movement rates:
 #define MAX_ACCEL_MM_SEC2 900.000   // Maximum cartesian acceleration of end effector in mm / s^2
+#define MAX_JERK_MM_SEC3 20000.000  // Maximum rate of change of acceleration, in mm / s^3 (only used with SCurveAcceleration)
 #define MAX_MOVE_RATE_MM_SEC 120    // Maximum cartesian verlocity of end effector, in mm/s
 #define HOME_RATE_MM_SEC 10         // Speed at which to home the endstops, in mm/s
 #define MAX_EXT_RATE_MM_SEC 150     // Maximum rate at which filament should ever be extruded, in mm of filament / s
 
+//Per-axis limits. Moves are slowed down just enough that no axis exceeds them.
+//  The step rate limits apply to the A, B, C & extruder motors, and are converted to effector velocity limits by the coordinate map.
+#define MAX_VEL_MM_SEC_XYZE        120, 120, 120, 150     // Maximum velocity of each axis, in mm/s
+#define MAX_ACCEL_MM_SEC2_XYZE     900, 900, 900, 2000    // Maximum acceleration of each axis, in mm/s^2
+#define MAX_STEP_RATE_ABCE         50000, 50000, 50000, 50000 // Maximum steps/sec each stepper driver can be given
+
 
 //Pin Definitions:
 //Note: these are all physical pin numbers, as opposed to logical pin numbers.
@@ -514,6 +522,17 @@ using namespace motion; //for ConstantAcceleration & such
 
 class kosselrampsfd : public Machine {
     public:
+        //The delta dimensions are compile-time constants, which lets the kinematics be specialized for this machine.
+        //  (To configure them at runtime instead, drop the GeometryT template argument & pass them to the LinearDeltaCoordMap constructor)
+        struct Geometry {
+            static constexpr float r() { return R_MM; }
+            static constexpr float L() { return L_MM; }
+            static constexpr float h() { return H_MM; }
+            static constexpr float buildrad() { return BUILDRAD_MM; }
+            static constexpr float stepsPerMm() { return STEPS_MM; }
+            static constexpr float stepsPerMmExt() { return STEPS_MM_EXT; }
+        };
+        typedef LinearDeltaCoordMap<A4988, A4988, A4988, A4988, Matrix3x3, ConstexprLinearDeltaGeometry<Geometry> > CoordMapT;
 
         //return a list of miscellaneous IoDrivers (Endstops & A4988 drivers are reachable via <getCoordMap>)
         inline std::tuple<Fan, TempControl<RCThermistor2Pin, PID, LowPassFilter> > getIoDrivers() const {
@@ -545,6 +564,10 @@ class kosselrampsfd : public Machine {
         }
 
         //Define the acceleration method to use. This uses a constant acceleration (resulting in linear velocity).
+        //  To limit jerk (and thereby frame resonance, allowing for a higher MAX_ACCEL_MM_SEC2), use instead:
+        //  inline SCurveAcceleration getAccelerationProfile() const {
+        //      return SCurveAcceleration(MAX_ACCEL_MM_SEC2, MAX_JERK_MM_SEC3);
+        //  }
         inline ConstantAcceleration getAccelerationProfile() const {
             return ConstantAcceleration(MAX_ACCEL_MM_SEC2);
         }
@@ -552,13 +575,13 @@ class kosselrampsfd : public Machine {
         //Define the coordinate system:
         //  We are using a LinearDelta coordinate system, where vertically-moving carriages are
         //    attached to an end effector via fixed-length, rotatable rods.
-        inline LinearDeltaCoordMap<A4988, A4988, A4988, A4988> getCoordMap() const {
+        inline CoordMapT getCoordMap() const {
             //the Matrix3x3 defines the level of the bed:
             //  This is a matrix such that M * {x,y,z} should transform desired coordinates into a 
             //    bed-level-compensated equivalent.
             //  Usually, this is just a rotation matrix.
-            return LinearDeltaCoordMap<A4988, A4988, A4988, A4988>(
-                R_MM, L_MM, H_MM, BUILDRAD_MM, STEPS_MM, STEPS_MM_EXT, HOME_RATE_MM_SEC, 
+            return CoordMapT(
+                ConstexprLinearDeltaGeometry<Geometry>(), HOME_RATE_MM_SEC, 
                 //A tower:
                 A4988(IoPin(NO_INVERSIONS, PIN_STEPPER_A_STEP), 
                       IoPin(NO_INVERSIONS, PIN_STEPPER_A_DIR), 
@@ -583,7 +606,8 @@ class kosselrampsfd : public Machine {
                 Matrix3x3(
                 0.999975003, 0.000005356, -0.007070522, 
                 0.000005356, 0.999998852, 0.001515111, 
-                0.007070522, -0.001515111, 0.999973855));
+                0.007070522, -0.001515111, 0.999973855),
+                KinematicLimits(Vector4f(MAX_VEL_MM_SEC_XYZE), Vector4f(MAX_ACCEL_MM_SEC2_XYZE), Vector4f(MAX_STEP_RATE_ABCE)));
         }
 
         //Expose default and maximum velocities:
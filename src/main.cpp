@@ -47,9 +47,14 @@
 #include "catch.hpp"
 
 #include <string>
+#include <cstdlib> //for atoi, atof
+#include <stdexcept> //for runtime_error
+#include <chrono>
 #include <sys/mman.h> //for mlockall
 #include <iostream> //for std::cin
 #include "common/logging.h"
+#include "common/allocaudit.h"
+#include "schedulerbase.h"
 
 #include "gparse/com.h"
 #include "state.h"
@@ -67,13 +72,24 @@
 
 static void printUsage(char* cmd) {
     //#ifndef NO_USAGE_INFO
-    LOGE("usage: %s [input-file] [output-file] [--help] [--quiet] [--verbose] [--do-tests [CATCH-arguments ...] ]\n", cmd);
+    LOGE("usage: %s [input-file] [output-file] [--help] [--quiet] [--verbose] [--abort-on-alloc] [--rt-priority <1-99>] [--rt-cpu <cpu>] [--other-cpus <cpu-list>] [--prefault-stack <KiB>] [--prefault-heap <KiB>] [--parallel-steps] [--socket <path>] [--status-shm <name>] [--status-rate <hz>] [--latency-trace <path>] [--do-tests [CATCH-arguments ...] ]\n", cmd);
     LOGE("  if input-file is not provided, it defaults to stdin\n");
     LOGE("  if output-file is not provided, it defaults to strout\n");
+    LOGE("  --socket listens for hosts on a unix socket instead of using input-file/output-file. The first host to connect controls the printer; any others may only monitor\n");
+    LOGE("  --rt-priority sets the SCHED_FIFO priority of the event loop (default %i)\n", SCHED_PRIORITY);
+    LOGE("  --rt-cpu pins the event loop to one cpu; all other threads are then kept off of that cpu\n");
+    LOGE("  --other-cpus restricts all other threads to a list of cpus, e.g. 0-2 or 0,1\n");
+    LOGE("  --prefault-stack and --prefault-heap set how much memory to fault in before printing (defaults 256 and 4096 KiB)\n");
+    LOGE("  --parallel-steps generates each axis' steps on its own thread, for hosts with idle cpus\n");
+    LOGE("  --status-shm publishes the machine status in a POSIX shared memory object (e.g. %s) that monitors can read with util/printipi-status instead of polling M105/M114\n", PRINTIPI_STATUS_DEFAULT_NAME);
+    LOGE("  --status-rate sets how many times per second the shared status is updated (default 10)\n");
+    LOGE("  --latency-trace writes the time each command spent being queued, executed, planned and stepped to a file. Histograms of these are always available via M881\n");
     LOGE("  --do-tests is only recognized if program was compiled with ENABLE_TESTS=1\n");
+    LOGE("  --abort-on-alloc is only recognized if program was compiled with ALLOC_AUDIT=1\n");
     LOGE("examples:\n");
     LOGE("  print a gcode file: %s file.gcode\n", cmd);
     LOGE("  mock serial port: %s /dev/tty3dpm /dev/tty3dps\n", cmd);
+    LOGE("  serve hosts directly: %s --socket /tmp/printipi.sock\n", cmd);
 }
 
 int main_(int fullArgc, char **argv) {
@@ -91,6 +107,9 @@ int main_(int fullArgc, char **argv) {
     if (argparse::cmdOptionExists(argv, argv+argc, "--verbose")) {
         logging::enableVerbose();
     }
+    if (argparse::cmdOptionExists(argv, argv+argc, "--abort-on-alloc")) {
+        allocaudit::setAbortOnAlloc();
+    }
     if (argparse::cmdOptionExists(argv, argv+argc, "-h") || argparse::cmdOptionExists(argv, argv+argc, "--help")) {
         printUsage(argv[0]);
         return 0;
@@ -102,6 +121,23 @@ int main_(int fullArgc, char **argv) {
     LOG("Filesystem root: %s\n", fsRoot.c_str());
     FileSystem fs(fsRoot);
 
+    //real-time configuration; applied to the event loop thread in Scheduler::initSchedThread
+    if (char *rtPriorityArg = argparse::getArgumentForCmdOption(argv, argv+argc, "--rt-priority")) {
+        SchedulerBase::setSchedPriority(atoi(rtPriorityArg));
+    }
+    if (char *rtCpuArg = argparse::getArgumentForCmdOption(argv, argv+argc, "--rt-cpu")) {
+        SchedulerBase::setSchedCpu(atoi(rtCpuArg));
+    }
+    char *otherCpusArg = argparse::getArgumentForCmdOption(argv, argv+argc, "--other-cpus");
+    char *prefaultStackArg = argparse::getArgumentForCmdOption(argv, argv+argc, "--prefault-stack");
+    char *prefaultHeapArg = argparse::getArgumentForCmdOption(argv, argv+argc, "--prefault-heap");
+    std::size_t prefaultStackKb = prefaultStackArg ? SchedulerBase::parsePrefaultStackKiB(prefaultStackArg) : 256;
+    std::size_t prefaultHeapKb = prefaultHeapArg ? SchedulerBase::parsePrefaultHeapKiB(prefaultHeapArg) : 4096;
+    char *statusShmArg = argparse::getArgumentForCmdOption(argv, argv+argc, "--status-shm");
+    char *statusRateArg = argparse::getArgumentForCmdOption(argv, argv+argc, "--status-rate");
+    float statusRate = statusRateArg ? atof(statusRateArg) : 10;
+    char *latencyTraceArg = argparse::getArgumentForCmdOption(argv, argv+argc, "--latency-trace");
+
     #if ENABLE_TESTS
         if (doTestsArgIdx != -1) {
             // prepare arguments for the test suite:
@@ -120,9 +156,15 @@ int main_(int fullArgc, char **argv) {
     //  whereas if it's a gcode file, then calls to M32 (print from file) should pause the original input file
     bool keepPersistentCom = false;
 
-    //if no arguments, or if first argument (and therefore all args) is an option, 
-    //  then take gcode commands from stdin
-    if (argc < 2 || argv[1][0] == '-') { 
+    char *socketPathArg = argparse::getArgumentForCmdOption(argv, argv+argc, "--socket");
+    if (socketPathArg) {
+        //serve hosts that connect to a unix socket, rather than a file or stdin.
+        com = gparse::Com(std::unique_ptr<gparse::UnixSocketServer>(new gparse::UnixSocketServer(socketPathArg)));
+        //hosts may come & go, but the socket must stay open
+        keepPersistentCom = true;
+    } else if (argc < 2 || argv[1][0] == '-') { 
+        //if no arguments, or if first argument (and therefore all args) is an option, 
+        //  then take gcode commands from stdin
         //std::cin does not allow to check if there are characters to be read, whereas /dev/stdin DOES.
         //  we need nonblocking I/O, so this is crucial.
         //com = std::move(gparse::Com(gparse::Com::shareOwnership(&std::cin)));
@@ -147,8 +189,29 @@ int main_(int fullArgc, char **argv) {
     if (retval) {
         LOGW("Warning: mlockall (prevent memory swaps) in main.cpp::main() returned non-zero: %i\n", retval);
     }
+    //fault in (and thereby lock) memory now, rather than taking page faults during the first print
+    SchedulerBase::prefaultMemory(prefaultStackKb*1024, prefaultHeapKb*1024);
+    //keep every other thread (e.g. logging) off of the event loop's cpu.
+    //Note: this includes the current thread, which then re-pins itself to the event loop cpu in initSchedThread.
+    if (otherCpusArg) {
+        SchedulerBase::pinAllThreads(SchedulerBase::parseCpuList(otherCpusArg));
+    } else if (SchedulerBase::getSchedCpu() >= 0) {
+        SchedulerBase::pinAllThreads(SchedulerBase::cpusExcept(SchedulerBase::getSchedCpu()));
+    }
         
     State<machines::MACHINE> state(machines::MACHINE(), fs, keepPersistentCom);
+    //the step workers are created now, so they inherit the cpu affinity of non-event-loop threads
+    state.setParallelStepGeneration(argparse::cmdOptionExists(argv, argv+argc, "--parallel-steps"));
+    if (statusShmArg) {
+        if (statusRate <= 0) {
+            throw std::runtime_error("--status-rate must be positive");
+        }
+        state.publishStatus(statusShmArg, std::chrono::duration_cast<EventClockT::duration>(std::chrono::duration<float>(1.f/statusRate)));
+        LOG("Publishing status to shared memory object %s at %.1f Hz\n", statusShmArg, statusRate);
+    }
+    if (latencyTraceArg) {
+        state.traceLatencies(latencyTraceArg);
+    }
     state.addComChannel(std::move(com));
     state.eventLoop();
     return 0;
@@ -25,6 +25,8 @@
 #ifndef MOTION_ACCELERATIONPROFILE_H
 #define MOTION_ACCELERATIONPROFILE_H
 
+#include <cmath> //for INFINITY
+
 namespace motion {
 
 /* 
@@ -40,8 +42,10 @@ namespace motion {
  */
 struct AccelerationProfile {
 	//Optional, but almost surely needed:
-    inline void begin(float moveDuration, float Vmax) {
-    	(void)moveDuration; (void)Vmax; //unused
+    //@maxAccel is the acceleration limit (along the path) of the upcoming move, which may be tighter than the profile's own limit
+    //  if the move involves slow axes (see KinematicLimits)
+    inline void begin(float moveDuration, float Vmax, float maxAccel=INFINITY) {
+    	(void)moveDuration; (void)Vmax; (void)maxAccel; //unused
     }
     //float transform(float inp, float moveDuration, float Vmax);
 };
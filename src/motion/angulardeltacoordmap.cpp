@@ -0,0 +1,52 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cmath> //for std::fabs
+#include "angulardeltacoordmap.h"
+#include "iodrivers/a4988.h"
+#include "catch.hpp"
+
+using namespace motion;
+using namespace iodrv;
+
+TEST_CASE("AngularDeltaCoordMap converts motor step rate limits to effector velocity limits", "[angulardeltacoordmap]") {
+    //dimensions of the FirePick delta
+    const float stepsPerDegree = 400*16/360.f;
+    AngularDeltaCoordMap<A4988, A4988, A4988, A4988> map(131.636, 190.526, 270, 90, 268, 150, stepsPerDegree, 30*16, 10, -67.2,
+        A4988(IoPin::null(), IoPin::null(), IoPin::null()), A4988(IoPin::null(), IoPin::null(), IoPin::null()),
+        A4988(IoPin::null(), IoPin::null(), IoPin::null()), A4988(IoPin::null(), IoPin::null(), IoPin::null()),
+        Endstop(), Endstop(), Endstop(), Matrix3x3::identity(),
+        KinematicLimits(Vector4f(INFINITY, INFINITY, INFINITY, INFINITY), Vector4f(INFINITY, INFINITY, INFINITY, INFINITY),
+            Vector4f(10000, 10000, 10000, 4800)));
+    KinematicLimits limits = map.kinematicLimits();
+    REQUIRE(limits.maxVelocity.e() == Approx(10.f));
+    //with the arms horizontal, turning all motors equally moves the effector straight along z,
+    //  so the z limit is the distance covered by turning the motors by 10000 steps per second.
+    std::array<int, 4> below = {{ -100, -100, -100, 0 }}, above = {{ 100, 100, 100, 0 }};
+    float mmPerStep = std::fabs(map.xyzeFromMechanical(above).z() - map.xyzeFromMechanical(below).z()) / 200;
+    REQUIRE(std::fabs(limits.maxVelocity.z() / (10000 * mmPerStep) - 1) < 0.01);
+    //x & y are limited too, by the motor that turns fastest
+    REQUIRE(std::isfinite(limits.maxVelocity.x()));
+    REQUIRE(limits.maxVelocity.x() > 0);
+    REQUIRE(std::isfinite(limits.maxVelocity.y()));
+    REQUIRE(limits.maxVelocity.y() > 0);
+}
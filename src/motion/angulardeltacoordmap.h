@@ -24,7 +24,9 @@
 #ifndef MOTION_ANGULARDELTACOORDMAP_H
 #define MOTION_ANGULARDELTACOORDMAP_H
 
+#include <algorithm> //for std::min, std::max
 #include <array>
+#include <cmath> //for std::fabs
 #include <tuple>
 #include <utility> //for std::move
 #include <tuple>
@@ -53,6 +55,10 @@ namespace motion {
  * L1000 is 'L' (in mm) multiplied by 1000
  *
  * The math is described more in /code/proof-of-concept/coordmath.py and coord-math.nb (note: file has been deleted; must view an archived version of printipi on Github to view this documentation)
+ *
+ * The optional KinematicLimits apply to the cartesian axes, except for the step rate limits of x, y & z, which apply to
+ *   the A, B & C motors. Those are converted into velocity limits using the motor steps per mm of effector motion 
+ *   with the arms horizontal (see stepsPerMmAtHorizon), so they are approximate far from that position.
  */
 
 template <typename Stepper1, typename Stepper2, typename Stepper3, typename Stepper4, typename BedLevelT=Matrix3x3> class AngularDeltaCoordMap : public CoordMap {
@@ -69,6 +75,7 @@ template <typename Stepper1, typename Stepper2, typename Stepper3, typename Step
     float homeVelocity;
     float homeAngle; //the angle at which the endstops are positioned
     BedLevelT bedLevel;
+    KinematicLimits limits;
 
     std::array<iodrv::Endstop, 4> endstops; //A, B, C and E (E is null)
     StepperDriverTypes stepperDrivers;    
@@ -108,7 +115,8 @@ template <typename Stepper1, typename Stepper2, typename Stepper3, typename Step
             	iodrv::Endstop &&endstopA,
 		iodrv::Endstop &&endstopB, 
 		iodrv::Endstop &&endstopC, 
-		const BedLevelT &t)
+		const BedLevelT &t,
+		const KinematicLimits &limits=KinematicLimits())
 
 	        :
 		e(e),
@@ -122,6 +130,7 @@ template <typename Stepper1, typename Stepper2, typename Stepper3, typename Step
            	homeVelocity(homeVelocity),
             homeAngle(homeAngle),
            	bedLevel(t),
+           	limits(limits),
 
            	endstops({{
 			std::move(endstopA), 
@@ -134,7 +143,13 @@ template <typename Stepper1, typename Stepper2, typename Stepper3, typename Step
 			std::move(stepper1), 
 			std::move(stepper2), 
 			std::move(stepper3), 
-			std::move(stepper4)) {}
+			std::move(stepper4)) {
+            //the motors share one step rate limit: the tightest of the three
+            float motorRate = std::min(limits.maxStepRate.x(), std::min(limits.maxStepRate.y(), limits.maxStepRate.z()));
+            this->limits.maxVelocity = KinematicLimits(limits.maxVelocity, limits.maxAcceleration, 
+                Vector4f(motorRate, motorRate, motorRate, limits.maxStepRate.e()))
+              .effectiveMaxVelocity(Vector4f(stepsPerMmAtHorizon(), _STEPS_MM_EXT));
+        }
 
 	        inline std::tuple<
 				Stepper1&, 
@@ -226,6 +241,45 @@ template <typename Stepper1, typename Stepper2, typename Stepper3, typename Step
         inline bool doHomeBeforeFirstMovement() const {
             return false;
         }
+        inline KinematicLimits kinematicLimits() const {
+            return limits;
+        }
+        //@return the number of steps the fastest-turning motor takes per mm of effector motion along x, y & z,
+        //  with the arms horizontal. Found by inverting the jacobian of the forward kinematics (estimated by central differences).
+        Vector3f stepsPerMmAtHorizon() const {
+            const float dTheta = 0.1; //degrees
+            //jacobian[axis][motor] = mm of effector motion along axis per degree of motor rotation
+            float jacobian[3][3];
+            for (int motor=0; motor<3; ++motor) {
+                float theta[2][3] = {{0, 0, 0}, {0, 0, 0}};
+                theta[0][motor] = -dTheta;
+                theta[1][motor] = dTheta;
+                float lo[3], hi[3];
+                delta_calcForward(theta[0][0], theta[0][1], theta[0][2], lo[0], lo[1], lo[2]);
+                delta_calcForward(theta[1][0], theta[1][1], theta[1][2], hi[0], hi[1], hi[2]);
+                for (int axis=0; axis<3; ++axis) {
+                    jacobian[axis][motor] = (hi[axis]-lo[axis]) / (2*dTheta);
+                }
+            }
+            //inverse[motor][axis] = cofactor[axis][motor] / det
+            float cofactor[3][3];
+            for (int i=0; i<3; ++i) {
+                for (int j=0; j<3; ++j) {
+                    cofactor[i][j] = jacobian[(i+1)%3][(j+1)%3]*jacobian[(i+2)%3][(j+2)%3] 
+                                   - jacobian[(i+1)%3][(j+2)%3]*jacobian[(i+2)%3][(j+1)%3];
+                }
+            }
+            float det = jacobian[0][0]*cofactor[0][0] + jacobian[0][1]*cofactor[0][1] + jacobian[0][2]*cofactor[0][2];
+            float stepsPerMm[3];
+            for (int axis=0; axis<3; ++axis) {
+                float degreesPerMm = 0;
+                for (int motor=0; motor<3; ++motor) {
+                    degreesPerMm = std::max(degreesPerMm, std::fabs(cofactor[axis][motor] / det));
+                }
+                stepsPerMm[axis] = degreesPerMm * STEPS_DEGREE();
+            }
+            return Vector3f(stepsPerMm[0], stepsPerMm[1], stepsPerMm[2]);
+        }
     private:
         // Function taken from http://forums.trossenrobotics.com/tutorials/introduction-129/delta-robot-kinematics-3276/
         // forward kinematics: (theta1, theta2, theta3) -> (x0, y0, z0)
@@ -158,13 +158,13 @@ template <typename StepperDriverT> class AngularDeltaStepper : public AxisSteppe
 
         //function to initiate a linear (through cartesian space) motion
         template <typename CoordMapT, std::size_t sz> void beginLine(const CoordMapT &map, const std::array<int, sz>& curPos, 
-        const Vector4f &vel) {
+        const Vector4f &curXyze, const Vector4f &vel) {
             this->M0_rad = map.getAxisPosition(curPos, axisIdx)*RADIANS_STEP(); 
             this->sTotal = 0;
-            this->time = 0;
             this->isArcMotion = false;
-            Vector3f line_P0 = map.xyzeFromMechanical(curPos).xyz();
+            Vector3f line_P0 = curXyze.xyz();
             Vector3f line_v = vel.xyz();
+            this->time = this->earliestStepTime(line_v.mag());
 
             // rotate the cartesian position function into our flat YZ reference frame
             auto rot = Matrix3x3::rotationAboutPositiveZ(-w);
@@ -177,12 +177,12 @@ template <typename StepperDriverT> class AngularDeltaStepper : public AxisSteppe
         }
         //function to initiate a circular arc (through cartesian space) motion
         template <typename CoordMapT, std::size_t sz> void beginArc(const CoordMapT &map, const std::array<int, sz> &curPos, 
-        const Vector3f &center, const Vector3f &u, const Vector3f &v,  
+        const Vector4f &curXyze, const Vector3f &center, const Vector3f &u, const Vector3f &v,  
         float arcRad, float arcVel, float extVel) {
-            (void)extVel; //unused
+            (void)curXyze; (void)extVel; //unused
             this->M0_rad = map.getAxisPosition(curPos, axisIdx)*RADIANS_STEP(); 
             this->sTotal = 0;
-            this->time = 0;
+            this->time = this->earliestStepTime(std::fabs(arcRad*arcVel));
             this->isArcMotion = true;
 
             // rotate the cartesian position function into our flat YZ reference frame
@@ -362,6 +362,9 @@ template <typename StepperDriverT> class AngularDeltaStepper : public AxisSteppe
                         ++this->sTotal;
                     }
                 }
+                if (this->time < 0) {
+                    this->time = 0; //a step that came due just before the move began is taken at its start
+                }
             }
         }
 };
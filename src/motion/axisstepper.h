@@ -72,12 +72,22 @@ class AxisStepper {
         StepDirection direction; //direction of next step
         inline int index() const { return _index; } //NOT TO BE OVERRIDEN
         
-        template <typename TupleT> static AxisStepper& getNextTime(TupleT &axes);
-        template <typename TupleT, typename CoordMapT, std::size_t MechSize> static void initAxisSteppers(TupleT &steppers, bool useEndstops, const CoordMapT &map, const std::array<int, MechSize>& curPos, const Vector4f &vel);
-        template <typename TupleT, typename CoordMapT, std::size_t MechSize> static void initAxisArcSteppers(TupleT &steppers, bool useEndstops, const CoordMapT &map, const std::array<int, MechSize>& curPos, const Vector3f &center, const Vector3f &u, const Vector3f &v, float arcRad, float arcVel, float extVel);
+        //@curXyze is the cartesian position that the move is planned from. This is where the previous move was aimed, 
+        //  so it may be a fraction of a step ahead of @curPos; steppers target absolute step positions so that this fraction isn't lost.
+        template <typename TupleT, typename CoordMapT, std::size_t MechSize> static void initAxisSteppers(TupleT &steppers, bool useEndstops, const CoordMapT &map, const std::array<int, MechSize>& curPos, const Vector4f &curXyze, const Vector4f &vel);
+        template <typename TupleT, typename CoordMapT, std::size_t MechSize> static void initAxisArcSteppers(TupleT &steppers, bool useEndstops, const CoordMapT &map, const std::array<int, MechSize>& curPos, const Vector4f &curXyze, const Vector3f &center, const Vector3f &u, const Vector3f &v, float arcRad, float arcVel, float extVel);
         template <typename TupleT> void nextStep(TupleT &axes, bool useEndstops); //NOT TO BE OVERRIDEN
     protected:
         AxisStepper(int idx) : _index(idx) {} //only callable via children
+        //The step that the previous move ended just short of may come due a hair before the next move begins, through rounding.
+        //  Steps within this distance (in mm of effector travel) before the start of a move are taken at its start rather than skipped.
+        static constexpr float startTolerance() {
+            return 1e-4f;
+        }
+        //@return the time (<= 0) from which to search for the first step of a move whose effector travels at @speed (mm/sec)
+        static inline float earliestStepTime(float speed) {
+            return speed > 0 ? -startTolerance()/speed : 0;
+        }
         //OVERRIDE THIS. And yes, it will be called upon initialization too.
         inline void _nextStep(bool useEndstops) {
             //should be implemented in derivatives.
@@ -94,50 +104,30 @@ template <typename StepperDriver> class AxisStepperWithDriver : public AxisStepp
          -> decltype(driver->getEventOutputSequence(absoluteTime, direction)) {
             return driver->getEventOutputSequence(absoluteTime, this->direction);
         }
+        //get the OutputEvents for a step in direction @dir, which may differ from the direction of the next step (this->direction)
+        inline auto getStepOutputEventSequence(EventClockT::time_point absoluteTime, StepDirection dir) const
+         -> decltype(driver->getEventOutputSequence(absoluteTime, dir)) {
+            return driver->getEventOutputSequence(absoluteTime, dir);
+        }
 };
 
 namespace {
     //place helper functions in an unnamed namespace to limit visibility and hint the documentation generator
 
-    //Helper classes for AxisStepper::getNextTime method
-    //C++ doesn't support partial template function specialization, so we need to use templated classes instead.
-    //Below function(s) select the AxisStepper with the smallest time attribute from a tuple of such AxisSteppers
-    template <typename TupleT, int idx> struct _AxisStepper__getNextTime {
-        AxisStepper& operator()(TupleT &axes) {
-            AxisStepper &m1 = _AxisStepper__getNextTime<TupleT, idx-1>()(axes);
-            AxisStepper &m2 = std::get<idx>(axes);
-            //assume that .time can be finite, infinite, or NaN.
-            //comparisons against NaN are ALWAYS false.
-            if (m1.time <= 0) { return m2; } //if one of the times is non-positive (ie no next step), return the other one.
-            if (m2.time <= 0) { return m1; }
-            //Now return the smallest of the two, discarding any NaNs:
-            //if m2.time == NaN, then (m1.time < m2.time || isnan(m2.time)) ? m1 : m2 will return m1.time
-            //elif m1.time == NaN, then (m1.time < m2.time || isnan(m2.time)) ? m1 : m2 will return m2.time
-            return (m1.time < m2.time || std::isnan(m2.time)) ? m1 : m2;
-        }
-    };
-
-    //TODO: re-implement with tupleutil
-    template <typename TupleT> struct _AxisStepper__getNextTime<TupleT, 0> {
-        AxisStepper& operator()(TupleT &axes) {
-            return std::get<0>(axes);
-        }
-    };
-
     //Helper class for AxisStepper::initAxisSteppers
     struct _AxisStepper__initAxisSteppers {
-        template <std::size_t MyIdx, typename TupleT, typename T, typename CoordMapT, std::size_t MechSize> void operator()(std::integral_constant<std::size_t, MyIdx> _myIdx, T &stepper, TupleT *steppers, bool useEndstops, const CoordMapT *map, std::array<int, MechSize>& curPos, const Vector4f &vel) {
+        template <std::size_t MyIdx, typename TupleT, typename T, typename CoordMapT, std::size_t MechSize> void operator()(std::integral_constant<std::size_t, MyIdx> _myIdx, T &stepper, TupleT *steppers, bool useEndstops, const CoordMapT *map, std::array<int, MechSize>& curPos, const Vector4f &curXyze, const Vector4f &vel) {
             (void)_myIdx; (void)stepper; //unused
-            std::get<MyIdx>(*steppers).beginLine(*map, curPos, vel);
+            std::get<MyIdx>(*steppers).beginLine(*map, curPos, curXyze, vel);
             std::get<MyIdx>(*steppers)._nextStep(useEndstops);
         }
     };
 
     //Helper class for AxisStepper::initAxisArcSteppers
     struct _AxisStepper__initAxisArcSteppers {
-        template <std::size_t MyIdx, typename TupleT, typename T, typename CoordMapT, std::size_t MechSize> void operator()(std::integral_constant<std::size_t, MyIdx> _myIdx, T &stepper, TupleT *steppers, bool useEndstops, const CoordMapT *map, std::array<int, MechSize>& curPos, const Vector3f &center, const Vector3f &u, const Vector3f &v, float arcRad, float arcVel, float extVel) {
+        template <std::size_t MyIdx, typename TupleT, typename T, typename CoordMapT, std::size_t MechSize> void operator()(std::integral_constant<std::size_t, MyIdx> _myIdx, T &stepper, TupleT *steppers, bool useEndstops, const CoordMapT *map, std::array<int, MechSize>& curPos, const Vector4f &curXyze, const Vector3f &center, const Vector3f &u, const Vector3f &v, float arcRad, float arcVel, float extVel) {
             (void)_myIdx; (void)stepper; //unused
-            std::get<MyIdx>(*steppers).beginArc(*map, curPos, center, u, v, arcRad, arcVel, extVel);
+            std::get<MyIdx>(*steppers).beginArc(*map, curPos, curXyze, center, u, v, arcRad, arcVel, extVel);
             std::get<MyIdx>(*steppers)._nextStep(useEndstops);
         }
     };
@@ -158,14 +148,11 @@ namespace {
 
 
 
-template <typename TupleT> AxisStepper& AxisStepper::getNextTime(TupleT &axes) {
-    return _AxisStepper__getNextTime<TupleT, std::tuple_size<TupleT>::value-1>()(axes);
-}
-template <typename TupleT, typename CoordMapT, std::size_t MechSize> void AxisStepper::initAxisSteppers(TupleT &steppers, bool useEndstops, const CoordMapT &map, const std::array<int, MechSize>& curPos, const Vector4f &vel) {
-    callOnAll(steppers, _AxisStepper__initAxisSteppers(), &steppers, useEndstops, &map, curPos, vel);
+template <typename TupleT, typename CoordMapT, std::size_t MechSize> void AxisStepper::initAxisSteppers(TupleT &steppers, bool useEndstops, const CoordMapT &map, const std::array<int, MechSize>& curPos, const Vector4f &curXyze, const Vector4f &vel) {
+    callOnAll(steppers, _AxisStepper__initAxisSteppers(), &steppers, useEndstops, &map, curPos, curXyze, vel);
 }
-template <typename TupleT, typename CoordMapT, std::size_t MechSize> void AxisStepper::initAxisArcSteppers(TupleT &steppers, bool useEndstops, const CoordMapT &map, const std::array<int, MechSize>& curPos, const Vector3f &center, const Vector3f &u, const Vector3f &v, float arcRad, float arcVel, float extVel) {
-    callOnAll(steppers, _AxisStepper__initAxisArcSteppers(), &steppers, useEndstops, &map, curPos, center, u, v, arcRad, arcVel, extVel);
+template <typename TupleT, typename CoordMapT, std::size_t MechSize> void AxisStepper::initAxisArcSteppers(TupleT &steppers, bool useEndstops, const CoordMapT &map, const std::array<int, MechSize>& curPos, const Vector4f &curXyze, const Vector3f &center, const Vector3f &u, const Vector3f &v, float arcRad, float arcVel, float extVel) {
+    callOnAll(steppers, _AxisStepper__initAxisArcSteppers(), &steppers, useEndstops, &map, curPos, curXyze, center, u, v, arcRad, arcVel, extVel);
 }
 template <typename TupleT> void AxisStepper::nextStep(TupleT &axes, bool useEndstops) {
     callOnAll(axes, _AxisStepper__nextStep(), this->index(), useEndstops);
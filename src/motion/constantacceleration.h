@@ -47,13 +47,14 @@ class ConstantAcceleration : public AccelerationProfile {
     inline float a() const { return _accel; }
     public:
         inline ConstantAcceleration(float accel) : _accel(accel) {}
-        inline void begin(float moveDuration, float Vmax) {
+        inline void begin(float moveDuration, float Vmax, float maxAccel=INFINITY) {
+            float a = std::min(this->a(), maxAccel);
             this->moveDuration = moveDuration;
-            this->tmax1 = Vmax/2/a();
-            this->tmax2 = std::isnan(moveDuration) ? INFINITY : moveDuration - Vmax/2/a();
+            this->tmax1 = Vmax/2/a;
+            this->tmax2 = std::isnan(moveDuration) ? INFINITY : moveDuration - Vmax/2/a;
             this->tmax1 = std::min(tmax1, tmax2); //for really short movements, we may not be able to fully accelerate.
-            this->tbase3 = moveDuration + Vmax/a(); //TODO: is this the true tbase3 for short movements?
-            this->twiceVmax_a = 2*Vmax/a();
+            this->tbase3 = moveDuration + Vmax/a; //TODO: is this the true tbase3 for short movements?
+            this->twiceVmax_a = 2*Vmax/a;
             LOGD("Accel::begin dur, Vmax: %f, %f\n", moveDuration, Vmax);
             LOGD("Accel::begin tmax1, tmax2, tbase3, twiceVmax_a: %f, %f, %f, %f\n", tmax1, tmax2, tbase3, twiceVmax_a);
         }
@@ -30,6 +30,7 @@
 #include "common/vector3.h"
 #include "common/vector4.h"
 #include "common/logging.h"
+#include "kinematiclimits.h"
 
 namespace iodrv { 
     //forward declare for class in "endstop.h"
@@ -90,6 +91,11 @@ class CoordMap {
             LOGW_ONCE("xyzeFromMechanical should be implemented in CoordMap implementations\n");
             return Vector4f(0, 0, 0, 0);
         }
+        //@return the velocity & acceleration limits of each cartesian axis (see kinematiclimits.h).
+        //  Any step-rate limits should already be accounted for in the velocity limits (see KinematicLimits::effectiveMaxVelocity).
+        inline KinematicLimits kinematicLimits() const {
+            return KinematicLimits();
+        }
         //if we get a G1 before the first G28, then we *probably* want to home first,
         //    but feel free to override this in other implementations.
         inline bool doHomeBeforeFirstMovement() const {
@@ -0,0 +1,86 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MOTION_KINEMATICLIMITS_H
+#define MOTION_KINEMATICLIMITS_H
+
+#include <array>
+#include <cmath> //for INFINITY, std::fabs
+#include <algorithm> //for std::min
+#include "common/vector4.h"
+
+namespace motion {
+
+/* 
+ * KinematicLimits describes how fast each cartesian axis (x, y, z, e) may move, independently of the others.
+ * Z and E are usually much slower than XY, and limiting each axis separately allows the planner to 
+ *   move at full speed in XY while only slowing down the moves that actually involve a slow axis.
+ *
+ * A CoordMap exposes its limits via kinematicLimits(), and the MotionPlanner scales each segment's
+ *   velocity and acceleration such that no axis exceeds its limit.
+ * Any component may be INFINITY to indicate that the axis is unconstrained.
+ */
+struct KinematicLimits {
+    //maximum velocity of each axis, in mm/sec
+    Vector4f maxVelocity;
+    //maximum acceleration of each axis, in mm/sec^2
+    Vector4f maxAcceleration;
+    //maximum number of steps per second each axis' stepper driver can be given.
+    //For CoordMaps whose motors don't each drive one cartesian axis (e.g. deltas), the x, y & z components 
+    //  are the limits of the first three motors, and the CoordMap converts them (see LinearDeltaCoordMap).
+    Vector4f maxStepRate;
+    inline KinematicLimits(const Vector4f &maxVelocity=unlimitedVec(), const Vector4f &maxAcceleration=unlimitedVec(), const Vector4f &maxStepRate=unlimitedVec())
+     : maxVelocity(maxVelocity), maxAcceleration(maxAcceleration), maxStepRate(maxStepRate) {}
+    inline static Vector4f unlimitedVec() {
+        return Vector4f(INFINITY, INFINITY, INFINITY, INFINITY);
+    }
+
+    //@return the velocity limit of each axis after also accounting for its step rate, given the number of steps per mm of each axis
+    inline Vector4f effectiveMaxVelocity(const Vector4f &stepsPerMm) const {
+        std::array<float, 4> vel = maxVelocity.array();
+        std::array<float, 4> rate = maxStepRate.array();
+        std::array<float, 4> steps = stepsPerMm.array();
+        for (std::size_t i=0; i<4; ++i) {
+            vel[i] = std::min(vel[i], rate[i] / steps[i]);
+        }
+        return Vector4f(vel[0], vel[1], vel[2], vel[3]);
+    }
+    //Given @axisRatios, the largest magnitude of each axis' velocity per unit of velocity along the path,
+    //  @return the largest path velocity at which no axis exceeds its limit in @maxAxisRate (e.g. maxVelocity)
+    inline static float maxPathRate(const Vector4f &maxAxisRate, const Vector4f &axisRatios) {
+        std::array<float, 4> limits = maxAxisRate.array();
+        std::array<float, 4> ratios = axisRatios.array();
+        float rate = INFINITY;
+        for (std::size_t i=0; i<4; ++i) {
+            //an axis that doesn't move in this segment (ratio == 0) doesn't constrain it
+            if (ratios[i] > 0) {
+                rate = std::min(rate, limits[i] / ratios[i]);
+            }
+        }
+        return rate;
+    }
+};
+
+}
+
+#endif
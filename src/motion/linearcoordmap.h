@@ -54,6 +54,7 @@ template <typename Stepper1, typename Stepper2, typename Stepper3, typename Step
     float _STEPS_MM_E, _MM_STEPS_E;
     float homeVelocity;
     BedLevelT bedLevel;
+    KinematicLimits limits;
     std::array<iodrv::Endstop, 4> endstops; //x, y, z, e (null)
     StepperDriverTypes stepperDrivers;
     public:
@@ -70,15 +71,19 @@ template <typename Stepper1, typename Stepper2, typename Stepper3, typename Step
         inline LinearCoordMap(float STEPS_MM_X, float STEPS_MM_Y, float STEPS_MM_Z, float STEPS_MM_E, float homeVelocity, 
           Stepper1 &&stepper1, Stepper2 &&stepper2, Stepper3 &&stepper3, Stepper4 &&stepper4,
           iodrv::Endstop &&endstopX, iodrv::Endstop &&endstopY, iodrv::Endstop &&endstopZ,
-          const BedLevelT& t)
+          const BedLevelT& t, const KinematicLimits &limits=KinematicLimits())
          : _STEPS_MM_X(STEPS_MM_X), _MM_STEPS_X(1. / STEPS_MM_X),
            _STEPS_MM_Y(STEPS_MM_Y), _MM_STEPS_Y(1. / STEPS_MM_Y),
            _STEPS_MM_Z(STEPS_MM_Z), _MM_STEPS_Z(1. / STEPS_MM_Z),
            _STEPS_MM_E(STEPS_MM_E), _MM_STEPS_E(1. / STEPS_MM_E),
            homeVelocity(homeVelocity),
            bedLevel(t),
+           limits(limits),
            endstops({{std::move(endstopX), std::move(endstopY), std::move(endstopZ), std::move(iodrv::Endstop())}}),
-           stepperDrivers(std::move(stepper1), std::move(stepper2), std::move(stepper3), std::move(stepper4)) {}
+           stepperDrivers(std::move(stepper1), std::move(stepper2), std::move(stepper3), std::move(stepper4)) {
+            //each cartesian axis is driven by exactly one motor, so the step rate limits translate directly to velocity limits
+            this->limits.maxVelocity = limits.effectiveMaxVelocity(Vector4f(STEPS_MM_X, STEPS_MM_Y, STEPS_MM_Z, STEPS_MM_E));
+        }
         inline std::tuple<Stepper1&, Stepper2&, Stepper3&, Stepper4&, 
           iodrv::Endstop&, iodrv::Endstop&, iodrv::Endstop&> getDependentIoDrivers() {
             return std::tie(
@@ -125,6 +130,9 @@ template <typename Stepper1, typename Stepper2, typename Stepper3, typename Step
         inline Vector4f bound(const Vector4f &xyze) const {
             return xyze; //no bounding.
         }
+        inline KinematicLimits kinematicLimits() const {
+            return limits;
+        }
         inline Vector4f xyzeFromMechanical(const std::array<int, 4> &mech) const {
             return Vector4f(mech[CARTESIAN_AXIS_X]*_MM_STEPS_X, 
                                    mech[CARTESIAN_AXIS_Y]*_MM_STEPS_Y, 
@@ -0,0 +1,155 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+#include <cmath> //for std::fabs
+#include <vector>
+#include "lineardeltacoordmap.h"
+#include "accelerationprofile.h"
+#include "iodrivers/a4988.h"
+#include "catch.hpp"
+
+using namespace motion;
+using namespace iodrv;
+
+namespace {
+    struct TestDeltaGeometry {
+        static constexpr float r() { return 111.f; }
+        static constexpr float L() { return 221.f; }
+        static constexpr float h() { return 467.45f; }
+        static constexpr float buildrad() { return 85.f; }
+        static constexpr float stepsPerMm() { return 6.265f*8; }
+        static constexpr float stepsPerMmExt() { return 30.f*16; }
+    };
+    typedef LinearDeltaCoordMap<A4988, A4988, A4988, A4988> RuntimeDeltaMap;
+    typedef LinearDeltaCoordMap<A4988, A4988, A4988, A4988, Matrix3x3, ConstexprLinearDeltaGeometry<TestDeltaGeometry> > ConstexprDeltaMap;
+
+    template <typename CoordMapT, typename ...GeometryArgs> CoordMapT makeDeltaMap(GeometryArgs ...geometry) {
+        return CoordMapT(geometry..., 10.f,
+            A4988(IoPin::null(), IoPin::null(), IoPin::null()), A4988(IoPin::null(), IoPin::null(), IoPin::null()),
+            A4988(IoPin::null(), IoPin::null(), IoPin::null()), A4988(IoPin::null(), IoPin::null(), IoPin::null()),
+            Endstop(), Endstop(), Endstop(), Matrix3x3::identity());
+    }
+
+    //MotionPlanner interface for a delta with the given limits and no acceleration, so that moves run at a constant velocity
+    struct LimitedDeltaInterface {
+        typedef ConstexprDeltaMap CoordMapT;
+        typedef NoAcceleration AccelerationProfileT;
+        KinematicLimits limits;
+        CoordMapT getCoordMap() const {
+            return CoordMapT(ConstexprLinearDeltaGeometry<TestDeltaGeometry>(), 10.f,
+                A4988(IoPin::null(), IoPin::null(), IoPin::null()), A4988(IoPin::null(), IoPin::null(), IoPin::null()),
+                A4988(IoPin::null(), IoPin::null(), IoPin::null()), A4988(IoPin::null(), IoPin::null(), IoPin::null()),
+                Endstop(), Endstop(), Endstop(), Matrix3x3::identity(), limits);
+        }
+        AccelerationProfileT getAccelerationProfile() const {
+            return AccelerationProfileT();
+        }
+    };
+
+    //move to @dest at (up to) @vel mm/sec, and @return the time of the last step, in seconds since the move began
+    float timedMove(MotionPlanner<LimitedDeltaInterface> &planner, const Vector4f &dest, float vel) {
+        EventClockT::time_point start;
+        planner.moveTo(start, dest, vel, -1000, 1000);
+        EventClockT::time_point last = start;
+        while (!planner.peekNextEvent().isNull()) {
+            last = planner.peekNextEvent().time();
+            planner.consumeNextEvent();
+        }
+        return std::chrono::duration_cast<std::chrono::duration<float> >(last - start).count();
+    }
+
+    //@return the times of the first @numSteps steps of the A tower, for a line (if @isArc=false) or an arc through the same start point
+    template <typename CoordMapT> std::vector<float> stepTimes(const CoordMapT &map, const std::array<int, 4> &start, bool isArc, int numSteps) {
+        auto steppers = map.getAxisSteppers();
+        auto &stepper = std::get<0>(steppers);
+        Vector4f startXyze = map.xyzeFromMechanical(start);
+        if (isArc) {
+            Vector3f startXyz = startXyze.xyz();
+            Vector3f center(0, 0, startXyz.z());
+            stepper.beginArc(map, start, startXyze, center, (startXyz-center).norm(), Vector3f(0, 0, 1).cross(startXyz-center).norm(), 
+                (startXyz-center).mag(), 1.f, 0.f);
+        } else {
+            stepper.beginLine(map, start, startXyze, Vector4f(30, -20, 10, 0));
+        }
+        std::vector<float> times;
+        for (int i=0; i<numSteps; ++i) {
+            stepper._nextStep(false);
+            times.push_back(stepper.time);
+        }
+        return times;
+    }
+}
+
+TEST_CASE("LinearDeltaCoordMap with constexpr geometry matches the runtime-configured one", "[lineardeltacoordmap]") {
+    RuntimeDeltaMap runtimeMap = makeDeltaMap<RuntimeDeltaMap>(LinearDeltaGeometry(TestDeltaGeometry::r(), TestDeltaGeometry::L(), 
+        TestDeltaGeometry::h(), TestDeltaGeometry::buildrad(), TestDeltaGeometry::stepsPerMm(), TestDeltaGeometry::stepsPerMmExt()));
+    ConstexprDeltaMap constexprMap = makeDeltaMap<ConstexprDeltaMap>(ConstexprLinearDeltaGeometry<TestDeltaGeometry>());
+    //a position a little below the endstops, with the effector off-center
+    std::array<int, 4> start = {{ 20000, 20500, 19800, 100 }};
+    SECTION("Forward kinematics agree") {
+        Vector4f a = runtimeMap.xyzeFromMechanical(start), b = constexprMap.xyzeFromMechanical(start);
+        REQUIRE(a.x() == Approx(b.x()));
+        REQUIRE(a.y() == Approx(b.y()));
+        REQUIRE(a.z() == Approx(b.z()));
+        REQUIRE(a.e() == Approx(b.e()));
+        REQUIRE(runtimeMap.getHomePosition(start) == constexprMap.getHomePosition(start));
+    }
+    SECTION("Step times agree") {
+        for (bool isArc : {false, true}) {
+            std::vector<float> a = stepTimes(runtimeMap, start, isArc, 200), b = stepTimes(constexprMap, start, isArc, 200);
+            REQUIRE(std::isfinite(a.back()));
+            for (std::size_t i=0; i<a.size(); ++i) {
+                REQUIRE(a[i] == Approx(b[i]));
+            }
+        }
+    }
+}
+
+TEST_CASE("LinearDeltaCoordMap slows moves to its per-axis limits", "[lineardeltacoordmap][motionplanner]") {
+    SECTION("Tower step rate limits become effector velocity limits") {
+        LimitedDeltaInterface interface;
+        interface.limits.maxStepRate = Vector4f(10000, 10000, 10000, 4800);
+        KinematicLimits limits = interface.getCoordMap().kinematicLimits();
+        //a carriage moves 1:1 with z, and at most d/sqrt(L^2-d^2) mm per mm of horizontal effector motion
+        float d = TestDeltaGeometry::r() + TestDeltaGeometry::buildrad();
+        float xyRatio = d / std::sqrt(TestDeltaGeometry::L()*TestDeltaGeometry::L() - d*d);
+        REQUIRE(limits.maxVelocity.x() == Approx(10000 / TestDeltaGeometry::stepsPerMm() / xyRatio));
+        REQUIRE(limits.maxVelocity.y() == Approx(10000 / TestDeltaGeometry::stepsPerMm() / xyRatio));
+        REQUIRE(limits.maxVelocity.z() == Approx(10000 / TestDeltaGeometry::stepsPerMm()));
+        REQUIRE(limits.maxVelocity.e() == Approx(10.f));
+    }
+    SECTION("A move exceeding one axis' velocity limit runs at exactly that limit, and other moves are unaffected") {
+        LimitedDeltaInterface interface;
+        interface.limits.maxVelocity = Vector4f(INFINITY, INFINITY, 20, INFINITY);
+        MotionPlanner<LimitedDeltaInterface> planner(interface);
+        planner.resetAxisPositions(planner.coordMap().getHomePosition(std::array<int, 4>({{0, 0, 0, 0}})));
+        Vector4f top = planner.actualCartesianPosition();
+        //straight down by 30mm, requested at 100 mm/s: z is limited to 20 mm/s
+        REQUIRE(std::fabs(timedMove(planner, top - Vector4f(0, 0, 30, 0), 100) - 1.5) < 0.005);
+        //30mm down and 30mm sideways: the path is slowed such that z still moves at exactly 20 mm/s
+        REQUIRE(std::fabs(timedMove(planner, top - Vector4f(-30, 0, 60, 0), 100) - 1.5) < 0.005);
+        //30mm sideways: no z motion, so the requested velocity is kept
+        REQUIRE(std::fabs(timedMove(planner, top - Vector4f(0, 0, 60, 0), 100) - 0.3) < 0.005);
+    }
+}
@@ -24,7 +24,9 @@
 #ifndef MOTION_LINEARDELTACOORDMAP_H
 #define MOTION_LINEARDELTACOORDMAP_H
 
+#include <algorithm> //for std::min
 #include <array>
+#include <cmath> //for std::sqrt
 #include <tuple>
 #include <utility> //for std::move
 #include <tuple>
@@ -49,49 +51,70 @@ namespace motion {
  * Additionally, the carriages host a free-spinning joint with an arm of length L linked to an end effector,
  * and the carriages are r units apart.
  *
- * R1000 is 'r' (in mm) multiplied by 1000,
- * L1000 is 'L' (in mm) multiplied by 1000
+ * The dimensions come from GeometryT: either a LinearDeltaGeometry configured at runtime,
+ *   or a ConstexprLinearDeltaGeometry, which lets the kinematics be specialized for one machine at compile time.
+ *
+ * The optional KinematicLimits apply to the cartesian axes, except for the step rate limits of the towers (x, y, z), which 
+ *   apply to the carriage motors. Those are converted into velocity limits for the worst case over the build area:
+ *   a carriage moves 1:1 with z, but a carriage at horizontal distance d from the effector moves d/sqrt(L^2-d^2) mm 
+ *   per mm of horizontal effector motion, and d is at most r+buildrad.
  *
  * The math is described more in /code/proof-of-concept/coordmath.py and coord-math.nb (note: file has been deleted; must view an archived version of printipi on Github to view this documentation)
  */
-template <typename Stepper1, typename Stepper2, typename Stepper3, typename Stepper4, typename BedLevelT=Matrix3x3> class LinearDeltaCoordMap : public CoordMap {
+template <typename Stepper1, typename Stepper2, typename Stepper3, typename Stepper4, typename BedLevelT=Matrix3x3, typename GeometryT=LinearDeltaGeometry> class LinearDeltaCoordMap : public CoordMap {
     typedef std::tuple<Stepper1, Stepper2, Stepper3, Stepper4> StepperDriverTypes;
-    typedef std::tuple<LinearDeltaStepper<Stepper1>, 
-                       LinearDeltaStepper<Stepper2>, 
-                       LinearDeltaStepper<Stepper3>, 
+    typedef std::tuple<LinearDeltaStepper<Stepper1, GeometryT>, 
+                       LinearDeltaStepper<Stepper2, GeometryT>, 
+                       LinearDeltaStepper<Stepper3, GeometryT>, 
                        LinearStepper<Stepper4> > _AxisStepperTypes;
 
     static constexpr float MIN_Z() { return -2; } //useful to be able to go a little under z=0 when tuning.
-    float _r, _L, _h, _buildrad;
-    float _STEPS_MM, _MM_STEPS;
-    float _STEPS_MM_EXT, _MM_STEPS_EXT;
+    GeometryT _geometry;
     float homeVelocity;
     BedLevelT bedLevel;
+    KinematicLimits limits;
 
     std::array<iodrv::Endstop, 4> endstops; //A, B, C and E (E is null)
     StepperDriverTypes stepperDrivers;    
     private:
-        inline float STEPS_MM() const { return _STEPS_MM; }
-        inline float MM_STEPS() const { return _MM_STEPS; }
-        inline float STEPS_MM_EXT() const { return _STEPS_MM_EXT; }
-        inline float MM_STEPS_EXT() const { return _MM_STEPS_EXT; }
+        inline float STEPS_MM() const { return _geometry.STEPS_MM(); }
+        inline float MM_STEPS() const { return _geometry.MM_STEPS(); }
+        inline float STEPS_MM_EXT() const { return _geometry.STEPS_MM_EXT(); }
+        inline float MM_STEPS_EXT() const { return _geometry.MM_STEPS_EXT(); }
     public:
-        inline float r() const { return _r; }
-        inline float L() const { return _L; }
-        inline float h() const { return _h; }
-        inline float buildrad() const { return _buildrad; }
+        inline const GeometryT& geometry() const { return _geometry; }
+        inline float r() const { return _geometry.r(); }
+        inline float L() const { return _geometry.L(); }
+        inline float h() const { return _geometry.h(); }
+        inline float buildrad() const { return _geometry.buildrad(); }
         inline float STEPS_MM(std::size_t axisIdx) const { return axisIdx == DELTA_AXIS_E ? STEPS_MM_EXT() : STEPS_MM(); }
         inline float MM_STEPS(std::size_t axisIdx) const { return axisIdx == DELTA_AXIS_E ? MM_STEPS_EXT() : MM_STEPS(); }
+        //construct with a runtime-configured geometry
         inline LinearDeltaCoordMap(float r, float L, float h, float buildrad, float STEPS_MM, float STEPS_MM_EXT, float homeVelocity,
             Stepper1 &&stepper1, Stepper2 &&stepper2, Stepper3 &&stepper3, Stepper4 &&stepper4,
-            iodrv::Endstop &&endstopA, iodrv::Endstop &&endstopB, iodrv::Endstop &&endstopC, const BedLevelT &t)
-         : _r(r), _L(L), _h(h), _buildrad(buildrad),
-           _STEPS_MM(STEPS_MM), _MM_STEPS(1. / STEPS_MM),
-           _STEPS_MM_EXT(STEPS_MM_EXT), _MM_STEPS_EXT(1./ STEPS_MM_EXT),
+            iodrv::Endstop &&endstopA, iodrv::Endstop &&endstopB, iodrv::Endstop &&endstopC, const BedLevelT &t,
+            const KinematicLimits &limits=KinematicLimits())
+         : LinearDeltaCoordMap(GeometryT(r, L, h, buildrad, STEPS_MM, STEPS_MM_EXT), homeVelocity,
+             std::move(stepper1), std::move(stepper2), std::move(stepper3), std::move(stepper4),
+             std::move(endstopA), std::move(endstopB), std::move(endstopC), t, limits) {}
+        inline LinearDeltaCoordMap(const GeometryT &geometry, float homeVelocity,
+            Stepper1 &&stepper1, Stepper2 &&stepper2, Stepper3 &&stepper3, Stepper4 &&stepper4,
+            iodrv::Endstop &&endstopA, iodrv::Endstop &&endstopB, iodrv::Endstop &&endstopC, const BedLevelT &t,
+            const KinematicLimits &limits=KinematicLimits())
+         : _geometry(geometry),
            homeVelocity(homeVelocity),
            bedLevel(t),
+           limits(limits),
            endstops({{std::move(endstopA), std::move(endstopB), std::move(endstopC), std::move(iodrv::Endstop())}}),
-           stepperDrivers(std::move(stepper1), std::move(stepper2), std::move(stepper3), std::move(stepper4)) {}
+           stepperDrivers(std::move(stepper1), std::move(stepper2), std::move(stepper3), std::move(stepper4)) {
+            float d = r() + buildrad();
+            float stepsMmXy = STEPS_MM() * d / std::sqrt(L()*L() - d*d);
+            //the towers share one step rate limit: the tightest of the three
+            float towerRate = std::min(limits.maxStepRate.x(), std::min(limits.maxStepRate.y(), limits.maxStepRate.z()));
+            this->limits.maxVelocity = KinematicLimits(limits.maxVelocity, limits.maxAcceleration, 
+                Vector4f(towerRate, towerRate, towerRate, limits.maxStepRate.e()))
+              .effectiveMaxVelocity(Vector4f(stepsMmXy, stepsMmXy, STEPS_MM(), STEPS_MM_EXT()));
+        }
         inline std::tuple<Stepper1&, Stepper2&, Stepper3&, Stepper4&, 
           iodrv::Endstop&, iodrv::Endstop&, iodrv::Endstop&> getDependentIoDrivers() {
             return std::tie(
@@ -105,10 +128,10 @@ template <typename Stepper1, typename Stepper2, typename Stepper3, typename Step
         }
         inline _AxisStepperTypes getAxisSteppers() const {
             return std::make_tuple(
-                       LinearDeltaStepper<Stepper1>(0, DELTA_AXIS_A,     *this, std::get<0>(stepperDrivers), &endstops[0]), 
-                       LinearDeltaStepper<Stepper2>(1, DELTA_AXIS_B,     *this, std::get<1>(stepperDrivers), &endstops[1]), 
-                       LinearDeltaStepper<Stepper3>(2, DELTA_AXIS_C,     *this, std::get<2>(stepperDrivers), &endstops[2]), 
-                       LinearStepper<Stepper4>     (3, CARTESIAN_AXIS_E, *this, std::get<3>(stepperDrivers), &endstops[3])
+                       LinearDeltaStepper<Stepper1, GeometryT>(0, DELTA_AXIS_A,     *this, std::get<0>(stepperDrivers), &endstops[0]), 
+                       LinearDeltaStepper<Stepper2, GeometryT>(1, DELTA_AXIS_B,     *this, std::get<1>(stepperDrivers), &endstops[1]), 
+                       LinearDeltaStepper<Stepper3, GeometryT>(2, DELTA_AXIS_C,     *this, std::get<2>(stepperDrivers), &endstops[2]), 
+                       LinearStepper<Stepper4>                (3, CARTESIAN_AXIS_E, *this, std::get<3>(stepperDrivers), &endstops[3])
             );
         }
 
@@ -148,6 +171,9 @@ template <typename Stepper1, typename Stepper2, typename Stepper3, typename Step
             //TODO: force x & y to be on the platform.
             return Vector4f(x, y, z, xyze.e());
         }
+        inline KinematicLimits kinematicLimits() const {
+            return limits;
+        }
         inline Vector4f xyzeFromMechanical(const std::array<int, 4> &mech) const {
             float e = mech[DELTA_AXIS_E]*MM_STEPS_EXT();
             float x, y, z;
@@ -0,0 +1,83 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MOTION_LINEARDELTAGEOMETRY_H
+#define MOTION_LINEARDELTAGEOMETRY_H
+
+namespace motion {
+
+/* 
+ * A LinearDeltaGeometry holds the dimensions of a (rail-based) delta, as used by LinearDeltaCoordMap and LinearDeltaStepper:
+ *   r: distance from the center of the build plate to each tower, in mm
+ *   L: length of the rods that connect the carriages to the end effector, in mm
+ *   h: vertical distance from the endstops to the build plate, in mm
+ *   buildrad: radius of the print bed, in mm
+ *   STEPS_MM, STEPS_MM_EXT: steps per mm of carriage movement & of filament.
+ *
+ * This one is configured at runtime. See ConstexprLinearDeltaGeometry for dimensions fixed at compile time.
+ */
+class LinearDeltaGeometry {
+    float _r, _L, _h, _buildrad;
+    float _STEPS_MM, _MM_STEPS;
+    float _STEPS_MM_EXT, _MM_STEPS_EXT;
+    public:
+        inline LinearDeltaGeometry(float r, float L, float h, float buildrad, float STEPS_MM, float STEPS_MM_EXT)
+         : _r(r), _L(L), _h(h), _buildrad(buildrad),
+           _STEPS_MM(STEPS_MM), _MM_STEPS(1. / STEPS_MM),
+           _STEPS_MM_EXT(STEPS_MM_EXT), _MM_STEPS_EXT(1. / STEPS_MM_EXT) {}
+        inline float r() const { return _r; }
+        inline float L() const { return _L; }
+        inline float h() const { return _h; }
+        inline float buildrad() const { return _buildrad; }
+        inline float STEPS_MM() const { return _STEPS_MM; }
+        inline float MM_STEPS() const { return _MM_STEPS; }
+        inline float STEPS_MM_EXT() const { return _STEPS_MM_EXT; }
+        inline float MM_STEPS_EXT() const { return _MM_STEPS_EXT; }
+};
+
+/* 
+ * Delta dimensions that are known at compile time.
+ * Using this in place of LinearDeltaGeometry lets the compiler fold expressions like L*L - r*r into constants 
+ *   and turn divisions by STEPS_MM into multiplications, which matters in LinearDeltaStepper::testDir (run twice per step).
+ *
+ * Config must provide static constexpr float functions r(), L(), h(), buildrad(), stepsPerMm() and stepsPerMmExt(), e.g.
+ *   struct MyDelta {
+ *       static constexpr float r() { return 111.0; }
+ *       ...
+ *   };
+ *   LinearDeltaCoordMap<..., ConstexprLinearDeltaGeometry<MyDelta> >(ConstexprLinearDeltaGeometry<MyDelta>(), ...)
+ */
+template <typename Config> struct ConstexprLinearDeltaGeometry {
+    static constexpr float r() { return Config::r(); }
+    static constexpr float L() { return Config::L(); }
+    static constexpr float h() { return Config::h(); }
+    static constexpr float buildrad() { return Config::buildrad(); }
+    static constexpr float STEPS_MM() { return Config::stepsPerMm(); }
+    static constexpr float MM_STEPS() { return 1. / Config::stepsPerMm(); }
+    static constexpr float STEPS_MM_EXT() { return Config::stepsPerMmExt(); }
+    static constexpr float MM_STEPS_EXT() { return 1. / Config::stepsPerMmExt(); }
+};
+
+}
+
+#endif
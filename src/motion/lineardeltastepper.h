@@ -101,6 +101,7 @@
 
 #include "axisstepper.h"
 #include "linearstepper.h" //for LinearHomeStepper
+#include "lineardeltageometry.h"
 #include "iodrivers/endstop.h"
 #include "common/logging.h"
 
@@ -116,12 +117,14 @@ enum DeltaAxis {
 /* 
  * LinearDeltaStepper implements the AxisStepper interface for (rail-based) Delta-style robots like the Kossel, 
  *   for linear (G0/G1) and arc movements (G2/G3)
+ * GeometryT is the same as the CoordMap's; if its dimensions are constexpr, testDir is specialized for them.
  */
-template <typename StepperDriverT> class LinearDeltaStepper : public AxisStepperWithDriver<StepperDriverT> {
+template <typename StepperDriverT, typename GeometryT=LinearDeltaGeometry> class LinearDeltaStepper : public AxisStepperWithDriver<StepperDriverT> {
     DeltaAxis axisIdx;
     const iodrv::Endstop *endstop; //must be pointer, because cannot move a reference
-    float _r, _L, _MM_STEPS; //calibration settings which will be obtained from the CoordMap
+    GeometryT _geometry; //calibration settings which will be obtained from the CoordMap
     float w; //angle of this axis, in radians
+    Vector3f towerXy; //<r*sin(w), r*cos(w), 0>: the position of this axis' tower, computed once rather than on every testDir
     float M0; //initial coordinate of THIS axis. CW from +y axis
     int sTotal; //current step offset from M0
     
@@ -135,37 +138,36 @@ template <typename StepperDriverT> class LinearDeltaStepper : public AxisStepper
     float arcRad; //radius of arc
     float arc_m; //angular velocity of the arc.
     bool isArcMotion;
-    inline float r() const { return _r; }
-    inline float L() const { return _L; }
-    inline float MM_STEPS() const { return _MM_STEPS; }
+    inline float r() const { return _geometry.r(); }
+    inline float L() const { return _geometry.L(); }
+    inline float MM_STEPS() const { return _geometry.MM_STEPS(); }
     public:
         template <typename CoordMapT> LinearDeltaStepper(int idx, DeltaAxis axisIdx, const CoordMapT &map, const StepperDriverT &stepper, const iodrv::Endstop *endstop)
          : AxisStepperWithDriver<StepperDriverT>(idx, stepper),
            axisIdx(axisIdx),
            endstop(endstop),
-           _r(map.r()), 
-           _L(map.L()),
-           _MM_STEPS(map.MM_STEPS(axisIdx)),
-           w(axisIdx*2*M_PI/3) {
+           _geometry(map.geometry()),
+           w(axisIdx*2*M_PI/3),
+           towerXy(r()*sin(w), r()*cos(w), 0) {
               //E axis has to be controlled using a LinearStepper (as if it were cartesian)
               assert(axisIdx == DELTA_AXIS_A || axisIdx == DELTA_AXIS_B || axisIdx == DELTA_AXIS_C);
         }
 
         //function to initiate a linear (through cartesian space) motion
         template <typename CoordMapT, std::size_t sz> void beginLine(const CoordMapT &map, const std::array<int, sz>& curPos, 
-        const Vector4f &vel) {
+        const Vector4f &curXyze, const Vector4f &vel) {
             this->M0 = map.getAxisPosition(curPos, axisIdx)*map.MM_STEPS(axisIdx); 
             this->sTotal = 0;
-            this->line_P0 = map.xyzeFromMechanical(curPos).xyz();
+            this->line_P0 = curXyze.xyz();
             this->line_v = vel.xyz();
             this->isArcMotion = false;
-            this->time = 0;
+            this->time = this->earliestStepTime(line_v.mag());
         }
         //function to initiate a circular arc (through cartesian space) motion
         template <typename CoordMapT, std::size_t sz> void beginArc(const CoordMapT &map, const std::array<int, sz> &curPos, 
-        const Vector3f &center, const Vector3f &u, const Vector3f &v,  
+        const Vector4f &curXyze, const Vector3f &center, const Vector3f &u, const Vector3f &v,  
         float arcRad, float arcVel, float extVel) {
-            (void)map, (void)extVel; //unused
+            (void)map, (void)curXyze, (void)extVel; //unused
             this->M0 = map.getAxisPosition(curPos, axisIdx)*map.MM_STEPS(axisIdx);
             this->sTotal = 0;
             this->arc_Pc = center;
@@ -174,7 +176,7 @@ template <typename StepperDriverT> class LinearDeltaStepper : public AxisStepper
             this->arcRad = arcRad;
             this->arc_m = arcVel;
             this->isArcMotion = true;
-            this->time = 0;
+            this->time = this->earliestStepTime(std::fabs(arcRad*arcVel));
         }
     //protected:
         inline float testDir(float s) {
@@ -216,13 +218,13 @@ template <typename StepperDriverT> class LinearDeltaStepper : public AxisStepper
 
                 float D = M0+s;
                 //        r^2      +s^2          +xc^2 +yc^2 +(D-zc)^2     -2 r   (yc Cos[w]+xc Sin[w]) - L^2
-                float p = r()*r()  +arcRad*arcRad+Pc.x()*Pc.x()+Pc.y()*Pc.y()+(D-Pc.z())*(D-Pc.z())-2*r()*(Pc.y()*cos(w)+Pc.x()*sin(w)) - L()*L();
+                float p = r()*r()  +arcRad*arcRad+Pc.x()*Pc.x()+Pc.y()*Pc.y()+(D-Pc.z())*(D-Pc.z())-2*Pc.dot(towerXy) - L()*L();
                 //        2 s      (-D uz+ux xc+uy yc+uz zc-r   (uy Cos[w]+ux Sin[w]))
                 //float n = 2*arcRad*(-D*uz+ux*xc+uy*yc+uz*zc-r()*(uy*cos(w)+ux*sin(w)));
-                float n = 2*arcRad*(-D*u.z()+u.dot(Pc) - r()*(u.y()*cos(w)+u.x()*sin(w)));
+                float n = 2*arcRad*(-D*u.z()+u.dot(Pc) - u.dot(towerXy));
                 //        2 s      (-D vz+vx xc+vy yc+vz zc-r   (vy Cos[w]+vx Sin[w]))
                 //float m = 2*arcRad*(-D*vz+vx*xc+vy*yc+vz*zc-r()*(vy*cos(w)+vx*sin(w)));
-                float m = 2*arcRad*(-D*v.z()+v.dot(Pc) - r()*(v.y()*cos(w)+v.x()*sin(w)));
+                float m = 2*arcRad*(-D*v.z()+v.dot(Pc) - v.dot(towerXy));
 
                 float mt_1 = atan2((-m*p + n*sqrt(m*m+n*n-p*p))/(m*m + n*n), (-n*p - m*sqrt(m*m+n*n-p*p))/(m*m+n*n));
                 float mt_2 = atan2((-m*p - n*sqrt(m*m+n*n-p*p))/(m*m + n*n), (-n*p + m*sqrt(m*m+n*n-p*p))/(m*m+n*n));
@@ -259,7 +261,7 @@ template <typename StepperDriverT> class LinearDeltaStepper : public AxisStepper
                  *    then continues past the tower, so that the carriage movement is (pseudo) parabolic.
                  */
                 float D = M0 + s;
-                Vector3f carriagePos(r()*sin(w), r()*cos(w), D);
+                Vector3f carriagePos(towerXy.x(), towerXy.y(), D);
                 //obtain coefficients for t = a*x^2 + b*x + c
                 float a = line_v.magSq();
                 float b = 2*line_v.dot(line_P0 - carriagePos);
@@ -330,6 +332,9 @@ template <typename StepperDriverT> class LinearDeltaStepper : public AxisStepper
                         ++this->sTotal;
                     }
                 }
+                if (this->time < 0) {
+                    this->time = 0; //a step that came due just before the move began is taken at its start
+                }
             }
         }
 };
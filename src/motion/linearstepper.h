@@ -30,6 +30,7 @@
 #include "common/logging.h"
 #include <tuple>
 #include <cmath> //for fabs
+#include <algorithm> //for std::max
 #include <cassert>
 
 namespace motion {
@@ -68,25 +69,33 @@ template <typename StepperDriverT> class LinearStepper : public AxisStepperWithD
         }
         //Linear movement constructor
         template <typename CoordMapT, std::size_t sz> void beginLine(const CoordMapT &map, const std::array<int, sz>& curPos, 
-          const Vector4f &vel) {
-            (void)curPos; //unused
+          const Vector4f &curXyze, const Vector4f &vel) {
             //timePerStep is in units of sec/step. v is mm/sec, STEPS_MM is steps/mm.
             //therefore v*STEPS_MM = steps/sec, so 1. / (v*STEPS_MM) is steps/sec
             float myVel = vel.array()[coordType];
             float signedTimePerStep = 1. / (myVel * map.STEPS_MM(coordType));
             line_timePerStep = std::fabs(signedTimePerStep);
-            this->time = 0;
             this->direction = stepDirFromSign(signedTimePerStep);
             this->isArcMotion = false;
+            if (myVel == 0) {
+                this->time = 0;
+            } else {
+                //@curXyze may be part of the way to the next step, so the first step is due once the axis reaches that step's absolute position
+                //  (which may be right away, if rounding put @curXyze just past it), rather than a full step in.
+                int firstStep = map.getAxisPosition(curPos, coordType) + stepDirToSigned<int>(this->direction);
+                float firstStepTime = (firstStep*MM_STEPS() - curXyze.array()[coordType]) / myVel;
+                //_nextStep() advances by one step
+                this->time = std::max(firstStepTime, 0.f) - line_timePerStep;
+            }
         }
         //Arc movement constructor
         template <typename CoordMapT, std::size_t sz> void beginArc(const CoordMapT &map, const std::array<int, sz> &curPos, 
-          const Vector3f &center, const Vector3f &u, const Vector3f &v,  
+          const Vector4f &curXyze, const Vector3f &center, const Vector3f &u, const Vector3f &v,  
           float arcRad, float arcVel, float extVel) {
             (void)map; (void)curPos; (void)center; (void)u; (void)v; (void)arcRad; (void)arcVel; //unused
             if (coordType == CARTESIAN_AXIS_E) {
                 // extruder movement for cartesian arcs is still linear.
-                beginLine(map, curPos, Vector4f(0.f, 0.f, 0.f, extVel));
+                beginLine(map, curPos, curXyze, Vector4f(0.f, 0.f, 0.f, extVel));
                 //timePerStep = std::fabs(1./ (extVel * map.STEPS_MM(coordType)));
                 //this->time = 0;
                 //this->direction = stepDirFromSign(extVel);
@@ -109,7 +118,7 @@ template <typename StepperDriverT> class LinearStepper : public AxisStepperWithD
                 this->arc_center = center.array()[coordType];
                 this->arc_m = arcVel;
                 this->arc_sTotal = map.getAxisPosition(curPos, coordType);
-                this->time = 0;
+                this->time = this->earliestStepTime(std::fabs(arcRad*arcVel));
             }
         }
         inline float arcTestDir(float s) {
@@ -168,6 +177,9 @@ template <typename StepperDriverT> class LinearStepper : public AxisStepperWithD
                             ++this->arc_sTotal;
                         }
                     }
+                    if (this->time < 0) {
+                        this->time = 0; //a step that came due just before the move began is taken at its start
+                    }
                 } else {
                     this->time += line_timePerStep;
                 }
@@ -25,11 +25,24 @@
 #define MOTION_MOTIONPLANNER_H
 
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <cmath> //for std::fabs, INFINITY
+#include <condition_variable>
+#include <limits> //for std::numeric_limits
+#include <memory> //for std::unique_ptr
+#include <mutex>
 #include <stdexcept> //for runtime_error
+#include <thread>
 #include <utility> //for std::declval
+#include "compileflags.h" //for USE_PTHREAD
+#if USE_PTHREAD
+    #include <pthread.h> //for pthread_setschedparam
+#endif
+#include "schedulerbase.h" //for SchedulerBase::getSchedPriority
 #include "accelerationprofile.h"
 #include "axisstepper.h"
+#include "kinematiclimits.h"
 #include "common/vector3.h"
 #include "common/vector4.h"
 #include "common/logging.h"
@@ -83,6 +96,12 @@ template <typename AxisStepperTypes> struct MaxOutputEventSequenceSize<AxisStepp
 /* 
  * MotionPlanner takes commands from the State (mainly those caused by G1 and G28) and resolves the move into a path via interfacing with a CoordMap, AxisSteppers, and an AccelerationProfile.
  * Once a path is planned, State can call MotionPlanner.nextStep() and be given data in the form of an Event, which can be passed on to a Scheduler.
+ *
+ * Each axis' steps depend only upon its own AxisStepper, so with setParallelStepGeneration(true), every axis generates its steps
+ *   on its own worker thread, a batch of steps ahead of the consumer. The steps are then merged in time order exactly as in the serial case.
+ *   The consumer is the real-time event loop, so it doesn't wait for a worker that hasn't begun the next batch;
+ *   it generates that axis' next step itself instead. A worker that's already filling a batch hands over after its current step,
+ *   and runs at the event loop's priority, so that it can't be preempted by anything the event loop isn't.
  * 
  * @Interface must have 2 public typedefs: CoordMapT and AccelerationProfileT. These are often provided by the machine driver.
  */
@@ -90,18 +109,83 @@ template <typename Interface> class MotionPlanner {
     private:
         struct UpdateOutputEvents {
             template <std::size_t MyIdx, typename T> void operator()(std::integral_constant<std::size_t, MyIdx> myIdx, T &stepper, 
-              MotionPlanner<Interface> *_this, EventClockT::time_point baseTime) {
+              MotionPlanner<Interface> *_this, EventClockT::time_point time, StepDirection dir) {
                 (void)myIdx; //unused
-                auto sequence = stepper.getStepOutputEventSequence(baseTime);
+                auto sequence = stepper.getStepOutputEventSequence(time, dir);
                 std::copy(sequence.begin(), sequence.end(), _this->outputEventBuffer.begin());
                 _this->curOutputEvent = _this->outputEventBuffer.begin();
                 _this->endOutputEvent = _this->outputEventBuffer.begin() + sequence.size();
             }
         };
+        //A step that has been pulled from an AxisStepper (and transformed by the acceleration profile), but not yet output
+        struct PlannedStep {
+            EventClockT::time_point time;
+            StepDirection direction;
+        };
+        //Pull the next step from one AxisStepper into @stepPtr and advance the AxisStepper past it.
+        //  @hasStepPtr is set to false if the axis has no more steps in this move.
+        struct PlanNextStep {
+            template <std::size_t MyIdx, typename T> void operator()(std::integral_constant<std::size_t, MyIdx> myIdx, T &stepper, 
+              MotionPlanner<Interface> *_this, PlannedStep *stepPtr, bool *hasStepPtr) {
+                (void)myIdx; //unused
+                *hasStepPtr = _this->isStepTimeValid(stepper.time);
+                if (*hasStepPtr) {
+                    float transformedTime = _this->_accel.transform(stepper.time); //transform the step time according to acceleration profile
+                    EventClockT::duration transformedChronoTime = std::chrono::duration_cast<EventClockT::duration>(std::chrono::duration<float>(transformedTime));
+                    stepPtr->time = _this->_baseTime + transformedChronoTime;
+                    stepPtr->direction = stepper.direction;
+                    stepper.nextStep(_this->_iters, _this->_useEndstops);
+                }
+            }
+        };
         typedef typename Interface::CoordMapT CoordMapT;
         typedef typename Interface::AccelerationProfileT AccelerationProfileT;
         typedef decltype(std::declval<CoordMapT>().getAxisSteppers()) AxisStepperTypes;
+        typedef std::array<PlannedStep, std::tuple_size<AxisStepperTypes>::value> PlannedStepsT;
+        typedef std::array<EventClockT::rep, std::tuple_size<AxisStepperTypes>::value> StepTimesT;
         typedef std::array<OutputEvent, MaxOutputEventSequenceSize<AxisStepperTypes, std::tuple_size<AxisStepperTypes>::value>::maxSize()> OutputEventBufferT;
+        //Steps generated ahead of time for one axis by its worker thread (see setParallelStepGeneration)
+        struct StepBatch {
+            std::array<PlannedStep, 256> steps;
+            std::size_t numSteps;
+            //true if the axis has no more steps in this move beyond these
+            bool isLast;
+        };
+        //Double-buffered: the event loop takes steps from the front batch while the worker fills the other one.
+        //The mutex is only ever held to update the flags, never while generating steps.
+        struct AxisWorker {
+            std::array<StepBatch, 2> batches;
+            std::size_t frontBatch;
+            std::size_t frontStep;
+            std::mutex mutex;
+            std::condition_variable cond;
+            //the back batch has been requested, but the worker hasn't begun it yet
+            bool isFillRequested;
+            //the worker is filling the back batch (and so owns the axis' AxisStepper)
+            bool isFilling;
+            bool isBackReady;
+            //set by the consumer to have the worker finish its batch after the current step
+            std::atomic<bool> isFillCancelled;
+            bool isStopping;
+            std::thread thread;
+            AxisWorker() : batches(), frontBatch(0), frontStep(0), isFillRequested(false), isFilling(false), isBackReady(false),
+                isFillCancelled(false), isStopping(false) {}
+        };
+        typedef std::array<AxisWorker, std::tuple_size<AxisStepperTypes>::value> AxisWorkersT;
+        //stops & joins the worker threads before freeing them
+        struct AxisWorkersDeleter {
+            void operator()(AxisWorkersT *workers) const {
+                for (AxisWorker &w : *workers) {
+                    {
+                        std::lock_guard<std::mutex> lock(w.mutex);
+                        w.isStopping = true;
+                    }
+                    w.cond.notify_all();
+                    w.thread.join();
+                }
+                delete workers;
+            }
+        };
 
         //Interface _interface;
         //object that maps from (x, y, z) to mechanical coords (eg A, B, C for a kossel)
@@ -110,8 +194,23 @@ template <typename Interface> class MotionPlanner {
         AccelerationProfileT _accel;
         //the mechanical position of the last step that was scheduled
         std::array<int, CoordMapT::numAxis()> _destMechanicalPos;
+        //The cartesian endpoint of the last planned move, which is where the next move starts.
+        //  Tracking this saves a forward kinematics computation (a trilateration for deltas) per move.
+        //  It's only trusted while _isDestCartesianPosValid; homing or an endstop-terminated move invalidates it.
+        //  The steps of a move may stop a fraction of a step short of it, but the steppers target absolute step positions,
+        //  so the next move makes up for that rather than the shortfall accumulating.
+        Vector4f _destCartesianPos;
+        bool _isDestCartesianPosValid;
         //Each axis iterator reports the next time it needs to be stepped. _iters is for linear or arc movement
         AxisStepperTypes _iters; 
+        //The next step of each axis, which has been pulled from _iters but not yet output
+        PlannedStepsT _nextSteps;
+        //The time of each axis' next step (in EventClockT ticks), or noStepTime() if the axis has no steps left in this move.
+        //  Kept in one contiguous array so that choosing the soonest step is a branch-free min over a few integers.
+        alignas(32) StepTimesT _nextStepTimes;
+        //_nextSteps[_staleStepIdx] has been output and must be replaced before choosing the next step.
+        //  noStaleStep() if none, or allStepsStale() at the start of a move.
+        std::size_t _staleStepIdx;
         //The time at which the current path segment began (this will be a fraction of a second before the time which the first step in this path is scheduled for)
         EventClockT::time_point _baseTime;
         //the estimated duration of the current piece, not taking into account acceleration
@@ -125,20 +224,49 @@ template <typename Interface> class MotionPlanner {
         //iterators used to allow requesting idividual sequential OutputEvents
         typename OutputEventBufferT::iterator curOutputEvent;
         typename OutputEventBufferT::iterator endOutputEvent;
+        //null unless parallel step generation is enabled
+        std::unique_ptr<AxisWorkersT, AxisWorkersDeleter> _axisWorkers;
+        //number of steps generated by the consumer because their worker hadn't begun them yet
+        std::size_t _numInlineSteps;
     public:
         MotionPlanner(const Interface &interface) : 
             //_interface(interface),
             _coordMapper(interface.getCoordMap()),
             _accel(interface.getAccelerationProfile()), 
             _destMechanicalPos(), 
+            _destCartesianPos(),
+            _isDestCartesianPosValid(false),
             _iters(_coordMapper.getAxisSteppers()),
+            _nextSteps(),
+            _nextStepTimes(),
+            _staleStepIdx(noStaleStep()),
             _baseTime(), 
             _duration(NAN),
             _isInMotion(false),
             _useEndstops(false),
             outputEventBuffer(),
             curOutputEvent(outputEventBuffer.begin()),
-            endOutputEvent(outputEventBuffer.begin()) {}
+            endOutputEvent(outputEventBuffer.begin()),
+            _numInlineSteps(0) {}
+        //Generate each axis' steps on its own thread (@enable=true), or on the calling thread (the default).
+        //This may only be changed between moves (readyForNextMove() == true),
+        //  and the MotionPlanner must not be moved while it's enabled, as the workers refer to it.
+        //Moves that check endstops are always generated on the calling thread, since endstops must be read just before each step.
+        void setParallelStepGeneration(bool enable) {
+            assert(readyForNextMove());
+            if (enable && !_axisWorkers) {
+                _axisWorkers.reset(new AxisWorkersT());
+                for (std::size_t idx=0; idx<_axisWorkers->size(); ++idx) {
+                    (*_axisWorkers)[idx].thread = std::thread(&MotionPlanner<Interface>::stepWorkerLoop, this, idx);
+                }
+            } else if (!enable) {
+                _axisWorkers.reset();
+            }
+        }
+        //with parallel step generation, the number of steps that the calling thread had to generate itself
+        std::size_t numInlineSteps() const {
+            return _numInlineSteps;
+        }
         const CoordMapT& coordMap() const {
             return _coordMapper;
         }
@@ -164,40 +292,227 @@ template <typename Interface> class MotionPlanner {
         }
         void resetAxisPositions(const std::array<int, CoordMapT::numAxis()> &pos) {
             _destMechanicalPos = pos;
+            _isDestCartesianPosValid = false;
         }
     private:
-        template <typename StepperTypes> void _nextStep(StepperTypes &steppers, AxisStepper &s) {
-            LOGV("MotionPlanner::nextStep() is: %i at %g of %g\n", s.index(), s.time, _duration);
-            if (s.time > _duration || s.time <= 0 || std::isnan(s.time)) { //if the next time the given axis wants to step is invalid or past the movement length, then end the motion
-                //Note: don't combine s.time <= 0 || isnan(s.time) to !(s.time > 0) because that might be broken during optimizations.
-                //Note: This conditional causes the MotionPlanner to always undershoot the desired position, when it may be desireable to overshoot some of them - see https://github.com/Wallacoloo/printipi/issues/15
-                //log debug info:
-                Vector4f pos = _coordMapper.xyzeFromMechanical(_destMechanicalPos);
-                LOGD("MotionPlanner::moveTo Got: %s\n", pos.str().c_str());
+        //In debug builds, the tracked cartesian endpoint is checked against the forward kinematics after each move,
+        //  and discarded if they disagree by more than this (in mm). Rounding each axis to a whole step accounts for far less.
+        static constexpr float maxCartesianPosError() {
+            return 0.1f;
+        }
+        //@return the cartesian position at which the next move will begin
+        Vector4f destCartesianPosition() {
+            if (!_isDestCartesianPosValid) {
+                _destCartesianPos = _coordMapper.xyzeFromMechanical(_destMechanicalPos);
+                _isDestCartesianPosValid = true;
+            }
+            return _destCartesianPos;
+        }
+        //record that the current move will end at @dest (unless an endstop stops it short)
+        void setDestCartesianPosition(const Vector4f &dest) {
+            _destCartesianPos = dest;
+            _isDestCartesianPosValid = !_useEndstops;
+        }
+        void checkDestCartesianPosition() {
+            #ifndef NDEBUG
+                if (_isDestCartesianPosValid) {
+                    Vector4f actual = _coordMapper.xyzeFromMechanical(_destMechanicalPos);
+                    if (!(actual.xyz().distance(_destCartesianPos.xyz()) <= maxCartesianPosError() 
+                      && std::fabs(actual.e() - _destCartesianPos.e()) <= maxCartesianPosError())) {
+                        LOGW("MotionPlanner: planned endpoint %s differs from actual %s\n", _destCartesianPos.str().c_str(), actual.str().c_str());
+                        _isDestCartesianPosValid = false;
+                    }
+                }
+            #endif
+        }
+        static constexpr EventClockT::rep noStepTime() {
+            return std::numeric_limits<EventClockT::rep>::max();
+        }
+        static constexpr std::size_t noStaleStep() {
+            return std::numeric_limits<std::size_t>::max();
+        }
+        static constexpr std::size_t allStepsStale() {
+            return std::tuple_size<AxisStepperTypes>::value;
+        }
+        //@return the index of the soonest time (the lowest such index on ties).
+        //The loop has a fixed length and only conditional moves, so it compiles to a handful of branch-free instructions.
+        static inline std::size_t soonestStepIndex(const StepTimesT &times) {
+            std::size_t soonest = 0;
+            EventClockT::rep soonestTime = times[0];
+            for (std::size_t idx=1; idx<times.size(); ++idx) {
+                bool isSooner = times[idx] < soonestTime;
+                soonest = isSooner ? idx : soonest;
+                soonestTime = isSooner ? times[idx] : soonestTime;
+            }
+            return soonest;
+        }
+        //pull the next step of axis @idx, and record when it is
+        void replaceNextStep(std::size_t idx) {
+            bool hasStep;
+            if (isStepGenerationParallel()) {
+                hasStep = takeStepFromWorker(idx);
+            } else {
+                tupleCallOnIndex(_iters, PlanNextStep(), idx, this, &_nextSteps[idx], &hasStep);
+            }
+            _nextStepTimes[idx] = hasStep ? _nextSteps[idx].time.time_since_epoch().count() : noStepTime();
+        }
+        inline bool isStepTimeValid(float time) const {
+            //if the next time the given axis wants to step is invalid or past the movement length, then the axis is done with this move.
+            //Note: don't combine time < 0 || isnan(time) to !(time >= 0) because that might be broken during optimizations.
+            //A step at exactly time 0 is one that came due just before the move began, and is taken at its start.
+            //Note: This causes the MotionPlanner to always undershoot the desired position, when it may be desireable to overshoot some of them - see https://github.com/Wallacoloo/printipi/issues/15
+            return !(time > _duration || time < 0 || std::isnan(time));
+        }
+        void _nextStep() {
+            //replace the step that was output last (or every axis' step, at the start of a move),
+            //  and then pick the axis whose next step is soonest (on ties, the lowest axis index wins)
+            if (_staleStepIdx == allStepsStale()) {
+                for (std::size_t idx=0; idx<_nextSteps.size(); ++idx) {
+                    replaceNextStep(idx);
+                }
+            } else if (_staleStepIdx != noStaleStep()) {
+                replaceNextStep(_staleStepIdx);
+            }
+            _staleStepIdx = noStaleStep();
+            std::size_t nextIdx = soonestStepIndex(_nextStepTimes);
+            if (_nextStepTimes[nextIdx] == noStepTime()) { //no axis has steps remaining; end the motion
+                //log debug info (the forward kinematics are only computed if debug logging is enabled):
+                LOGD("MotionPlanner::moveTo Got: %s\n", _coordMapper.xyzeFromMechanical(_destMechanicalPos).str().c_str());
                 LOGD("MotionPlanner _destMechanicalPos: (%i, %i, %i, %i)\n", _destMechanicalPos[0], _destMechanicalPos[1], _destMechanicalPos[2], _destMechanicalPos[3]);
+                checkDestCartesianPosition();
                 _isInMotion = false;
                 return;
             }
-            float transformedTime = _accel.transform(s.time); //transform the step time according to acceleration profile
-            EventClockT::duration transformedChronoTime = std::chrono::duration_cast<EventClockT::duration>(std::chrono::duration<float>(transformedTime));
-            LOGV("Step transformed time: %f\n", transformedTime);
+            const PlannedStep &step = _nextSteps[nextIdx];
+            LOGV("MotionPlanner::nextStep() is: %zu at %" PRId64 "\n", nextIdx, (int64_t)step.time.time_since_epoch().count());
             //update outputEventBuffer member variable:
-            tupleCallOnIndex(steppers, UpdateOutputEvents(), s.index(), this, _baseTime + transformedChronoTime);            
-            //Event e = s.getEvent(transformedTime);
-            //e.offset(_baseTime); //AxisSteppers report times relative to the start of motion; transform to absolute.
-            _destMechanicalPos[s.index()] += stepDirToSigned<int>(s.direction); //update the mechanical position tracked in software
-            //advance the respective AxisStepper to its next step:
-            s.nextStep(steppers, _useEndstops);
+            tupleCallOnIndex(_iters, UpdateOutputEvents(), nextIdx, this, step.time, step.direction);
+            _destMechanicalPos[nextIdx] += stepDirToSigned<int>(step.direction); //update the mechanical position tracked in software
+            //replace it just before choosing the next step, as endstops must be read as late as possible
+            _staleStepIdx = nextIdx;
             LOGV("MotionPlanner::nextStep() generated %zu OutputEvents\n", (endOutputEvent-curOutputEvent));
         }
-        //black magic to get nextStep to work when either AxisStepperTypes or HomeStepperTypes have length 0:
-        //If they are length zero, then _nextStep* just returns an empty event and a compilation error is avoided.
+        //black magic to get nextStep to work when AxisStepperTypes has length 0:
+        //If it is length zero, then _nextStep* does nothing and a compilation error is avoided.
         //Otherwise, the templated function is called, and _nextStep is run as usual:
         template <bool T> void _nextStepIfHaveSteppers(std::integral_constant<bool, T> ) {
-            _nextStep(_iters, AxisStepper::getNextTime(_iters));
+            _nextStep();
         }
         void _nextStepIfHaveSteppers(std::false_type ) {
         }
+        void clearNextSteps() {
+            _staleStepIdx = allStepsStale();
+        }
+        inline bool isStepGenerationParallel() const {
+            return _axisWorkers && !_useEndstops;
+        }
+        //called once the move's parameters are set, to have every worker begin generating its axis' first batch of steps.
+        void beginParallelStepGeneration() {
+            if (!isStepGenerationParallel()) {
+                return;
+            }
+            for (AxisWorker &w : *_axisWorkers) {
+                std::lock_guard<std::mutex> lock(w.mutex);
+                //every batch requested during the previous move was consumed before it could end
+                assert(!w.isFillRequested && !w.isFilling);
+                //begin with an empty front batch, so that the first step is taken from the batch being filled
+                w.batches[w.frontBatch].numSteps = 0;
+                w.batches[w.frontBatch].isLast = false;
+                w.frontStep = 0;
+                w.isBackReady = false;
+                requestStepBatch(w);
+            }
+        }
+        //have the worker begin filling the back batch. @w.mutex must be held.
+        void requestStepBatch(AxisWorker &w) {
+            w.isFillRequested = true;
+            w.isFillCancelled.store(false, std::memory_order_relaxed);
+            w.cond.notify_all();
+        }
+        //fill @batch with the next steps of axis @idx, stopping early if the axis runs out of steps
+        //  or (after at least one step) if @isCancelled is set.
+        void fillStepBatch(std::size_t idx, StepBatch &batch, const std::atomic<bool> &isCancelled) {
+            batch.numSteps = 0;
+            batch.isLast = false;
+            do {
+                bool hasStep;
+                tupleCallOnIndex(_iters, PlanNextStep(), idx, this, &batch.steps[batch.numSteps], &hasStep);
+                if (!hasStep) {
+                    batch.isLast = true;
+                    break;
+                }
+                ++batch.numSteps;
+            } while (batch.numSteps < batch.steps.size() && !isCancelled.load(std::memory_order_relaxed));
+        }
+        void stepWorkerLoop(std::size_t idx) {
+            #if USE_PTHREAD
+                //the event loop may wait on this thread for one step, so it mustn't be preempted by anything that the event loop isn't
+                struct sched_param sp;
+                sp.sched_priority = SchedulerBase::getSchedPriority();
+                if (int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp)) {
+                    LOGW("Warning: unable to give the step generation thread for axis %zu real-time priority: %i\n", idx, ret);
+                }
+            #endif
+            AxisWorker &w = (*_axisWorkers)[idx];
+            std::unique_lock<std::mutex> lock(w.mutex);
+            while (true) {
+                w.cond.wait(lock, [&w]() { return w.isFillRequested || w.isStopping; });
+                if (w.isStopping) {
+                    return;
+                }
+                w.isFillRequested = false;
+                w.isFilling = true;
+                StepBatch &back = w.batches[1-w.frontBatch];
+                lock.unlock();
+                fillStepBatch(idx, back, w.isFillCancelled);
+                lock.lock();
+                w.isFilling = false;
+                w.isBackReady = true;
+                w.cond.notify_all();
+            }
+        }
+        //move the next step of axis @idx from its worker into _nextSteps[idx].
+        //If the worker hasn't begun the next batch, the step is generated here instead of waiting for the worker to be scheduled.
+        //@return false if the axis has no more steps in this move.
+        bool takeStepFromWorker(std::size_t idx) {
+            AxisWorker &w = (*_axisWorkers)[idx];
+            StepBatch *front = &w.batches[w.frontBatch];
+            if (w.frontStep == front->numSteps && !front->isLast) {
+                std::unique_lock<std::mutex> lock(w.mutex);
+                if (w.isFillRequested) {
+                    //take the AxisStepper back from the worker, generate one step, and then let the worker continue from there
+                    w.isFillRequested = false;
+                    lock.unlock();
+                    bool hasStep;
+                    tupleCallOnIndex(_iters, PlanNextStep(), idx, this, &_nextSteps[idx], &hasStep);
+                    ++_numInlineSteps;
+                    if (!hasStep) {
+                        front->isLast = true;
+                    } else {
+                        lock.lock();
+                        requestStepBatch(w);
+                    }
+                    return hasStep;
+                }
+                //the worker is filling the batch: have it stop after its current step.
+                //It runs at our priority, so this wait is at most one step long.
+                w.isFillCancelled.store(true, std::memory_order_relaxed);
+                w.cond.wait(lock, [&w]() { return w.isBackReady; });
+                //swap in the filled batch, and have the worker begin on the next one
+                w.frontBatch = 1-w.frontBatch;
+                w.frontStep = 0;
+                w.isBackReady = false;
+                front = &w.batches[w.frontBatch];
+                if (!front->isLast) {
+                    requestStepBatch(w);
+                }
+            }
+            if (w.frontStep < front->numSteps) {
+                _nextSteps[idx] = front->steps[w.frontStep++];
+                return true;
+            }
+            return false;
+        }
 
     public:
         OutputEvent peekNextEvent() {
@@ -229,7 +544,7 @@ template <typename Interface> class MotionPlanner {
             }
             this->_baseTime = baseTime;
             this->_useEndstops = flags & USE_ENDSTOPS;
-            Vector4f cur = _coordMapper.xyzeFromMechanical(_destMechanicalPos);
+            Vector4f cur = destCartesianPosition();
             Vector4f dest = dest_;
             if (! (flags & NO_LEVELING)) {
                 //get the REAL destination, after leveling is applied
@@ -253,13 +568,36 @@ template <typename Interface> class MotionPlanner {
                 maxVelXyz = dist/minDuration;
             }
             
+            //slow the move such that no axis exceeds its own velocity or acceleration limit
+            KinematicLimits limits = _coordMapper.kinematicLimits();
+            float maxAccelXyz = INFINITY;
+            if (dist > 0) {
+                //each axis' velocity is proportional to its share of the path length
+                Vector4f axisRatios(std::fabs(dest.x()-cur.x())/dist, std::fabs(dest.y()-cur.y())/dist, 
+                                    std::fabs(dest.z()-cur.z())/dist, std::fabs(dest.e()-cur.e())/dist);
+                float limitedVelXyz = KinematicLimits::maxPathRate(limits.maxVelocity, axisRatios);
+                if (limitedVelXyz < maxVelXyz) {
+                    maxVelXyz = limitedVelXyz;
+                    minDuration = dist/maxVelXyz;
+                    velE = (dest.e() - cur.e())/minDuration;
+                }
+                maxAccelXyz = KinematicLimits::maxPathRate(limits.maxAcceleration, axisRatios);
+            } else if (std::fabs(velE) > limits.maxVelocity.e()) {
+                //extruder-only move
+                minDuration = std::fabs(dest.e()-cur.e())/limits.maxVelocity.e();
+                velE = (dest.e() - cur.e())/minDuration;
+            }
+            
             Vector3f vel = (dest.xyz()-cur.xyz())/minDuration;
             LOGD("MotionPlanner::moveTo %s -> %s\n", cur.str().c_str(), dest.str().c_str());
             LOGD("MotionPlanner::moveTo _destMechanicalPos: (%i, %i, %i, %i)\n", _destMechanicalPos[0], _destMechanicalPos[1], _destMechanicalPos[2], _destMechanicalPos[3]);
-            AxisStepper::initAxisSteppers(_iters, _useEndstops, _coordMapper, _destMechanicalPos, Vector4f(vel, velE));
+            AxisStepper::initAxisSteppers(_iters, _useEndstops, _coordMapper, _destMechanicalPos, cur, Vector4f(vel, velE));
+            clearNextSteps();
+            setDestCartesianPosition(dest);
             this->_duration = minDuration;
             this->_isInMotion = true;
-            this->_accel.begin(minDuration, maxVelXyz);
+            this->_accel.begin(minDuration, maxVelXyz, maxAccelXyz);
+            beginParallelStepGeneration();
             //prepare the move buffer so that peekNextEvent() is valid
             consumeNextEvent();
         }
@@ -272,7 +610,7 @@ template <typename Interface> class MotionPlanner {
             }
             this->_baseTime = baseTime;
             this->_useEndstops = flags & USE_ENDSTOPS;
-            Vector4f cur = _coordMapper.xyzeFromMechanical(_destMechanicalPos);
+            Vector4f cur = destCartesianPosition();
             Vector4f dest = dest_;
             if (! (flags & NO_LEVELING)) {
                 //get the REAL destination, after leveling is applied
@@ -330,7 +668,6 @@ template <typename Interface> class MotionPlanner {
                 minDuration = (dest.e()-cur.e())/newVelE;
                 maxVelXyz = arcLength/minDuration;
             }
-            float arcVel = maxVelXyz / arcRad;
                         
             //Want two perpindicular vectors such that <x, y, z> = P(t) = <xc, yc, zc> + r*cos(m*t)*u + r*sin(m*t)*v
             //Thus, u is the unit vector parallel to <x0, y0, z0> - <xc, yc, zc>
@@ -356,6 +693,24 @@ template <typename Interface> class MotionPlanner {
             if ((isCW && uCrossV_z > 0) || (!isCW && uCrossV_z < 0)) { //fix direction:
                 v = -v;
             }
+
+            //slow the move such that no axis exceeds its own velocity or acceleration limit.
+            //The direction of travel is -sin(t)*u + cos(t)*v, so the largest share of the path velocity that any xyz axis 
+            //  sees over the arc is the magnitude of (u, v) in that axis.
+            KinematicLimits limits = _coordMapper.kinematicLimits();
+            float maxAccelXyz = INFINITY;
+            if (arcLength > 0) {
+                Vector4f axisRatios(std::sqrt(u.x()*u.x() + v.x()*v.x()), std::sqrt(u.y()*u.y() + v.y()*v.y()), 
+                                    std::sqrt(u.z()*u.z() + v.z()*v.z()), std::fabs(velE)/maxVelXyz);
+                float limitedVelXyz = KinematicLimits::maxPathRate(limits.maxVelocity, axisRatios);
+                if (limitedVelXyz < maxVelXyz) {
+                    maxVelXyz = limitedVelXyz;
+                    minDuration = arcLength/maxVelXyz;
+                    velE = (dest.e()-cur.e())/minDuration;
+                }
+                maxAccelXyz = KinematicLimits::maxPathRate(limits.maxAcceleration, axisRatios);
+            }
+            float arcVel = maxVelXyz / arcRad;
             
             /*LOGD("MotionPlanner arc center (%f,%f,%f) current (%f,%f,%f) desired (%f,%f,%f) u (%f,%f,%f) v (%f,%f,%f) rad %f vel %f velE %f dur %f\n", 
                   center.x(), center.y(), center.z(), curX, curY, curZ, x, y, z, 
@@ -363,13 +718,17 @@ template <typename Interface> class MotionPlanner {
             LOGD("MotionPlanner arc orig center (%f,%f,%f), proj (%f,%f,%f) n(%f,%f,%f), mp(%f,%f,%f)\n", 
                 centerX_, centerY_, centerZ_, projcmpn.x(), projcmpn.y(), projcmpn.z(),
                 n.x(), n.y(), n.z(), mp.x(), mp.y(), mp.z());*/
-            AxisStepper::initAxisArcSteppers(_iters, _useEndstops, _coordMapper, _destMechanicalPos, center, u, v, arcRad, arcVel, velE);
+            AxisStepper::initAxisArcSteppers(_iters, _useEndstops, _coordMapper, _destMechanicalPos, cur, center, u, v, arcRad, arcVel, velE);
+            clearNextSteps();
+            //the arc ends at P(arcAngle), which is @dest unless v had to be flipped above
+            setDestCartesianPosition(Vector4f(center + (u*cos(arcAngle) + v*sin(arcAngle))*arcRad, dest.e()));
             /*if (std::tuple_size<ArcStepperTypes>::value == 0) {
                 return; //Prevents hanging on machines with 0 axes. Place this as far along as possible so one can test most algorithms on the Example machine.
             }*/
             this->_duration = minDuration;
             this->_isInMotion = true;
-            this->_accel.begin(minDuration, maxVelXyz);
+            this->_accel.begin(minDuration, maxVelXyz, maxAccelXyz);
+            beginParallelStepGeneration();
             //prepare the move buffer so that peekNextEvent() is valid
             consumeNextEvent();
         }
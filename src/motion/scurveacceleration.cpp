@@ -0,0 +1,105 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "scurveacceleration.h"
+#include "constantacceleration.h"
+#include "catch.hpp"
+
+using namespace motion;
+
+namespace {
+    //Path statistics gathered by sampling an AccelerationProfile's transform at evenly-spaced distances
+    struct ProfileStats {
+        float endTime;
+        float maxVelocity;
+        float maxVelocityJump;
+        float maxAccel;
+        bool isMonotonic;
+    };
+    template <typename ProfileT> ProfileStats sampleProfile(ProfileT profile, float duration, float Vmax, int numSamples) {
+        profile.begin(duration, Vmax);
+        ProfileStats stats = {profile.transform(duration), 0, 0, 0, true};
+        //each sample travels Vmax*dt along the path
+        float dt = duration / numSamples;
+        float prevTime = profile.transform(0);
+        float prevVel = 0, prevInterval = 0;
+        for (int i=1; i<=numSamples; ++i) {
+            float time = profile.transform(i*dt);
+            stats.isMonotonic = stats.isMonotonic && time > prevTime;
+            //average velocity over the sample, which is the true velocity at the middle of the sample's interval
+            float interval = time - prevTime;
+            float vel = Vmax*dt/interval;
+            stats.maxVelocity = std::max(stats.maxVelocity, vel);
+            if (i > 1) {
+                stats.maxVelocityJump = std::max(stats.maxVelocityJump, std::fabs(vel - prevVel));
+                stats.maxAccel = std::max(stats.maxAccel, std::fabs(vel - prevVel)/((interval + prevInterval)/2));
+            }
+            prevTime = time;
+            prevVel = vel;
+            prevInterval = interval;
+        }
+        return stats;
+    }
+}
+
+TEST_CASE("SCurveAcceleration is continuous and slower to ramp up than ConstantAcceleration", "[accel]") {
+    const float accel = 1000, jerk = 20000, Vmax = 100;
+    SECTION("Moves long enough to reach Vmax") {
+        const float duration = 1.0; //i.e. 100 mm
+        ProfileStats sCurve = sampleProfile(SCurveAcceleration(accel, jerk), duration, Vmax, 1000);
+        ProfileStats constAccel = sampleProfile(ConstantAcceleration(accel), duration, Vmax, 1000);
+        REQUIRE(sCurve.isMonotonic);
+        REQUIRE(constAccel.isMonotonic);
+        //the move starts at rest
+        REQUIRE(SCurveAcceleration(accel, jerk).transform(0) == Approx(0));
+        //neither profile exceeds Vmax or the acceleration limit
+        REQUIRE(sCurve.maxVelocity <= Vmax*1.001);
+        REQUIRE(constAccel.maxVelocity <= Vmax*1.001);
+        REQUIRE(sCurve.maxAccel <= accel*1.05);
+        REQUIRE(constAccel.maxAccel <= accel*1.05);
+        //velocity is continuous: no sample should jump by more than the distance it takes at full acceleration
+        REQUIRE(sCurve.maxVelocityJump <= constAccel.maxVelocityJump*1.05);
+        //each of the 2 jerk phases in both acceleration & deceleration costs an extra accel/jerk/2 seconds
+        REQUIRE(constAccel.endTime == Approx(duration + Vmax/accel));
+        REQUIRE(sCurve.endTime == Approx(duration + Vmax/accel + accel/jerk));
+    }
+    SECTION("Moves too short to reach Vmax") {
+        const float duration = 0.01; //i.e. 1 mm
+        SCurveAcceleration profile(accel, jerk);
+        ProfileStats sCurve = sampleProfile(profile, duration, Vmax, 1000);
+        REQUIRE(sCurve.isMonotonic);
+        REQUIRE(sCurve.maxVelocity < Vmax);
+        REQUIRE(sCurve.maxAccel <= accel*1.05);
+        //the velocity profile is symmetric, so the midpoint is reached at half the total time
+        profile.begin(duration, Vmax);
+        REQUIRE(profile.transform(duration/2) == Approx(sCurve.endTime/2));
+    }
+    SECTION("Homing moves, of unknown duration") {
+        SCurveAcceleration profile(accel, jerk);
+        profile.begin(NAN, Vmax);
+        //once at Vmax, events are delayed by a constant amount: half the time spent accelerating
+        float interval = profile.transform(10) - profile.transform(9);
+        REQUIRE(interval == Approx(1));
+        REQUIRE(profile.transform(10) == Approx(10 + (Vmax/accel + accel/jerk)/2));
+    }
+}
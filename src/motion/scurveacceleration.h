@@ -0,0 +1,143 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MOTION_SCURVEACCELERATION_H
+#define MOTION_SCURVEACCELERATION_H
+
+#include <cmath> //for std::cbrt, std::sqrt, std::isnan
+#include <algorithm> //for std::min
+#include "accelerationprofile.h"
+#include "common/logging.h"
+
+namespace motion {
+
+/* 
+ * SCurveAcceleration is an implementation of motion::AccelerationProfile in which the acceleration is ramped up and down
+ *   at a bounded rate (jerk), rather than being switched on and off instantly as in ConstantAcceleration.
+ * The velocity therefore follows an "S" shape, which excites far less frame resonance and so allows for higher accelerations.
+ *
+ * Speeding up from rest to the peak velocity happens in (up to) 3 phases:
+ *   1. acceleration increases linearly at a rate of @jerk (distance is cubic in time)
+ *   2. acceleration is held at @accel (distance is quadratic in time)
+ *   3. acceleration decreases linearly back to 0 (distance is cubic in time)
+ * Slowing down is the mirror image. If the peak velocity is reached before @accel is, then phase 2 is skipped,
+ *   and if the move is too short to reach Vmax, the peak velocity is lowered such that the move ends at rest.
+ *
+ * The first two phases are inverted in closed form. The third is inverted with a few Newton iterations
+ *   which converge monotonically, as the distance function is convex and decreasing over that phase.
+ */
+class SCurveAcceleration : public AccelerationProfile {
+    float _accel;
+    float _jerk;
+    //false if the move doesn't travel along the path (e.g. extruder-only moves), in which case times aren't transformed
+    bool _doAccelerate;
+    float _vmax, _vpeak;
+    float _a; //acceleration actually used for this move, after considering the move's own limit
+    float _tj; //duration of each jerk phase
+    float _v1; //velocity at the end of phase 1
+    float _s1, _s2; //distance at the end of phases 1 and 2
+    float _taccel, _saccel; //time & distance at which the peak velocity is reached
+    float _stotal, _sdecel; //distance of the entire move & distance at which deceleration begins
+    float _ttotal; //time at which the move ends
+    //@return the time it takes to travel a distance of @s from rest, for 0 <= @s <= _saccel
+    inline float accelTime(float s) const {
+        if (s < _s1) {
+            return std::cbrt(6*s/_jerk);
+        } else if (s < _s2) {
+            float ds = s - _s1;
+            return _tj + (std::sqrt(_v1*_v1 + 2*_a*ds) - _v1)/_a;
+        } else {
+            //solve d = vpeak*u - jerk*u^3/6 for u, the time remaining until the peak velocity is reached.
+            //Starting from the linear estimate guarantees that Newton's method approaches the root from below.
+            float d = _saccel - s;
+            float u = d/_vpeak;
+            for (int i=0; i<3; ++i) {
+                u -= (_jerk*u*u*u/6 - _vpeak*u + d) / (_jerk*u*u/2 - _vpeak);
+            }
+            return _taccel - u;
+        }
+    }
+    //compute the durations of each phase needed to accelerate from rest to @vpeak
+    inline void setPeakVelocity(float vpeak) {
+        _vpeak = vpeak;
+        if (vpeak >= _a*_a/_jerk) { //full acceleration is reached
+            _tj = _a/_jerk;
+        } else {
+            _tj = std::sqrt(vpeak/_jerk);
+        }
+        float accelAtPeak = _jerk*_tj;
+        float ta = vpeak/accelAtPeak - _tj; //duration of phase 2
+        _v1 = _jerk*_tj*_tj/2;
+        _s1 = _jerk*_tj*_tj*_tj/6;
+        _s2 = _s1 + _v1*ta + accelAtPeak*ta*ta/2;
+        _taccel = 2*_tj + ta;
+        //the velocity curve is symmetric about its midpoint, so the average velocity while accelerating is vpeak/2
+        _saccel = vpeak*_taccel/2;
+    }
+    public:
+        inline SCurveAcceleration(float accel, float jerk) : _accel(accel), _jerk(jerk) {}
+        inline void begin(float moveDuration, float Vmax, float maxAccel=INFINITY) {
+            _doAccelerate = Vmax > 0;
+            if (!_doAccelerate) {
+                return;
+            }
+            _vmax = Vmax;
+            _a = std::min(_accel, maxAccel);
+            _stotal = std::isnan(moveDuration) ? INFINITY : Vmax*moveDuration;
+            setPeakVelocity(Vmax);
+            if (2*_saccel > _stotal) {
+                //too short to reach Vmax. Solve for the peak velocity at which acceleration + deceleration covers the whole move:
+                //  s = vpeak*(vpeak/a + a/jerk) if full acceleration is reached, else s = 2*vpeak*sqrt(vpeak/jerk)
+                float aOverJ = _a/_jerk;
+                float vpeak = _a/2*(std::sqrt(aOverJ*aOverJ + 4*_stotal/_a) - aOverJ);
+                if (vpeak < _a*aOverJ) {
+                    vpeak = std::cbrt(_stotal*_stotal*_jerk/4);
+                }
+                setPeakVelocity(vpeak);
+                _saccel = _stotal/2; //avoid any gap between the acceleration & deceleration phases due to rounding
+            }
+            _sdecel = _stotal - _saccel;
+            _ttotal = 2*_taccel + (_sdecel - _saccel)/_vpeak;
+            LOGD("SCurveAcceleration::begin dur, Vmax, Vpeak: %f, %f, %f\n", moveDuration, Vmax, _vpeak);
+            LOGD("SCurveAcceleration::begin tj, taccel, saccel, ttotal: %f, %f, %f, %f\n", _tj, _taccel, _saccel, _ttotal);
+        }
+        inline float transform(float time) {
+            LOGV("SCurveAcceleration::transform: %f\n", time);
+            if (!_doAccelerate) {
+                return time;
+            }
+            //distance along the path at which this event occurs
+            float s = _vmax*time;
+            if (s < _saccel) { //accelerating
+                return accelTime(s);
+            } else if (s < _sdecel) { //constant velocity
+                return _taccel + (s - _saccel)/_vpeak;
+            } else { //decelerating. Never reached if moveDuration was NAN (ie in homing routine)
+                return _ttotal - accelTime(std::max(0.f, _stotal - s));
+            }
+        }
+};
+
+}
+
+#endif
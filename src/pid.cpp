@@ -30,7 +30,8 @@ float PID::feed(float setpoint, float pv) {
     float deltaT = refreshTime();
     // Use a simple 1st order finite difference for the derivative - no fancy filtering.
     // Note the negation: this is because the D term is the derivative of the *error* (setpoint - pv).
-    float errorD = -(pv-lastValue)/deltaT;
+    // The first reading has no previous one (deltaT == 0); treat it as steady rather than produce inf/nan.
+    float errorD = deltaT > 0 ? -(pv-lastValue)/deltaT : 0;
     lastValue = pv;
     // Then figure out the change for the integral
     float update = I() * error * deltaT;
@@ -33,6 +33,7 @@
 
     #ifdef PLATFORM_DRIVER_CHRONOCLOCK
         //custom platform clock type. Must make ALL sleeps relative (unless platform also provides ThisThreadSleep
+        #include "platforms/auto/chronoclock.h" //for EventClockT
         #include "boilerplate/thisthreadsleepadapter.h"
         #include "platforms/generic/thisthreadsleep.h"
         typedef ThisThreadSleepAdapter<EventClockT, plat::generic::ThisThreadSleep> SleepT;
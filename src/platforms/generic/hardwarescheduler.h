@@ -28,6 +28,7 @@
 
 #include "platforms/auto/chronoclock.h" //for EventClockT
 #include "platforms/auto/primitiveiopin.h"
+#include "platforms/generic/inputcapture.h"
 #include "schedulerbase.h" //for OnIdleCpuIntervalT (cannot forward-declare an enum)
 #include "common/logging.h"
 
@@ -39,6 +40,11 @@ namespace plat {
 namespace generic {
 
 struct HardwareScheduler {
+    //there's no hardware to capture inputs, so they're sampled in software (shared by every HardwareScheduler instance).
+    static inline InputCapture& inputCapture() {
+        static InputCapture capture;
+        return capture;
+    }
     //add this event to the hardware queue, waiting until schedTime(evt.time()) if necessary
     inline void queue(OutputEvent evt) {
         evt.primitiveIoPin().digitalWrite(evt.state());
@@ -58,8 +64,26 @@ struct HardwareScheduler {
     //@return true if we request more cpu time.
     inline bool onIdleCpu(OnIdleCpuIntervalT interval) {
         (void)interval; //unused
+        if (inputCapture().numChannels()) {
+            inputCapture().sample(EventClockT::now());
+        }
         return false; //no more cpu needed
     }
+    //Begin recording the level of @pin, so that drivers can later find when it changed via findCapturedLevel.
+    //@return a channel to pass to findCapturedLevel, or -1 if the pin can't be captured.
+    inline int captureInput(const PrimitiveIoPin &pin) {
+        return inputCapture().addChannel(pin);
+    }
+    //Find the earliest time at or after @since at which the pin captured on @channel read @level.
+    //@return true and set @at to that time if the level has been captured.
+    //  Otherwise, set @at to the time up to which the captured levels were searched, from which a later search can resume.
+    inline bool findCapturedLevel(int channel, IoLevel level, EventClockT::time_point since, EventClockT::time_point &at) const {
+        return inputCapture().findLevel(channel, level, since, at);
+    }
+    //@return the time at which onIdleCpu next has work to do, so that the scheduler doesn't sleep past it.
+    inline EventClockT::time_point nextIdleCpuDeadline() const {
+        return EventClockT::time_point::max(); //never
+    }
 };
 }
 }
@@ -0,0 +1,102 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "platforms/generic/inputcapture.h"
+#include <cmath>
+#include "outputevent.h" //must be complete before HardwareScheduler::queue is defined
+#include "platforms/generic/hardwarescheduler.h"
+#include "iodrivers/rcthermistor2pin.h"
+#include "common/mathutil.h"
+#include "catch.hpp"
+
+using namespace plat::generic;
+
+TEST_CASE("InputCapture finds the earliest sample at a given level", "[inputcapture]") {
+    typedef EventClockT::time_point T;
+    typedef std::chrono::milliseconds ms;
+    InputCapture capture;
+    //channel 1 goes high at 30 ms
+    for (int t=0; t<=50; t += 10) {
+        capture.record(T(ms(t)), t >= 30 ? 0x2 : 0x1);
+    }
+    T at;
+    SECTION("The edge is found from before it occurred") {
+        REQUIRE(capture.findLevel(1, IoHigh, T(ms(5)), at));
+        REQUIRE(at == T(ms(30)));
+    }
+    SECTION("Samples before the search start are ignored") {
+        REQUIRE(!capture.findLevel(0, IoHigh, T(ms(25)), at));
+        //the search can resume from the newest sample
+        REQUIRE(at == T(ms(50)));
+    }
+    SECTION("Samples overwritten by newer ones are forgotten") {
+        for (std::size_t i=0; i<InputCapture::NUM_SAMPLES; ++i) {
+            capture.record(T(ms(100+i)), 0x0);
+        }
+        REQUIRE(!capture.findLevel(1, IoHigh, T(ms(0)), at));
+    }
+}
+
+TEST_CASE("RCThermistor2Pin times a charge through the emulated input capture", "[inputcapture][rcthermistor]") {
+    //ramps-fd values, and a 100k thermistor at 200 C
+    const float Rchrg = 1000, Rseries = 22, Rup = 4700, C = 10e-6, Vcc = 3.3, Vtoggle = 1.65, T0 = 25, R0 = 100000, B = 3950;
+    const float temperature = 200;
+    //a calibration read charges the capacitor through Rup alone; a normal read also charges it through the thermistor
+    float vi = Vcc*Rchrg / (Rup+Rchrg);
+    float lnToggle = std::log((Vtoggle-Vcc) / (vi-Vcc));
+    float thermR = R0*std::exp(B*(1/mathutil::CtoK(temperature) - 1/mathutil::CtoK(T0)));
+    float readR = Rup*(Rseries+thermR) / (Rup+Rseries+thermR);
+    auto seconds = [](float s) { return std::chrono::duration_cast<EventClockT::duration>(std::chrono::duration<float>(s)); };
+    EventClockT::duration calibrationTime = seconds(-Rup*C*lnToggle), readTime = seconds(-readR*C*lnToggle);
+
+    const int THERM_PIN = 0, CHRG_MEAS_PIN = 1;
+    //with inverted reads & writes, the driver sees the same levels, but the captured (primitive) levels are inverted
+    for (iodrv::IoPinInversions inversions : {iodrv::NO_INVERSIONS, iodrv::INVERT_READS | iodrv::INVERT_WRITES}) {
+        bool isInverted = inversions != iodrv::NO_INVERSIONS;
+        iodrv::RCThermistor2Pin therm(iodrv::IoPin(iodrv::NO_INVERSIONS, PrimitiveIoPin::simulated(THERM_PIN)),
+            iodrv::IoPin(inversions, PrimitiveIoPin::simulated(CHRG_MEAS_PIN)),
+            Rchrg, Rseries, Rup, C, Vcc, Vtoggle, T0, R0, B, std::chrono::milliseconds(300));
+        //emulate the circuit: once CHRG/MEAS stops holding the capacitor low, it reaches Vtoggle after a known time.
+        //The driver only sees the edge via the samples HardwareScheduler::onIdleCpu captures.
+        //If this loop is preempted around the edge, that read comes out late, so keep reading until one is accurate.
+        bool isCharging = false;
+        EventClockT::time_point chargeStart, giveUp = EventClockT::now() + std::chrono::seconds(3);
+        EventClockT::duration chargeTime;
+        while (std::fabs(therm.value() / temperature - 1) >= 0.01 && EventClockT::now() < giveUp) {
+            EventClockT::time_point now = EventClockT::now();
+            if (PrimitiveIoPin::isSimulatedOutput(CHRG_MEAS_PIN)) {
+                isCharging = false;
+            } else {
+                if (!isCharging) {
+                    isCharging = true;
+                    chargeStart = now;
+                    chargeTime = PrimitiveIoPin::isSimulatedOutput(THERM_PIN) ? readTime : calibrationTime;
+                }
+                PrimitiveIoPin::setSimulatedLevel(CHRG_MEAS_PIN, (now - chargeStart >= chargeTime) != isInverted);
+            }
+            HardwareScheduler().onIdleCpu(OnIdleCpuIntervalShort);
+            therm.onIdleCpu(OnIdleCpuIntervalShort);
+        }
+        REQUIRE(std::fabs(therm.value() / temperature - 1) < 0.01);
+    }
+}
@@ -0,0 +1,120 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PLATFORMS_GENERIC_INPUTCAPTURE_H
+#define PLATFORMS_GENERIC_INPUTCAPTURE_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef> //for size_t
+
+#include "compileflags.h" //for IoLevel
+#include "platforms/auto/chronoclock.h" //for EventClockT
+#include "platforms/auto/primitiveiopin.h"
+
+namespace plat {
+namespace generic {
+
+/*
+ * Software emulation of an input capture channel (see HardwareScheduler::captureInput).
+ * Platforms like rpi capture pin levels at a fixed rate in hardware, so that drivers can learn exactly when an input changed
+ *   without polling it themselves. Here, each captured pin is instead sampled via digitalRead() whenever the scheduler has idle cpu,
+ *   and the samples are kept in a ring along with the time they were taken.
+ * The timing is therefore only as precise as the sampling rate, but drivers work the same as on platforms with real input capture.
+ */
+class InputCapture {
+    public:
+        static const int MAX_CHANNELS = 32;
+        static const std::size_t NUM_SAMPLES = 1024;
+    private:
+        struct Sample {
+            EventClockT::time_point time;
+            //bit N holds the level of channel N
+            uint32_t levels;
+        };
+        std::array<PrimitiveIoPin, MAX_CHANNELS> _pins;
+        int _numChannels;
+        std::array<Sample, NUM_SAMPLES> _samples;
+        //index at which the next sample will be written
+        std::size_t _nextSample;
+        std::size_t _numSamples;
+    public:
+        inline InputCapture() : _numChannels(0), _nextSample(0), _numSamples(0) {}
+        //begin capturing the level of @pin.
+        //@return the channel that the pin's level is recorded in, or -1 if all channels are in use.
+        inline int addChannel(const PrimitiveIoPin &pin) {
+            if (_numChannels == MAX_CHANNELS) {
+                return -1;
+            }
+            _pins[_numChannels] = pin;
+            return _numChannels++;
+        }
+        inline int numChannels() const {
+            return _numChannels;
+        }
+        //read every captured pin and record the levels as of @time
+        inline void sample(EventClockT::time_point time) {
+            uint32_t levels = 0;
+            for (int c=0; c<_numChannels; ++c) {
+                levels |= (uint32_t)_pins[c].digitalRead() << c;
+            }
+            record(time, levels);
+        }
+        //store one sample (bit N of @levels is the level of channel N). Samples must be recorded in chronological order.
+        inline void record(EventClockT::time_point time, uint32_t levels) {
+            _samples[_nextSample].time = time;
+            _samples[_nextSample].levels = levels;
+            _nextSample = (_nextSample+1) % NUM_SAMPLES;
+            if (_numSamples < NUM_SAMPLES) {
+                ++_numSamples;
+            }
+        }
+        //find the earliest sample taken at or after @since in which @channel read @level.
+        //@return true and set @at to the time of that sample if one exists.
+        //  Otherwise, set @at to the time of the newest sample (or @since, if there are none since then).
+        inline bool findLevel(int channel, IoLevel level, EventClockT::time_point since, EventClockT::time_point &at) const {
+            bool found = false;
+            at = (_numSamples && sampleFromNewest(0).time >= since) ? sampleFromNewest(0).time : since;
+            //walk backwards from the newest sample, so that the search stops as soon as it passes @since
+            for (std::size_t i=0; i<_numSamples; ++i) {
+                const Sample &s = sampleFromNewest(i);
+                if (s.time < since) {
+                    break;
+                }
+                if ((IoLevel)((s.levels >> channel) & 1) == level) {
+                    at = s.time;
+                    found = true;
+                }
+            }
+            return found;
+        }
+    private:
+        inline const Sample& sampleFromNewest(std::size_t age) const {
+            return _samples[(_nextSample + NUM_SAMPLES - 1 - age) % NUM_SAMPLES];
+        }
+};
+
+}
+}
+
+#endif
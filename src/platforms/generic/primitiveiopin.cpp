@@ -0,0 +1,67 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Colin Wallace
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+//Tests of drivers whose output is only observable through their pins, using the generic platform's simulated pins.
+
+#include "platforms/generic/primitiveiopin.h"
+#include "iodrivers/tempcontrol.h"
+#include "iodrivers/iopin.h"
+#include "common/mathutil.h"
+#include "pid.h"
+#include "catch.hpp"
+
+using namespace iodrv;
+
+namespace {
+    //thermistor that reads whatever the test sets @*temp to (a reading <= absolute zero signals a failed read, as from AdcThermistor)
+    struct FakeThermistor {
+        const float *temp;
+        bool onIdleCpu(OnIdleCpuIntervalT interval) {
+            (void)interval; //unused
+            return false;
+        }
+        float value() const {
+            return *temp;
+        }
+        EventClockT::time_point nextIdleCpuDeadline() const {
+            return EventClockT::time_point::max();
+        }
+    };
+}
+
+TEST_CASE("A failed thermistor reading turns the heater off", "[tempcontrol]") {
+    const int HEATER_PIN = 2;
+    float temp = 25;
+    //the pwm is updated on every wide interval
+    TempControl<FakeThermistor> hotend(HotendType, IoPin(NO_INVERSIONS, PrimitiveIoPin::simulated(HEATER_PIN)),
+        FakeThermistor{&temp}, PID(1, 0, 0), NoFilter(), std::chrono::microseconds(40), std::chrono::milliseconds(0));
+    hotend.setTargetTemperature(200);
+
+    //at 25 C, the heater is fully on
+    hotend.onIdleCpu(OnIdleCpuIntervalWide);
+    REQUIRE(hotend.getMeasuredTemperature() == Approx(25));
+    REQUIRE(PrimitiveIoPin::simulatedLevel(HEATER_PIN) == IoHigh);
+    temp = mathutil::ABSOLUTE_ZERO_CELCIUS;
+    hotend.onIdleCpu(OnIdleCpuIntervalWide);
+    REQUIRE(PrimitiveIoPin::simulatedLevel(HEATER_PIN) == IoLow);
+}
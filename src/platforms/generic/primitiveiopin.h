@@ -25,6 +25,8 @@
 #ifndef PLATFORMS_GENERIC_PRIMITIVEIOPIN_H
 #define PLATFORMS_GENERIC_PRIMITIVEIOPIN_H
 
+#include <array>
+#include <cassert>
 #include <tuple>
 
 #include "compileflags.h" //for IoLevel
@@ -34,47 +36,131 @@
 namespace plat {
 namespace generic {
 
-//Implementation for a basic (do-nothing) GPIO pin
+/* 
+ * Implementation for a basic (do-nothing) GPIO pin.
+ *
+ * Pins created with simulated() are instead backed by a level in memory, rather than by hardware, and aren't null.
+ * Writes set that level, and reads return it, so tests can drive a driver's inputs via setSimulatedLevel 
+ *   (e.g. emulate the circuit that an RCThermistor2Pin measures) and observe its outputs via simulatedLevel.
+ */
 class PrimitiveIoPin {
+    public:
+        static const int NUM_SIMULATED_PINS = 16;
+    private:
+        struct SimulatedState {
+            IoLevel level;
+            bool isOutput;
+        };
+        //index into simulatedStates(), or -1 if this isn't a simulated pin
+        int _simulatedId;
+        inline static std::array<SimulatedState, NUM_SIMULATED_PINS>& simulatedStates() {
+            static std::array<SimulatedState, NUM_SIMULATED_PINS> states;
+            return states;
+        }
+        inline SimulatedState& simulatedState() const {
+            return simulatedStates()[_simulatedId];
+        }
     public:
         inline static PrimitiveIoPin null() { return PrimitiveIoPin(); }
-        inline bool isNull() const { return true; }
+        inline bool isNull() const { return _simulatedId == -1; }
+        //@return a pin backed by simulated state @id (0 <= id < NUM_SIMULATED_PINS). Pins with the same id share their state.
+        inline static PrimitiveIoPin simulated(int id) {
+            assert(id >= 0 && id < NUM_SIMULATED_PINS);
+            PrimitiveIoPin pin;
+            pin._simulatedId = id;
+            return pin;
+        }
+        //set the level that simulated pin @id will read as, e.g. to emulate an external circuit driving it.
+        inline static void setSimulatedLevel(int id, IoLevel level) {
+            simulatedStates()[id].level = level;
+        }
+        inline static IoLevel simulatedLevel(int id) {
+            return simulatedStates()[id].level;
+        }
+        //@return true if simulated pin @id was last configured as an output (of any type), or false if it's an input.
+        inline static bool isSimulatedOutput(int id) {
+            return simulatedStates()[id].isOutput;
+        }
+        //@return true if the platform can output exact pulses (see makePulseOutput) without cpu involvement.
+        //  Drivers that need them otherwise have to generate each edge as an OutputEvent.
+        inline static constexpr bool hasPulseOutput() { return false; }
         //We want to use this PrimitiveIoPin on any architecture, 
         // so let it be constructed with whatever platform-specific arguments the config file uses with its IO pins
-        template <typename ...T> PrimitiveIoPin(T ...args) {
+        template <typename ...T> PrimitiveIoPin(T ...args) : _simulatedId(-1) {
             (void)std::make_tuple(args...); //unused
         }
 
-        //do-nothing implementations for basic functions
+        //do-nothing implementations for basic functions (except on simulated pins)
         //Note: the return type of id() is platform-specific, though it must never be void.
-        inline int id() const { return -1; }
+        inline int id() const { return _simulatedId; }
         inline void makeDigitalOutput(IoLevel level) {
-            (void)level;
-            LOGW_ONCE("Attempt to makeDigitalOutput() the generic PrimitiveIoPin interface\n");
+            if (isNull()) {
+                LOGW_ONCE("Attempt to makeDigitalOutput() the generic PrimitiveIoPin interface\n");
+                return;
+            }
+            simulatedState().isOutput = true;
+            simulatedState().level = level;
         }
         //configure the pin to be an input
         inline void makeDigitalInput() {
-            LOGW_ONCE("Attempt to makeDigitalInput() the generic PrimitiveIoPin interface\n");
+            if (isNull()) {
+                LOGW_ONCE("Attempt to makeDigitalInput() the generic PrimitiveIoPin interface\n");
+                return;
+            }
+            simulatedState().isOutput = false;
         }
         //configure the pin as a PWM output & set its duty cycle and period (if applicable)
         inline void makePwmOutput(float duty, EventClockT::duration desiredPeriod) {
-            (void)duty; (void)desiredPeriod;
-            LOGW_ONCE("Attempt to makePwmOutput() the generic PrimitiveIoPin interface\n");
+            (void)desiredPeriod;
+            if (isNull()) {
+                LOGW_ONCE("Attempt to makePwmOutput() the generic PrimitiveIoPin interface\n");
+                return;
+            }
+            //a simulated pin has no notion of time, so it holds whichever level dominates the cycle
+            simulatedState().isOutput = true;
+            simulatedState().level = duty >= 0.5;
+        }
+        //configure the pin to go high for @onTime at the start of every @period
+        inline void makePulseOutput(EventClockT::duration onTime, EventClockT::duration period) {
+            if (isNull()) {
+                LOGW_ONCE("Attempt to makePulseOutput() the generic PrimitiveIoPin interface\n");
+                return;
+            }
+            simulatedState().isOutput = true;
+            simulatedState().level = onTime*2 >= period;
         }
         //read the pin's input value (assumes pin is configured as digital)
         inline IoLevel digitalRead() const { 
-            LOGW_ONCE("Attempt to digitalRead() the generic PrimitiveIoPin interface\n");
-            return IoLow; 
+            if (isNull()) {
+                LOGW_ONCE("Attempt to digitalRead() the generic PrimitiveIoPin interface\n");
+                return IoLow; 
+            }
+            return simulatedState().level;
         }
         //Write a digital value to the pin. Note: must first call makeDigitalOutput.
         inline void digitalWrite(IoLevel level) {
-            (void)level;
-            LOGW_ONCE("Attempt to digitalWrite() the generic PrimitiveIoPin interface\n");
+            if (isNull()) {
+                LOGW_ONCE("Attempt to digitalWrite() the generic PrimitiveIoPin interface\n");
+                return;
+            }
+            simulatedState().level = level;
         }
         //set pwm duty cycle & period (if applicable). Must call makePwmOutput beforehand.
         inline void pwmWrite(float duty, EventClockT::duration desiredPeriod) {
-            (void)duty; (void)desiredPeriod;
-            LOGW_ONCE("Attempt to pwmWrite() the generic PrimitiveIoPin interface\n");
+            (void)desiredPeriod;
+            if (isNull()) {
+                LOGW_ONCE("Attempt to pwmWrite() the generic PrimitiveIoPin interface\n");
+                return;
+            }
+            simulatedState().level = duty >= 0.5;
+        }
+        //change the pulse width & period. Must call makePulseOutput beforehand.
+        inline void pulseWrite(EventClockT::duration onTime, EventClockT::duration period) {
+            if (isNull()) {
+                LOGW_ONCE("Attempt to pulseWrite() the generic PrimitiveIoPin interface\n");
+                return;
+            }
+            simulatedState().level = onTime*2 >= period;
         }
 };
 
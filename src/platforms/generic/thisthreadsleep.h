@@ -27,7 +27,9 @@
 #if defined (__unix__) || (defined (__APPLE__) && defined (__MACH__))
 
     #include <chrono>
+    #include <cstddef> //for size_t
     #include <time.h>
+    #include <poll.h> //for ppoll
 
     namespace plat {
     namespace generic {
@@ -54,6 +56,25 @@
                 tsSleepUntil.tv_nsec = durNsec.count();
                 clock_nanosleep(CLOCK_MONOTONIC, 0, &tsSleepUntil, nullptr); //0 = time given is relative.
             }
+            //sleep like sleep_until, but wake early if any of the @numFds descriptors in @fds has an event.
+            //returns the number of descriptors with events, as poll() does.
+            template<class Clock, class Duration> static int poll_until(const std::chrono::time_point<Clock, Duration> &sleep_time, struct pollfd *fds, std::size_t numFds) {
+                if (numFds == 0) {
+                    //nothing to wait on, so keep the precision of an absolute sleep
+                    sleep_until(sleep_time);
+                    return 0;
+                }
+                return poll_for(sleep_time - Clock::now(), fds, numFds);
+            }
+            template <class Rep, class Period> static int poll_for(const std::chrono::duration<Rep, Period> &dur, struct pollfd *fds, std::size_t numFds) {
+                auto durNonNeg = dur.count() > 0 ? dur : std::chrono::duration<Rep, Period>::zero();
+                auto durSec = std::chrono::duration_cast<std::chrono::seconds>(durNonNeg);
+                auto durNsec = std::chrono::duration_cast<std::chrono::nanoseconds>(durNonNeg) - durSec;
+                timespec tsTimeout;
+                tsTimeout.tv_sec = durSec.count();
+                tsTimeout.tv_nsec = durNsec.count();
+                return ppoll(fds, numFds, &tsTimeout, nullptr);
+            }
     };
 
     }
@@ -11,6 +11,8 @@
 #include <errno.h> //for errno
 #include <pthread.h> //for pthread_setschedparam
 #include <chrono>
+#include <algorithm> //for std::max
+#include <cmath> //for std::floor
 
 #include "primitiveiopin.h"
 #include "outputevent.h"
@@ -405,7 +407,9 @@ uintptr_t UnwrappedHardwareScheduler::DmaMem::virtToPhys(void *virt) const {
 
 UnwrappedHardwareScheduler::UnwrappedHardwareScheduler() 
   : _lastTimeAtFrame0(0)
-  , _lastDmaSyncedTime(std::chrono::seconds(0)) {
+  , _dmaClock(1000000.0/(FRAMES_PER_SEC))
+  , _lastDmaSyncedTime(std::chrono::seconds(0))
+  , _nextDmaSyncTime(std::chrono::seconds(0)) {
     dmaCh = 5;
     SchedulerBase::registerExitHandler(&cleanup, SCHED_IO_EXIT_LEVEL);
     makeMaps();
@@ -454,7 +458,8 @@ void UnwrappedHardwareScheduler::initSrcAndControlBlocks() {
     srcArray = (struct GpioBufferFrame*)srcMem.virtL2Coherent; //Note: calling virtToPhys on srcArray will return NULL. Use srcArrayCached for that.
     
     //allocate memory for the control blocks
-    size_t cbPageBytes = numSrcBlocks * sizeof(struct DmaControlBlock) * 3; //3 cbs for each source block
+    size_t numCaptureBlocks = numSrcBlocks / INPUT_CAPTURE_FRAME_STRIDE;
+    size_t cbPageBytes = (numSrcBlocks*3 + numCaptureBlocks) * sizeof(struct DmaControlBlock); //3 cbs for each source block, plus 1 per capture
     cbMem = DmaMem(*this, cbPageBytes);
     //fill the control blocks:
     cbArr = (struct DmaControlBlock*)cbMem.virtL2Coherent;
@@ -462,6 +467,10 @@ void UnwrappedHardwareScheduler::initSrcAndControlBlocks() {
     //Allocate memory for the default src outputs (used in PWM, defaults to zeros)
     srcClrMem = DmaMem(*this, srcPageBytes);
     srcClrArray = (struct GpioBufferFrame*)srcClrMem.virtL2Coherent;
+
+    //Allocate memory for the captured GPIO levels
+    captureMem = DmaMem(*this, numCaptureBlocks*NUM_GPIO_WORDS*sizeof(uint32_t));
+    captureArr = (volatile uint32_t*)captureMem.virtL2Coherent;
     
     LOG("platforms::rpi::UnwrappedHardwareScheduler::initSrcAndControlBlocks: #dma blocks: %zu, #src blocks: %zu\n", numSrcBlocks*3, numSrcBlocks);
     for (unsigned int i=0; i<numSrcBlocks*3; i += 3) {
@@ -488,7 +497,20 @@ void UnwrappedHardwareScheduler::initSrcAndControlBlocks() {
         cbArr[i+2].TXFR_LEN = DMA_CB_TXFR_LEN_YLENGTH(1) | DMA_CB_TXFR_LEN_XLENGTH(sizeof(struct GpioBufferFrame));
         cbArr[i+2].STRIDE = i/3; //might be better to use the NEXT index
         int nextIdx = i+3 < numSrcBlocks*3 ? i+3 : 0; //last block should loop back to the first block
-        cbArr[i+2].NEXTCONBK = physToUncached(cbMem.physAddrAtByteOffset(nextIdx*sizeof(DmaControlBlock)));
+        if (i/3 % INPUT_CAPTURE_FRAME_STRIDE == 0) {
+            //snapshot the GPIO levels into the capture ring before moving on to the next frame
+            unsigned int captureIdx = i/3 / INPUT_CAPTURE_FRAME_STRIDE;
+            unsigned int cbIdx = numSrcBlocks*3 + captureIdx;
+            cbArr[i+2].NEXTCONBK = physToUncached(cbMem.physAddrAtByteOffset(cbIdx*sizeof(DmaControlBlock)));
+            cbArr[cbIdx].TI = DMA_CB_TI_SRC_INC | DMA_CB_TI_DEST_INC | DMA_CB_TI_NO_WIDE_BURSTS | DMA_CB_TI_TDMODE;
+            cbArr[cbIdx].SOURCE_AD = GPIO_BASE_BUS + GPLEV0;
+            cbArr[cbIdx].DEST_AD = physToUncached(captureMem.physAddrAtByteOffset(captureIdx*NUM_GPIO_WORDS*sizeof(uint32_t)));
+            cbArr[cbIdx].TXFR_LEN = DMA_CB_TXFR_LEN_YLENGTH(1) | DMA_CB_TXFR_LEN_XLENGTH(NUM_GPIO_WORDS*4);
+            cbArr[cbIdx].STRIDE = i/3; //syncDmaTime reads the current frame from here
+            cbArr[cbIdx].NEXTCONBK = physToUncached(cbMem.physAddrAtByteOffset(nextIdx*sizeof(DmaControlBlock)));
+        } else {
+            cbArr[i+2].NEXTCONBK = physToUncached(cbMem.physAddrAtByteOffset(nextIdx*sizeof(DmaControlBlock)));
+        }
     }
 }
 
@@ -608,26 +630,75 @@ void UnwrappedHardwareScheduler::syncDmaTime() {
             srcIdx = dmaHeader->STRIDE; //the source index is stored in the otherwise-unused STRIDE register, for efficiency
             curTime2 = EventClockT::now();
         } while (std::chrono::duration_cast<std::chrono::microseconds>(curTime2-curTime1).count() > (RUNNING_IN_VM ? 250 : 1) || (srcIdx & DMA_CB_TXFR_YLENGTH_MASK)); //allow 1 uS variability, or 50 uS if running in a VM (valgrind)
-        //Uncomment the following lines and the above declaration of _lastTimeAtFrame0 to log jitter information:
-        int64_t curTimeAtFrame0 = std::chrono::duration_cast<std::chrono::microseconds>(curTime2.time_since_epoch()).count() - FRAME_TO_USEC(srcIdx);
-        int timeDiff = (curTimeAtFrame0-_lastTimeAtFrame0)%FRAME_TO_USEC(SOURCE_BUFFER_FRAMES);
-        if (timeDiff > FRAME_TO_USEC(SOURCE_BUFFER_FRAMES)/2) { //wrap-around
-            timeDiff -= FRAME_TO_USEC(SOURCE_BUFFER_FRAMES);
+        int64_t nowUsec = std::chrono::duration_cast<std::chrono::microseconds>(curTime2.time_since_epoch()).count();
+        //srcIdx is only the position within the buffer.
+        //  Find the total number of frames output by choosing the trip around the buffer that best matches the current estimate.
+        int64_t frame = srcIdx;
+        if (_dmaClock.numSamples()) {
+            int64_t predicted = _dmaClock.xAt(nowUsec);
+            frame += SOURCE_BUFFER_FRAMES * (int64_t)std::floor((predicted - srcIdx)/(double)SOURCE_BUFFER_FRAMES + 0.5);
+            //if timing diff is positive, then more uS have elapsed than frames (the DMA is running slower than estimated)
+            int timeDiff = nowUsec - (int64_t)_dmaClock.yAt(frame);
+            LOGV("Timing diff: %i\n", timeDiff);
+            if (timeDiff > 20 || timeDiff < -20) {
+                LOGW("Warning: Dma timing is off by > 20 uS: %i us\n", timeDiff);
+            }
         }
-        LOGV("Timing diff: %i\n", timeDiff);
-        if (timeDiff > 20) {
-            LOGW("Warning: Dma timing is off by > 20 uS: %i us\n", timeDiff);
+        _dmaClock.addSample(frame, nowUsec);
+        _lastTimeAtFrame0 = usecAtFrame(frame - srcIdx);
+        LOGV("Dma clock error: %f ppm\n", dmaClockErrorPpm());
+    }
+}
+
+int64_t UnwrappedHardwareScheduler::frameAtUsec(int64_t usec) const {
+    if (!_dmaClock.numSamples()) {
+        //not yet synced; assume the nominal rate
+        return USEC_TO_FRAME(usec - _lastTimeAtFrame0);
+    }
+    return _dmaClock.xAt(usec);
+}
+
+int64_t UnwrappedHardwareScheduler::usecAtFrame(int64_t frame) const {
+    if (!_dmaClock.numSamples()) {
+        return _lastTimeAtFrame0 + FRAME_TO_USEC(frame);
+    }
+    return (int64_t)std::floor(_dmaClock.yAt(frame));
+}
+int UnwrappedHardwareScheduler::captureInput(const PrimitiveIoPin &pin) {
+    //the DMA captures every GPIO level already, so the channel is just the pin number.
+    return pin.id() < NUM_GPIO_WORDS*32 ? pin.id() : -1;
+}
+
+bool UnwrappedHardwareScheduler::findCapturedLevel(int channel, IoLevel level, EventClockT::time_point since, EventClockT::time_point &at) const {
+    //convert the times into frame counts (as in queue()).
+    int64_t nowUsec = std::chrono::duration_cast<std::chrono::microseconds>(EventClockT::now().time_since_epoch()).count();
+    int64_t sinceUsec = std::chrono::duration_cast<std::chrono::microseconds>(since.time_since_epoch()).count();
+    //Only trust the frames that the DMA has certainly passed (allowing for the same timing variance as queue()),
+    //  and only those it hasn't yet begun to overwrite on its next trip around the buffer.
+    int64_t lastFrame = frameAtUsec(nowUsec) - MIN_SCHED_AHEAD_FRAME;
+    int64_t firstFrame = std::max<int64_t>(frameAtUsec(sinceUsec), lastFrame - MAX_SCHED_AHEAD_FRAME);
+    //only every INPUT_CAPTURE_FRAME_STRIDE'th frame is captured
+    firstFrame += (INPUT_CAPTURE_FRAME_STRIDE - firstFrame % INPUT_CAPTURE_FRAME_STRIDE) % INPUT_CAPTURE_FRAME_STRIDE;
+    at = since;
+    for (int64_t frame=firstFrame; frame <= lastFrame; frame += INPUT_CAPTURE_FRAME_STRIDE) {
+        int64_t bufferIdx = (frame % SOURCE_BUFFER_FRAMES + SOURCE_BUFFER_FRAMES) % SOURCE_BUFFER_FRAMES;
+        uint32_t levels = captureArr[bufferIdx / INPUT_CAPTURE_FRAME_STRIDE * NUM_GPIO_WORDS + channel/32];
+        at = EventClockT::time_point(std::chrono::microseconds(usecAtFrame(frame)));
+        if ((IoLevel)((levels >> (channel%32)) & 1) == level) {
+            return true;
         }
-        _lastTimeAtFrame0 = curTimeAtFrame0;
-        //if timing diff is positive, then then curTimeAtFrame0 > _lastTimeAtFrame0
-        //curTime2 - srcIdx2 > curTime1 - srcIdx1
-        //curTime2 - curTime2 > srcIdx2 - srcIdx1
-        //more uS have elapsed than frames; DMA cannot keep up
     }
+    return false;
 }
+
 bool UnwrappedHardwareScheduler::onIdleCpu(OnIdleCpuIntervalT interval) {
+    //the scheduler inserts a wide interval once _nextDmaSyncTime has passed
     if (interval == OnIdleCpuIntervalWide) {
-        syncDmaTime();
+        EventClockT::time_point now = EventClockT::now();
+        if (now >= _nextDmaSyncTime) {
+            syncDmaTime();
+            _nextDmaSyncTime = now + std::chrono::microseconds(DMA_SYNC_INTERVAL_USEC);
+        }
     }
     return false;
 }
@@ -641,18 +712,16 @@ void UnwrappedHardwareScheduler::queue(int pin, int mode, uint64_t micros) {
     uint64_t desiredTime = micros - MAX_SCHED_AHEAD_USEC;
     SleepT::sleep_until(std::chrono::time_point<std::chrono::microseconds>(std::chrono::microseconds(desiredTime)));
 
-    int64_t lastUsecAtFrame0 = _lastTimeAtFrame0;
-    int usecFromFrame0 = micros - lastUsecAtFrame0;
-    if (usecFromFrame0 < 0) { //need this check to prevent newIdx from being negative.
-        LOGV("Warning: clearly missed a step (usecFromFrame0=%i)\n", usecFromFrame0);
-        //attempt to recover:
-        EventClockT::time_point realNow = EventClockT::now();
-        micros = std::chrono::duration_cast<std::chrono::microseconds>(realNow.time_since_epoch()).count();
-        micros += MIN_SCHED_AHEAD_USEC; //give ourselves a (128) uS buffer
-        usecFromFrame0 = micros - lastUsecAtFrame0;
+    //account for any drift between the DMA and system clocks, rather than assuming exactly FRAMES_PER_SEC
+    int64_t frame = frameAtUsec(micros);
+    int64_t nowUsec = std::chrono::duration_cast<std::chrono::microseconds>(EventClockT::now().time_since_epoch()).count();
+    int64_t earliestFrame = frameAtUsec(nowUsec) + MIN_SCHED_AHEAD_FRAME;
+    if (frame < earliestFrame) {
+        //the DMA has already passed (or is about to pass) the frame; writing there would delay the event by a whole buffer.
+        LOGV("Warning: clearly missed a step (by %i frames)\n", (int)(earliestFrame - frame));
+        frame = earliestFrame; //attempt to recover
     }
-    int framesFrom0 = USEC_TO_FRAME(usecFromFrame0);
-    int newIdx = framesFrom0%SOURCE_BUFFER_FRAMES;
+    int newIdx = (frame%SOURCE_BUFFER_FRAMES + SOURCE_BUFFER_FRAMES)%SOURCE_BUFFER_FRAMES;
 
     //Now queue the command:
     if (mode == 0) { //turn output off
@@ -725,5 +794,25 @@ void UnwrappedHardwareScheduler::queuePwm(const PrimitiveIoPin &pin, float ratio
     }
 }
 
+void UnwrappedHardwareScheduler::queuePulseTrain(const PrimitiveIoPin &pin, EventClockT::duration onTime, EventClockT::duration period) {
+    //Unlike queuePwm, the pin goes high for exactly onTime (rounded to the nearest frame) at the start of each cycle (used for servos).
+    //The source buffer is divided into a whole number of cycles so that the signal stays periodic when it wraps around,
+    //  so the actual period is that closest to @period which satisfies this.
+    auto pinId = pin.id();
+    int64_t periodFrames = USEC_TO_FRAME(std::chrono::duration_cast<std::chrono::microseconds>(period).count());
+    int64_t numCycles = std::max<int64_t>(1, (SOURCE_BUFFER_FRAMES + periodFrames/2) / std::max<int64_t>(1, periodFrames));
+    int64_t onFrames = (SEC_TO_FRAME(std::chrono::duration_cast<std::chrono::microseconds>(onTime).count()) + 500000) / 1000000;
+    LOGV("queuePulseTrain: %" PRId64 " frames high every %" PRId64 " frames\n", onFrames, (int64_t)(SOURCE_BUFFER_FRAMES / numCycles));
+    for (int64_t cycle=0; cycle < numCycles; ++cycle) {
+        int64_t cycleStart = cycle*SOURCE_BUFFER_FRAMES / numCycles;
+        int64_t cycleEnd = (cycle+1)*SOURCE_BUFFER_FRAMES / numCycles;
+        for (int64_t idx=cycleStart; idx < cycleEnd; ++idx) {
+            bool out = (idx - cycleStart) < onFrames;
+            srcClrArray[idx].writeGpSet(pinId, out);
+            srcClrArray[idx].writeGpClr(pinId, !out);
+        }
+    }
+}
+
 }
 }
@@ -145,6 +145,7 @@
 
 #include "platforms/auto/chronoclock.h" //for EventClockT
 #include "schedulerbase.h" //for OnIdleCpuIntervalT
+#include "common/clockdriftestimator.h"
 
 //config settings:
 //The DMA transaction is paced through the PWM FIFO. The PWM FIFO consumes 1 word every N uS (set in clock settings). 
@@ -190,6 +191,11 @@
 //Can get away with a wider dead-space because we have looser tolerance here.
 #define MAX_SCHED_AHEAD_FRAME (SOURCE_BUFFER_FRAMES - (SOURCE_BUFFER_FRAMES>>6))
 #define MAX_SCHED_AHEAD_USEC (FRAME_TO_USEC(MAX_SCHED_AHEAD_FRAME))
+//The DMA copies the GPIO level registers into a capture ring once every this many frames (see captureInput).
+//  At 4 uS per frame, this gives a resolution of 16 uS.
+#define INPUT_CAPTURE_FRAME_STRIDE 4
+//How often to compare the DMA's progress against the system clock (see syncDmaTime).
+#define DMA_SYNC_INTERVAL_USEC 40000
 
 //forward declare class defined in outputevent.h
 class OutputEvent;
@@ -228,11 +234,17 @@ class UnwrappedHardwareScheduler {
     DmaMem srcClrMem;
     DmaMem srcMem;
     DmaMem cbMem;
+    DmaMem captureMem;
     GpioBufferFrame *srcArray;
     GpioBufferFrame *srcClrArray;
     DmaControlBlock *cbArr;
+    //captured GPIO levels: NUM_GPIO_WORDS words for every INPUT_CAPTURE_FRAME_STRIDE'th frame
+    volatile uint32_t *captureArr;
     int64_t _lastTimeAtFrame0;
+    //relates the number of frames the DMA has output since startup to the system time (in uS), as measured by syncDmaTime
+    ClockDriftEstimator _dmaClock;
     EventClockT::time_point _lastDmaSyncedTime;
+    EventClockT::time_point _nextDmaSyncTime;
     public:
         UnwrappedHardwareScheduler();
         static void cleanup();
@@ -241,7 +253,17 @@ class UnwrappedHardwareScheduler {
         }
         void queue(const OutputEvent &evt);
         void queuePwm(const PrimitiveIoPin &pin, float ratio, EventClockT::duration maxPeriod);
+        void queuePulseTrain(const PrimitiveIoPin &pin, EventClockT::duration onTime, EventClockT::duration period);
+        int captureInput(const PrimitiveIoPin &pin);
+        bool findCapturedLevel(int channel, IoLevel level, EventClockT::time_point since, EventClockT::time_point &at) const;
         bool onIdleCpu(OnIdleCpuIntervalT interval);
+        inline EventClockT::time_point nextIdleCpuDeadline() const {
+            return _nextDmaSyncTime;
+        }
+        //@return how much faster (+) or slower (-) the DMA is outputting frames than FRAMES_PER_SEC, in parts per million
+        inline double dmaClockErrorPpm() const {
+            return -_dmaClock.ppmError();
+        }
     private:
         void makeMaps();
         volatile uint32_t* mapPeripheral(int addr) const; //map a physical address into our virtual address space.
@@ -252,6 +274,9 @@ class UnwrappedHardwareScheduler {
         void initPwm();
         void initDma();
         void syncDmaTime();
+        //convert between system time (in uS) and frames output since startup, using the drift estimate from syncDmaTime
+        int64_t frameAtUsec(int64_t usec) const;
+        int64_t usecAtFrame(int64_t frame) const;
         void queue(int pin, int mode, uint64_t micros);
         void sleepUntilMicros(uint64_t micros) const;
 };
@@ -287,9 +312,29 @@ class HardwareScheduler {
         inline void queuePwm(const PrimitiveIoPin &pin, float ratio, EventClockT::duration maxPeriod) {
             return _sched->queuePwm(pin, ratio, maxPeriod);
         }
+        inline void queuePulseTrain(const PrimitiveIoPin &pin, EventClockT::duration onTime, EventClockT::duration period) {
+            return _sched->queuePulseTrain(pin, onTime, period);
+        }
+        inline double dmaClockErrorPpm() const {
+            return _sched->dmaClockErrorPpm();
+        }
+        //Begin recording the level of @pin, so that drivers can later find when it changed via findCapturedLevel.
+        //@return a channel to pass to findCapturedLevel, or -1 if the pin can't be captured.
+        inline int captureInput(const PrimitiveIoPin &pin) {
+            return _sched->captureInput(pin);
+        }
+        //Find the earliest time at or after @since at which the pin captured on @channel read @level.
+        //@return true and set @at to that time if the level has been captured.
+        //  Otherwise, set @at to the time up to which the captured levels were searched, from which a later search can resume.
+        inline bool findCapturedLevel(int channel, IoLevel level, EventClockT::time_point since, EventClockT::time_point &at) const {
+            return _sched->findCapturedLevel(channel, level, since, at);
+        }
         inline bool onIdleCpu(OnIdleCpuIntervalT interval) {
             return _sched->onIdleCpu(interval);
         }
+        inline EventClockT::time_point nextIdleCpuDeadline() const {
+            return _sched->nextIdleCpuDeadline();
+        }
 };
 
 }
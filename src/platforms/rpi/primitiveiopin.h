@@ -49,6 +49,10 @@ class PrimitiveIoPin {
 		inline bool isNull() const {
 			return pinIdx == mitpi::NULL_GPIO_PIN;
 		}
+		//pulses are generated by the DMA, the same as PWM
+		inline static constexpr bool hasPulseOutput() {
+			return true;
+		}
 		//@pinIdx *logical* index of the pin
 		//@pullUpDown direct this pin to either pull up to 3.3v, down to gnd, or no pull at all.
 		//Note that this pull direction will be applied **even when operating as an output pin**.
@@ -78,6 +82,11 @@ class PrimitiveIoPin {
         inline void makePwmOutput(float duty, EventClockT::duration desiredPeriod) {
         	mitpi::makeOutput(pinIdx);
         	pwmWrite(duty, desiredPeriod);
+        }
+        //configure the pin to go high for @onTime at the start of every @period
+        inline void makePulseOutput(EventClockT::duration onTime, EventClockT::duration period) {
+        	mitpi::makeOutput(pinIdx);
+        	pulseWrite(onTime, period);
         }
 	    //configure the pin to be an input
 	    inline void makeDigitalInput() {
@@ -95,6 +104,10 @@ class PrimitiveIoPin {
         inline void pwmWrite(float duty, EventClockT::duration desiredPeriod) {
         	HardwareScheduler().queuePwm(*this, duty, desiredPeriod);
         }
+        //change the pulse width & period. Must call makePulseOutput beforehand.
+        inline void pulseWrite(EventClockT::duration onTime, EventClockT::duration period) {
+        	HardwareScheduler().queuePulseTrain(*this, onTime, period);
+        }
 };
 
 }
@@ -27,17 +27,17 @@
 
 #include <cassert> //for assert
 #include <array>
+#include <utility> //for std::pair
+#include <cstddef> //for size_t
 #include "outputevent.h"
 #include "common/logging.h"
 #include "common/intervaltimer.h"
+#include "common/allocaudit.h"
 #include "compileflags.h"
 #include "platforms/auto/thisthreadsleep.h" //for SleepT
 #include "platforms/auto/primitiveiopin.h"
 #include "iodrivers/iopin.h"
 
-#if USE_PTHREAD
-    #include <pthread.h> //for pthread_setschedparam
-#endif
 #include "schedulerbase.h"
 
 
@@ -50,6 +50,7 @@
  */
 template <typename Interface> class Scheduler : public SchedulerBase {
     EventClockT::duration MAX_SLEEP; //need to call onIdleCpu handlers every so often, even if no events are ready.
+    EventClockT::duration MAX_WIDE_INTERVAL_SPACING; //com tending happens on wide intervals, so insert one at least this often.
     Interface interface;
     OutputEvent nextEvent;
     bool _doExit;
@@ -61,6 +62,9 @@ template <typename Interface> class Scheduler : public SchedulerBase {
         inline void setDefaultMaxSleep() {
             setMaxSleep(std::chrono::milliseconds(40));
         }
+        template <typename T> void setMaxWideIntervalSpacing(T duration) {
+            MAX_WIDE_INTERVAL_SPACING = std::chrono::duration_cast<EventClockT::duration>(duration);
+        }
         Scheduler(Interface interface);
         void initSchedThread() const; //call this from whatever threads call nextEvent to optimize that thread's priority.
         bool isRoomInBuffer() const;
@@ -74,6 +78,7 @@ template <typename Interface> class Scheduler : public SchedulerBase {
 template <typename Interface> Scheduler<Interface>::Scheduler(Interface interface) 
     : interface(interface), _doExit(false) {
     setDefaultMaxSleep();
+    setMaxWideIntervalSpacing(std::chrono::milliseconds(2));
 }
 
 
@@ -82,15 +87,18 @@ template <typename Interface> void Scheduler<Interface>::queue(const OutputEvent
 }
 
 template <typename Interface> void Scheduler<Interface>::initSchedThread() const {
-    #if USE_PTHREAD
-        struct sched_param sp; 
-        sp.sched_priority=SCHED_PRIORITY; 
-        if (int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp)) {
-            LOGW("Warning: pthread_setschedparam (increase thread priority) at scheduler.cpp returned non-zero: %i\n", ret);
-        } else {
+    //set priority & cpu affinity as configured via SchedulerBase, and report the result.
+    //The event loop is re-entered during homing, but reporting allocates (see logRealtimeConfig),
+    //  and the config can't have changed since, so only the first call reports it.
+    static bool hasLoggedConfig = false;
+    bool isApplied = applyRealtimeConfig();
+    if (!hasLoggedConfig) {
+        if (isApplied) {
             LOG("Set pthread sched_priority\n");
         }
-    #endif
+        logRealtimeConfig();
+        hasLoggedConfig = true;
+    }
 }
 
 template <typename Interface> bool Scheduler<Interface>::isRoomInBuffer() const {
@@ -100,7 +108,11 @@ template <typename Interface> bool Scheduler<Interface>::isRoomInBuffer() const
 
 template <typename Interface> void Scheduler<Interface>::eventLoop() {
     OnIdleCpuIntervalT intervalT = OnIdleCpuIntervalWide;
-    int numShortIntervals = 0; //need to track the number of short cpu intervals, because if we just execute short intervals constantly for, say, 1 second, then certain services that only run at long intervals won't occur. So make every, say, 10000th short interval transform into a wide interval.
+    //if we just execute short intervals constantly for, say, 1 second, then certain services that only run at wide intervals won't occur.
+    //So a short interval is transformed into a wide one when any periodic work falls due, or once MAX_WIDE_INTERVAL_SPACING has passed.
+    EventClockT::time_point nextWideInterval = EventClockT::now();
+    //the loop shouldn't touch the heap; when built with ALLOC_AUDIT=1, any allocations made until we exit are recorded.
+    allocaudit::Scope allocAuditScope;
     while (!_doExit) {
         if (!nextEvent.isNull() && isEventTime(nextEvent)) {
             //queue the pending event and reset it
@@ -119,10 +131,14 @@ template <typename Interface> void Scheduler<Interface>::eventLoop() {
             this->sleepUntilEvent(this->nextEvent);
             //We just slept for a while, which translates to a wide interval. Note that it may not actually be the event time yet.
             intervalT = OnIdleCpuIntervalWide;
-            //numShortIntervals = 0;
         } else {
-            //after 2048 (just a nice binary number) short intervals, insert a wide interval instead (this won't force a sleep).
-            intervalT = (++numShortIntervals % 2048) ? OnIdleCpuIntervalShort : OnIdleCpuIntervalWide;
+            //insert a wide interval when one is due (this won't force a sleep).
+            EventClockT::time_point now = EventClockT::now();
+            bool isWideDue = now >= nextWideInterval || now >= interface.nextIdleCpuDeadline();
+            intervalT = isWideDue ? OnIdleCpuIntervalWide : OnIdleCpuIntervalShort;
+        }
+        if (intervalT == OnIdleCpuIntervalWide) {
+            nextWideInterval = EventClockT::now() + MAX_WIDE_INTERVAL_SPACING;
         }
     }
     LOGV("Scheduler::eventLoop is exiting\n");
@@ -143,7 +159,14 @@ template <typename Interface> void Scheduler<Interface>::sleepUntilEvent(const O
             sleepUntil = evtTime;
         }
     }
-    SleepT::sleep_until(sleepUntil);
+    //wake when any periodic onIdleCpu work falls due
+    auto deadline = interface.nextIdleCpuDeadline();
+    if (deadline < sleepUntil) {
+        sleepUntil = deadline;
+    }
+    //wake as soon as a host sends data, rather than leaving it unserviced for up to MAX_SLEEP
+    std::pair<struct pollfd*, std::size_t> wakeFds = interface.getWakeFds();
+    SleepT::poll_until(sleepUntil, wakeFds.first, wakeFds.second);
 }
 
 template <typename Interface> bool Scheduler<Interface>::isEventTime(const OutputEvent &evt) const {
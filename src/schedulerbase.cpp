@@ -22,15 +22,33 @@
  */
 
 #include "schedulerbase.h"
+#include "compileflags.h" //for USE_PTHREAD
 
 #include <signal.h> //for sigaction signal handlers
 #include <cstdlib> //for atexit
 #include <stdexcept> //for runtime_error
+#include <string>
+#include <cstring> //for strerror
+#include <cerrno>
+#include <sched.h> //for sched_setaffinity, cpu_set_t
+#include <unistd.h> //for sysconf
+#include <dirent.h> //for opendir (enumerating threads)
+#include <alloca.h>
+#include <sys/resource.h> //for getrlimit
+#ifdef __GLIBC__
+    #include <malloc.h> //for mallopt
+#endif
+#if USE_PTHREAD
+    #include <pthread.h> //for pthread_setschedparam
+#endif
 #include "common/logging.h"
+#include "catch.hpp"
 
 //initialize static variables:
 std::array<std::vector<void(*)()>, SCHED_NUM_EXIT_HANDLER_LEVELS> SchedulerBase::exitHandlers;
 bool SchedulerBase::isExiting(false);
+int SchedulerBase::schedPriority(SCHED_PRIORITY);
+int SchedulerBase::schedCpu(-1);
 
 static void ctrlCOrZHandler(int s){
    printf("Caught signal %d\n",s);
@@ -84,3 +102,230 @@ bool SchedulerBase::registerExitHandler(void (*handler)(), unsigned level) {
     return 0; //ok
 }
 
+void SchedulerBase::setSchedPriority(int priority) {
+    if (priority < sched_get_priority_min(SCHED_FIFO) || priority > sched_get_priority_max(SCHED_FIFO)) {
+        throw std::runtime_error("Invalid real-time priority: " + std::to_string(priority));
+    }
+    schedPriority = priority;
+}
+int SchedulerBase::getSchedPriority() {
+    return schedPriority;
+}
+void SchedulerBase::setSchedCpu(int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        throw std::runtime_error("Invalid cpu: " + std::to_string(cpu));
+    }
+    schedCpu = cpu;
+}
+int SchedulerBase::getSchedCpu() {
+    return schedCpu;
+}
+
+bool SchedulerBase::applyRealtimeConfig() {
+    bool success = true;
+    #if USE_PTHREAD
+        struct sched_param sp; 
+        sp.sched_priority=schedPriority; 
+        if (int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp)) {
+            LOGW("Warning: pthread_setschedparam (increase thread priority) at schedulerbase.cpp returned non-zero: %i\n", ret);
+            success = false;
+        }
+    #endif
+    if (schedCpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(schedCpu, &cpus);
+        //pid 0 = calling thread
+        if (sched_setaffinity(0, sizeof(cpus), &cpus)) {
+            LOGW("Warning: unable to pin the event loop to cpu %i: %s\n", schedCpu, strerror(errno));
+            success = false;
+        }
+    }
+    return success;
+}
+
+bool SchedulerBase::pinAllThreads(const std::vector<int> &cpus) {
+    if (cpus.empty()) {
+        LOGW("Warning: no cpus given for the remaining threads; not changing their affinity\n");
+        return false;
+    }
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &cpuSet);
+    }
+    //each thread of the process is listed as a directory named by its thread id
+    DIR *tasks = opendir("/proc/self/task");
+    if (!tasks) {
+        LOGW("Warning: unable to enumerate threads in /proc/self/task: %s\n", strerror(errno));
+        return false;
+    }
+    bool success = true;
+    while (struct dirent *entry = readdir(tasks)) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue; //skip . and ..
+        }
+        pid_t tid = atoi(entry->d_name);
+        if (sched_setaffinity(tid, sizeof(cpuSet), &cpuSet)) {
+            LOGW("Warning: unable to set cpu affinity of thread %i: %s\n", tid, strerror(errno));
+            success = false;
+        }
+    }
+    closedir(tasks);
+    return success;
+}
+
+std::vector<int> SchedulerBase::cpusExcept(int excluded) {
+    std::vector<int> cpus;
+    long numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int cpu=0; cpu<numCpus; ++cpu) {
+        if (cpu != excluded) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+std::vector<int> SchedulerBase::parseCpuList(const char *list) {
+    std::vector<int> cpus;
+    const char *cur = list;
+    while (*cur) {
+        char *end;
+        long first = strtol(cur, &end, 10);
+        long last = first;
+        if (end == cur) {
+            throw std::runtime_error(std::string("Malformed cpu list: ") + list);
+        }
+        if (*end == '-') {
+            cur = end+1;
+            last = strtol(cur, &end, 10);
+            if (end == cur) {
+                throw std::runtime_error(std::string("Malformed cpu list: ") + list);
+            }
+        }
+        if (first < 0 || last < first || last >= CPU_SETSIZE) {
+            throw std::runtime_error(std::string("Invalid cpu range in cpu list: ") + list);
+        }
+        for (long cpu=first; cpu<=last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+        if (*end == ',') {
+            ++end;
+        } else if (*end) {
+            throw std::runtime_error(std::string("Malformed cpu list: ") + list);
+        }
+        cur = end;
+    }
+    return cpus;
+}
+
+//parse @arg, the value of the command line @option, as a size in KiB no larger than @maxKiB
+static std::size_t parseKiB(const char *arg, const char *option, std::size_t maxKiB) {
+    char *end;
+    errno = 0;
+    long kib = strtol(arg, &end, 10);
+    if (end == arg || *end || errno == ERANGE || kib < 0 || (unsigned long)kib > maxKiB) {
+        LOGE("Invalid %s: '%s' (expected 0-%zu KiB)\n", option, arg, maxKiB);
+        throw std::runtime_error(std::string("Invalid ") + option + ": " + arg);
+    }
+    return kib;
+}
+
+std::size_t SchedulerBase::parsePrefaultStackKiB(const char *arg) {
+    //the stack is prefaulted via alloca, which would overflow (rather than fail) if it reached the limit
+    rlim_t limit = 8*1024*1024; //the usual default, if the stack is unlimited or the limit is unknown
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_STACK, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY) {
+        limit = rl.rlim_cur;
+    }
+    return parseKiB(arg, "--prefault-stack", limit/2/1024);
+}
+
+std::size_t SchedulerBase::parsePrefaultHeapKiB(const char *arg) {
+    std::size_t physKiB = (std::size_t)sysconf(_SC_PHYS_PAGES) * (sysconf(_SC_PAGESIZE)/1024);
+    return parseKiB(arg, "--prefault-heap", physKiB);
+}
+
+//must not be inlined, or else the stack space wouldn't be released upon return
+static void __attribute__ ((noinline)) prefaultStack(std::size_t stackBytes, std::size_t pageSize) {
+    volatile char *stack = (volatile char*)alloca(stackBytes);
+    for (std::size_t i=0; i<stackBytes; i += pageSize) {
+        stack[i] = 0;
+    }
+}
+
+void SchedulerBase::prefaultMemory(std::size_t stackBytes, std::size_t heapBytes) {
+    std::size_t pageSize = sysconf(_SC_PAGESIZE);
+    if (heapBytes) {
+        #ifdef __GLIBC__
+            //Keep freed memory within the process rather than returning it to the OS,
+            //  and don't service large allocations with a fresh (not yet faulted) mmap.
+            mallopt(M_TRIM_THRESHOLD, -1);
+            mallopt(M_MMAP_MAX, 0);
+        #endif
+        volatile char *heap = (volatile char*)malloc(heapBytes);
+        if (heap) {
+            for (std::size_t i=0; i<heapBytes; i += pageSize) {
+                heap[i] = 0;
+            }
+            free((void*)heap);
+        } else {
+            LOGW("Warning: unable to allocate %zu bytes to prefault the heap\n", heapBytes);
+        }
+    }
+    if (stackBytes) {
+        prefaultStack(stackBytes, pageSize);
+    }
+    LOG("Prefaulted %zu KiB of stack and %zu KiB of heap\n", stackBytes/1024, heapBytes/1024);
+}
+
+void SchedulerBase::logRealtimeConfig() {
+    int policy = sched_getscheduler(0);
+    struct sched_param sp;
+    sched_getparam(0, &sp);
+    const char *policyStr = policy == SCHED_FIFO ? "SCHED_FIFO" : policy == SCHED_RR ? "SCHED_RR" : "SCHED_OTHER";
+    //format the affinity as a list of cpus
+    char cpuStr[128] = "";
+    std::size_t cpuStrLen = 0;
+    cpu_set_t cpus;
+    if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0) {
+        for (int cpu=0; cpu<CPU_SETSIZE && cpuStrLen < sizeof(cpuStr); ++cpu) {
+            if (CPU_ISSET(cpu, &cpus)) {
+                cpuStrLen += snprintf(cpuStr+cpuStrLen, sizeof(cpuStr)-cpuStrLen, cpuStrLen ? ",%i" : "%i", cpu);
+            }
+        }
+    }
+    //VmLck in /proc/self/status reports how much memory is locked by mlockall
+    long lockedKb = 0;
+    if (FILE *status = fopen("/proc/self/status", "r")) {
+        char line[128];
+        while (fgets(line, sizeof(line), status)) {
+            if (sscanf(line, "VmLck: %ld", &lockedKb) == 1) {
+                break;
+            }
+        }
+        fclose(status);
+    }
+    LOG("Real-time config: policy %s, priority %i, cpus %s, %ld KiB of memory locked\n", policyStr, sp.sched_priority, cpuStr, lockedKb);
+}
+
+TEST_CASE("Cpu lists are parsed correctly", "[schedulerbase]") {
+    REQUIRE(SchedulerBase::parseCpuList("3") == std::vector<int>({3}));
+    REQUIRE(SchedulerBase::parseCpuList("0-2,5") == std::vector<int>({0, 1, 2, 5}));
+    REQUIRE(SchedulerBase::parseCpuList("1,3-4") == std::vector<int>({1, 3, 4}));
+    REQUIRE_THROWS(SchedulerBase::parseCpuList("1,,2"));
+    REQUIRE_THROWS(SchedulerBase::parseCpuList("2-1"));
+    REQUIRE_THROWS(SchedulerBase::parseCpuList("a"));
+}
+
+TEST_CASE("Prefault sizes are validated", "[schedulerbase]") {
+    REQUIRE(SchedulerBase::parsePrefaultStackKiB("256") == 256);
+    REQUIRE(SchedulerBase::parsePrefaultHeapKiB("0") == 0);
+    REQUIRE_THROWS(SchedulerBase::parsePrefaultStackKiB("-1"));
+    REQUIRE_THROWS(SchedulerBase::parsePrefaultHeapKiB("-4096"));
+    REQUIRE_THROWS(SchedulerBase::parsePrefaultStackKiB("12k"));
+    REQUIRE_THROWS(SchedulerBase::parsePrefaultHeapKiB(""));
+    //anywhere near the stack limit would overflow the stack
+    REQUIRE_THROWS(SchedulerBase::parsePrefaultStackKiB("1000000000"));
+    REQUIRE_THROWS(SchedulerBase::parsePrefaultHeapKiB("99999999999999999999"));
+}
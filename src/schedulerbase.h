@@ -26,6 +26,7 @@
 
 #include <array>
 #include <vector>
+#include <cstddef> //for size_t
 
 
 #ifndef SCHED_PRIORITY
@@ -47,18 +48,53 @@ enum OnIdleCpuIntervalT {
 
 /*
  * SchedulerBase allows any file to insert exit handlers, without adding the entire Scheduler as a dependency.
+ * It also holds the real-time configuration (priority, CPU affinity) applied to whichever thread runs the event loop,
+ *   as well as utilities to keep the remaining threads off of that CPU and to prefault memory before printing.
  */
 class SchedulerBase {
     //for the exitHandlers, we could use a set, but a vector is even less likely to fail,
     //  and the exitHandlers are called in the case of an extreme error (eg segfault; corrupted data)
     static std::array<std::vector<void(*)()>, SCHED_NUM_EXIT_HANDLER_LEVELS> exitHandlers;
     static bool isExiting;
+    //SCHED_FIFO priority & CPU (or -1 for no pinning) given to the event loop thread in Scheduler::initSchedThread
+    static int schedPriority;
+    static int schedCpu;
     private:
         static void callExitHandlers();
     public:
         static void configureExitHandlers();
         //need to return a value so we can do tricks like `static bool _wasInit=registerExitHandler(...)` to do something just once
         static bool registerExitHandler(void (*handler)(), unsigned level);
+
+        //set the SCHED_FIFO priority (1-99) of the event loop thread. Defaults to SCHED_PRIORITY.
+        static void setSchedPriority(int priority);
+        static int getSchedPriority();
+        //pin the event loop thread to the given CPU. By default, it may run on any CPU (getSchedCpu() returns -1).
+        //Throws std::runtime_error if @cpu isn't a valid CPU number.
+        static void setSchedCpu(int cpu);
+        static int getSchedCpu();
+        //Apply the above settings to the calling thread (called by Scheduler::initSchedThread).
+        //returns true on success.
+        static bool applyRealtimeConfig();
+        //Restrict every thread that currently exists in the process to @cpus.
+        //Threads created afterwards inherit the affinity of the thread that creates them.
+        //returns true on success.
+        static bool pinAllThreads(const std::vector<int> &cpus);
+        //all online CPUs except for @excluded
+        static std::vector<int> cpusExcept(int excluded);
+        //Parse a CPU list such as "0-2,5" into its individual CPU numbers. Throws std::runtime_error if malformed.
+        static std::vector<int> parseCpuList(const char *list);
+        //Parse the number of KiB of stack/heap to prefault (as given to --prefault-stack / --prefault-heap).
+        //Throws std::runtime_error (after logging the rejected value) if it isn't a non-negative number,
+        //  or if it's too large: the stack prefault must stay well below RLIMIT_STACK, and the heap prefault within physical memory.
+        static std::size_t parsePrefaultStackKiB(const char *arg);
+        static std::size_t parsePrefaultHeapKiB(const char *arg);
+        //Touch @stackBytes of the calling thread's stack and @heapBytes of heap, so that the pages are already mapped
+        //  (and, combined with mlockall, locked) before they're needed. The heap memory is freed but retained by the allocator.
+        static void prefaultMemory(std::size_t stackBytes, std::size_t heapBytes);
+        //log the effective scheduling policy, priority and CPU affinity of the calling thread.
+        //Note: this reads /proc and allocates, so it mustn't be called once the event loop is running.
+        static void logRealtimeConfig();
 };
 
 #endif
@@ -26,10 +26,15 @@
 #include <iostream>
 #include <fstream> //for ifstream, ofstream
 #include <string>
+#include <thread>
+#include <fcntl.h> //for O_RDONLY
+#include <sys/mman.h> //for shm_open, mmap
+#include <unistd.h> //for close
 
 #include "compileflags.h"
 #include "platforms/auto/thisthreadsleep.h"
 #include "common/logging.h"
+#include "common/allocaudit.h"
 #include "testhelper.h"
 
 //MACHINE_PATH is calculated in the Makefile and then passed as a define through the make system (ie gcc -DMACHINEPATH='"path"')
@@ -169,6 +174,17 @@ SCENARIO("State will respond correctly to gcode commands", "[state]") {
             helper.sendCommand("M119", "ok");
             //"then the machine shouldn't crash"
         }
+        WHEN("The M881 command is sent after another command") {
+            helper.sendCommand("M105", "ok");
+            //the M105 has been replied to, so its latencies are known (but not yet those of the M881 itself)
+            helper.sendCommand("M881", "ok queue:1/");
+            AND_WHEN("The M881 command asks for the histogram of a single stage") {
+                helper.sendCommand("M881 P1 S1", "ok exec ");
+                THEN("S1 should clear the histograms, so that only that M881 has since been traced") {
+                    helper.sendCommand("M881", "ok queue:1/");
+                }
+            }
+        }
         WHEN("The M280 command is sent with servo index=0") {
             helper.sendCommand("M280 P0 S40.5", "ok");
             //"then the machine shouldn't crash"
@@ -180,4 +196,160 @@ SCENARIO("State will respond correctly to gcode commands", "[state]") {
         //Teardown code:
         // (Helper destructor)
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("State publishes its position, heaters and line number", "[state][statuspublisher]") {
+    TestHelper<machines::MACHINE> helper(machines::MACHINE(), TESTHELPER_NO_PERSISTENT_ROOT_COM);
+    helper.getState().publishStatus("/printipi-status-state-test", std::chrono::milliseconds(1));
+    //map the segment as a reader would
+    int fd = shm_open("/printipi-status-state-test", O_RDONLY, 0);
+    REQUIRE(fd != -1);
+    void *mem = mmap(nullptr, sizeof(struct printipi_status), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    REQUIRE(mem != MAP_FAILED);
+    const struct printipi_status *shared = static_cast<const struct printipi_status*>(mem);
+
+    helper.threadedEventLoop();
+    helper.sendCommand("M110 N0", "ok");
+    helper.sendCommand("N1 G28", "ok");
+    helper.sendCommand("N2 M104 S200", "ok");
+    helper.sendCommand("N3 G1 X30 Y-10 Z15", "ok");
+    //the status is published periodically, so wait for an update that reflects the finished move
+    struct printipi_status status;
+    auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    auto isUpToDate = [&]() {
+        return printipi_status_read(shared, &status, 1000) == 0 && !status.is_moving && status.line_number == 3
+            && Vector3f(status.position[0], status.position[1], status.position[2]).distance(30, -10, 15) <= 4;
+    };
+    while (!isUpToDate() && std::chrono::steady_clock::now() < timeout) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    REQUIRE(isUpToDate());
+    REQUIRE(status.is_homed);
+    REQUIRE(status.num_axes == helper.getState().motionPlanner().axisPositions().size());
+    REQUIRE(status.num_heaters == 1);
+    REQUIRE(status.heaters[0].type == PRINTIPI_STATUS_HEATER_HOTEND);
+    REQUIRE(status.heaters[0].target_c == 200);
+    REQUIRE(status.num_com_channels == 1);
+    munmap(mem, sizeof(struct printipi_status));
+}
+
+//gives a MotionPlanner direct access to the machine, as State's MotionInterface does
+struct MachineMotionInterface {
+    typedef decltype(machines::MACHINE().getCoordMap()) CoordMapT;
+    typedef decltype(machines::MACHINE().getAccelerationProfile()) AccelerationProfileT;
+    machines::MACHINE machine;
+    CoordMapT getCoordMap() const {
+        return machine.getCoordMap();
+    }
+    AccelerationProfileT getAccelerationProfile() const {
+        return machine.getAccelerationProfile();
+    }
+};
+
+TEST_CASE("Parallel step generation outputs the same events as serial generation", "[state][motionplanner]") {
+    typedef MachineMotionInterface Interface;
+    motion::MotionPlanner<Interface> serial((Interface())), parallel((Interface()));
+    parallel.setParallelStepGeneration(true);
+    EventClockT::time_point start = EventClockT::now();
+    //an arc, to exercise more than one axis
+    serial.arcTo(start, Vector4f(10, 10, 5, 3), Vector3f(0, 10, 0), 60, -1000, 1000, true);
+    parallel.arcTo(start, Vector4f(10, 10, 5, 3), Vector3f(0, 10, 0), 60, -1000, 1000, true);
+    std::size_t numEvents = 0, numMismatches = 0;
+    while (!serial.peekNextEvent().isNull() || !parallel.peekNextEvent().isNull()) {
+        OutputEvent a = serial.peekNextEvent(), b = parallel.peekNextEvent();
+        if (a.isNull() || b.isNull() || a.time() != b.time() || a.state() != b.state() 
+          || a.primitiveIoPin().id() != b.primitiveIoPin().id()) {
+            ++numMismatches;
+        }
+        serial.consumeNextEvent();
+        parallel.consumeNextEvent();
+        ++numEvents;
+    }
+    REQUIRE(numEvents > 0);
+    REQUIRE(numMismatches == 0);
+    REQUIRE(serial.axisPositions() == parallel.axisPositions());
+}
+
+TEST_CASE("A series of moves shorter than a step reaches the commanded position", "[state][motionplanner]") {
+    typedef MachineMotionInterface Interface;
+    motion::MotionPlanner<Interface> planner((Interface()));
+    //each move is about half a step in x and two thirds of a step in y
+    const Vector4f increment(0.01, 0.013, 0, 0);
+    const int numMoves = 1000;
+    for (int i=1; i<=numMoves; ++i) {
+        planner.moveTo(EventClockT::now(), increment*i, 60, -1000, 1000, motion::NO_LEVELING | motion::NO_BOUNDING);
+        while (!planner.peekNextEvent().isNull()) {
+            planner.consumeNextEvent();
+        }
+    }
+    //the axes must end within about a step (0.02 mm) of the commanded position, rather than falling further behind with every move
+    Vector4f commanded = increment*numMoves;
+    REQUIRE(planner.actualCartesianPosition().xyz().distance(commanded.xyz()) <= 0.03);
+}
+
+//Hidden; run with --do-tests "[benchmark]".
+//Reports how long the event loop spends consuming the events of a series of arcs with serial and parallel step generation,
+//  including the longest single step, which is what bounds the event loop's latency.
+TEST_CASE("Benchmark serial vs parallel step generation", "[.][benchmark][motionplanner]") {
+    typedef MachineMotionInterface Interface;
+    for (bool isParallel : { false, true }) {
+        motion::MotionPlanner<Interface> planner((Interface()));
+        planner.setParallelStepGeneration(isParallel);
+        std::size_t numEvents = 0;
+        EventClockT::duration total(0), longest(0);
+        for (int arc=0; arc<20; ++arc) {
+            Vector4f start = planner.actualCartesianPosition();
+            Vector4f dest = start + Vector4f(arc % 2 ? -10 : 10, 10, 0.2, 3);
+            planner.arcTo(EventClockT::now(), dest, (start + dest).xyz() * 0.5f, 60, -1000, 1000, arc % 2);
+            while (true) {
+                EventClockT::time_point before = EventClockT::now();
+                bool isDone = planner.peekNextEvent().isNull();
+                if (!isDone) {
+                    planner.consumeNextEvent();
+                }
+                EventClockT::duration elapsed = EventClockT::now() - before;
+                total += elapsed;
+                longest = std::max(longest, elapsed);
+                if (isDone) {
+                    break;
+                }
+                ++numEvents;
+            }
+        }
+        LOG("%s step generation: %zu events in %" PRId64 " us (%.3f us/event), longest step %" PRId64 " us, %zu steps generated inline\n",
+            isParallel ? "parallel" : "serial", numEvents,
+            (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(total).count(),
+            std::chrono::duration<float, std::micro>(total).count() / numEvents,
+            (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(longest).count(), planner.numInlineSteps());
+        REQUIRE(numEvents > 0);
+    }
+}
+
+#if ALLOC_AUDIT
+TEST_CASE("The event loop doesn't allocate while printing a file of G1 moves", "[state][allocaudit]") {
+    std::ofstream gfile("test-printipi-allocaudit.gcode", std::fstream::out | std::fstream::trunc);
+    gfile << "G28\n";
+    for (int i=0; i<20; ++i) {
+        gfile << "G1 X" << (i%2 ? 30 : -30) << " Y" << (i%3)*10-10 << " Z" << 5+i << " E" << i << "\n";
+    }
+    gfile << "G1 X-30 Y20 Z5\n";
+    //exit the event loop once the last move completes
+    gfile << "M0\n" << std::flush;
+    gfile.close();
+
+    FileSystem fs("./");
+    State<machines::MACHINE> state(machines::MACHINE(), fs, false);
+    state.addComChannel(gparse::Com("test-printipi-allocaudit.gcode", nullptr, true));
+    //run on a separate thread, as the event loop elevates the priority of whichever thread runs it
+    std::thread eventThread([&]() {
+        state.eventLoop();
+    });
+    eventThread.join();
+    remove("test-printipi-allocaudit.gcode");
+
+    REQUIRE(allocaudit::numAllocations() == 0);
+    Vector4f actualPos = state.motionPlanner().actualCartesianPosition();
+    REQUIRE(actualPos.xyz().distance(-30, 20, 5) <= 4);
+}
+#endif
@@ -38,6 +38,11 @@
 #include <cmath> //for isnan
 #include <utility> //for std::declval
 #include <vector>
+#include <array>
+#include <algorithm> //for std::min
+#include <sstream> //for ostringstream
+#include <memory> //for unique_ptr
+#include <poll.h> //for poll
 #include "common/logging.h"
 #include "gparse/command.h"
 #include "gparse/com.h"
@@ -56,6 +61,8 @@
 #include "outputevent.h"
 #include "common/vector4.h"
 #include "common/optionalarg.h"
+#include "common/statuspublisher.h"
+#include "common/latencytracer.h"
 
 //g-code coordinates can either be interpreted as absolute or relative to the last coordinates received
 enum PositionMode {
@@ -109,6 +116,15 @@ template <typename Drv> class State {
                 //if an event is to occur at evtTime, then return the soonest that we are capable of scheduling it in hardware (we may have limited buffers, etc).
                 return _hardwareScheduler.schedTime(evtTime);
             }
+            EventClockT::time_point nextIdleCpuDeadline() const {
+                //the earliest time at which the hardware scheduler or an IODriver has periodic work due in onIdleCpu.
+                return std::min(_hardwareScheduler.nextIdleCpuDeadline(), _state.ioDrivers.nextIdleCpuDeadline());
+            }
+            std::pair<struct pollfd*, std::size_t> getWakeFds() const {
+                //the scheduler's sleep should end as soon as a host sends data on any com channel being read from.
+                _state.gatherComPollFds();
+                return std::make_pair(_state._comPollFds.data(), _state._numComPollFds);
+            }
     };
     //The MotionPlanner needs certain information about the physical machine, so we provide that without exposing all of Drv:
     class MotionInterface {
@@ -184,11 +200,36 @@ template <typename Drv> class State {
     //so we store Com channels in a vector & include a flag that tells us whether the root one should act as a special always-active host com
     bool _isRootComPersistent;
     std::vector<gparse::Com> gcodeFileStack;
+    //The com channels being read from (root & top of the stack) are polled for input with a single poll() call,
+    //  and only those with input are tended. The same descriptors are given to the scheduler, so that it stops sleeping when a host sends data.
+    struct ComPollRange {
+        //the channel's descriptors are _comPollFds[first, first+count)
+        std::size_t first, count;
+        //false if the channel's descriptors didn't all fit, in which case it can't be waited upon
+        bool isComplete;
+        ComPollRange() : first(0), count(0), isComplete(true) {}
+    };
+    std::array<struct pollfd, 32> _comPollFds;
+    std::size_t _numComPollFds;
+    ComPollRange _rootComPollRange, _topComPollRange;
     SchedType scheduler;
     motion::MotionPlanner<MotionInterface> _motionPlanner;
     Drv driver;
     FileSystem filesystem;
     IODriverTypes ioDrivers;
+    //optional shared memory snapshot of the machine status, for monitoring without going through the com channels
+    std::unique_ptr<StatusPublisher> _statusPublisher;
+    EventClockT::duration _statusInterval;
+    EventClockT::time_point _nextStatusTime;
+    //time spent by commands between being received and moving the motors (reported by M881)
+    LatencyTracer _latencyTracer;
+    //timestamps of the command being executed (nullptr if none), so that queueMovement can record when its move is planned
+    CommandTimestamps *_executingTimestamps;
+    //the last move command to be replied to is traced once its first step is queued
+    bool _isAwaitingFirstStep;
+    CommandTimestamps _awaitingFirstStep;
+    char _awaitingFirstStepOpcode[5];
+    int32_t _awaitingFirstStepLine;
     public:
         //Initialize the state:
         //@drv Machine instance to take ownership of
@@ -213,6 +254,22 @@ template <typename Drv> class State {
         void addComChannel(gparse::Com &&ch) {
             gcodeFileStack.push_back(std::move(ch));
         }
+        //generate each axis' steps on its own thread (see MotionPlanner::setParallelStepGeneration). Must be called before eventLoop().
+        void setParallelStepGeneration(bool enable) {
+            _motionPlanner.setParallelStepGeneration(enable);
+        }
+        //publish the machine status to the POSIX shared memory object @shmName (e.g. "/printipi-status") every @interval.
+        //  See common/statussnapshot.h for the layout, and util/printipi-status.c for a reader.
+        //throws std::runtime_error if the shared memory cannot be created.
+        void publishStatus(const std::string &shmName, EventClockT::duration interval) {
+            _statusPublisher.reset(new StatusPublisher(shmName));
+            _statusInterval = interval;
+            _nextStatusTime = EventClockT::now();
+        }
+        //additionally write the latencies of every command to @path (see LatencyTracer::openTraceFile)
+        void traceLatencies(const std::string &path) {
+            _latencyTracer.openTraceFile(path);
+        }
     private:
         void setMoveBuffering(bool doBufferMoves);
         /* Control interpretation of positions from the host as relative or absolute */
@@ -242,6 +299,13 @@ template <typename Drv> class State {
         /* Reads inputs of any IODrivers, and possible does something with the value (eg feedback loop between thermistor and hotend PWM control */
         bool onIdleCpu(OnIdleCpuIntervalT interval);
         void tendComChannel(gparse::Com &com);
+        //fill _comPollFds with the descriptors of the channels that are read from (doesn't poll them)
+        void gatherComPollFds();
+        ComPollRange addComPollFds(const gparse::Com &com);
+        //true if @com (whose descriptors are at @range) has input, according to the last poll of _comPollFds
+        bool isComReady(gparse::Com &com, const ComPollRange &range);
+        //write out any replies buffered by the com channels
+        void flushComChannels();
         /* execute the GCode on a Driver object that supports a well-defined interface.
          * returns a Command to send back to the host. */
         template <typename ReplyFunc> void execute(gparse::Command const& cmd, ReplyFunc replyFunc);
@@ -254,6 +318,12 @@ template <typename Drv> class State {
         //Check if M109 (set temperature and wait until reached) has been satisfied.
         bool areHeatersReady();
         std::string getEndstopStatusString();
+        //copy the current machine status into _statusPublisher's snapshot
+        void updateStatus();
+        //pass a command that has been replied to on to the _latencyTracer (or wait for its first step, if it's a move)
+        void traceCommand(const gparse::Command &cmd, const CommandTimestamps &stamps);
+        //record the first step of the move awaiting one
+        void traceFirstStep();
 };
 
 
@@ -270,11 +340,14 @@ template <typename Drv> State<Drv>::State(Drv &&drv, const FileSystem &fs, bool
     _isWaitingForHotend(false),
     _lastMotionPlannedTime(std::chrono::seconds(0)), 
     _isRootComPersistent(needPersistentCom),
+    _numComPollFds(0),
     scheduler(SchedInterface(*this)),
     _motionPlanner(MotionInterface(*this)),
     driver(std::move(drv)),
     filesystem(fs),
-    ioDrivers(std::tuple_cat(_motionPlanner.coordMap().getDependentIoDrivers(), drv.getIoDrivers()))
+    ioDrivers(std::tuple_cat(_motionPlanner.coordMap().getDependentIoDrivers(), drv.getIoDrivers())),
+    _executingTimestamps(nullptr),
+    _isAwaitingFirstStep(false)
     {
     this->setDestMoveRatePrimitive(this->driver.defaultMoveRate());
 }
@@ -379,6 +452,9 @@ template <typename Drv> bool State<Drv>::onIdleCpu(OnIdleCpuIntervalT interval)
             if (!motionEvt.isNull()) {
                 _motionPlanner.consumeNextEvent();
                 this->scheduler.queue(motionEvt);
+                if (_isAwaitingFirstStep) {
+                    traceFirstStep();
+                }
                 _lastMotionPlannedTime = motionEvt.time();
                 motionNeedsCpu = scheduler.isRoomInBuffer();
             }
@@ -401,19 +477,39 @@ template <typename Drv> bool State<Drv>::onIdleCpu(OnIdleCpuIntervalT interval)
     //Only check the communications periodically because calling execute(com.getCommand()) DOES add up.
     if (interval == OnIdleCpuIntervalWide) {
         if (!gcodeFileStack.empty()) {
-            if (_isRootComPersistent) {
+            //find which channels have input, with one syscall for all of them
+            gatherComPollFds();
+            if (_numComPollFds && poll(_comPollFds.data(), _numComPollFds, 0) == -1) {
+                //poll was interrupted; nothing is known, so treat every channel as ready
+                for (std::size_t i=0; i<_numComPollFds; ++i) {
+                    _comPollFds[i].revents = POLLIN;
+                }
+            }
+            std::size_t stackSize = gcodeFileStack.size();
+            if (_isRootComPersistent && isComReady(gcodeFileStack.front(), _rootComPollRange)) {
                 tendComChannel(gcodeFileStack.front());
             }
             //LOGV("Tending gcodeFileStack top\n");
             //now tend the top channel, although it's possible that it's been popped and there are no more com channels
             if (!gcodeFileStack.empty()) {
                 //it's OK if we tend the same com channel twice.
-                tendComChannel(gcodeFileStack.back());
+                //If the root channel pushed a new channel (M32) or returned from one, then the new top hasn't been polled yet.
+                if (gcodeFileStack.size() != stackSize || isComReady(gcodeFileStack.back(), _topComPollRange)) {
+                    tendComChannel(gcodeFileStack.back());
+                }
                 //Remove all gcode files that have been fully read
                 while (!gcodeFileStack.empty() && gcodeFileStack.back().isAtEof()) {
                     gcodeFileStack.pop_back();
                 }
             }
+            //send all the replies generated in this interval in one write per channel
+            flushComChannels();
+        }
+        if (_statusPublisher && EventClockT::now() >= _nextStatusTime) {
+            updateStatus();
+            _nextStatusTime += _statusInterval;
+            //don't try to catch up if we fell behind (e.g. during a long blocking operation)
+            _nextStatusTime = std::max(_nextStatusTime, EventClockT::now());
         }
     }
 
@@ -424,20 +520,83 @@ template <typename Drv> bool State<Drv>::onIdleCpu(OnIdleCpuIntervalT interval)
 template <typename Drv> void State<Drv>::eventLoop() {
     this->scheduler.initSchedThread();
     this->scheduler.eventLoop();
+    flushComChannels();
+}
+
+template <typename Drv> void State<Drv>::flushComChannels() {
+    for (gparse::Com &com : gcodeFileStack) {
+        com.flush();
+    }
+}
+
+template <typename Drv> void State<Drv>::gatherComPollFds() {
+    _numComPollFds = 0;
+    _rootComPollRange = _topComPollRange = ComPollRange();
+    if (gcodeFileStack.empty()) {
+        return;
+    }
+    if (_isRootComPersistent) {
+        _rootComPollRange = addComPollFds(gcodeFileStack.front());
+    }
+    if (gcodeFileStack.size() > 1 || !_isRootComPersistent) {
+        _topComPollRange = addComPollFds(gcodeFileStack.back());
+    } else {
+        _topComPollRange = _rootComPollRange;
+    }
+}
+
+template <typename Drv> typename State<Drv>::ComPollRange State<Drv>::addComPollFds(const gparse::Com &com) {
+    ComPollRange range;
+    range.first = _numComPollFds;
+    //a channel with input already buffered will be tended anyway, so there's no reason to wake up for it
+    //  (and a pipe that's still readable behind a command awaiting its reply would otherwise prevent any sleep).
+    if (!com.hasInputWithoutPoll()) {
+        std::size_t room = _comPollFds.size() - _numComPollFds;
+        std::size_t numFds = com.getPollFds(&_comPollFds[_numComPollFds], room);
+        range.count = std::min(numFds, room);
+        range.isComplete = numFds <= room;
+        _numComPollFds += range.count;
+    }
+    return range;
+}
+
+template <typename Drv> bool State<Drv>::isComReady(gparse::Com &com, const ComPollRange &range) {
+    return !range.isComplete || com.hasInputAfterPoll(&_comPollFds[range.first], range.count);
 }
 
 template <typename Drv> void State<Drv>::tendComChannel(gparse::Com &com) {
     if (com.tendCom()) {
         //note: may want to optimize this; once there is a pending command, this involves a lot of extra work.
         auto cmd = com.getCommand();
+        //the command may be executed several times before it's replied to (e.g. while the motion planner is busy);
+        //  it's dispatched on the first attempt.
+        CommandTimestamps &comStamps = com.getCommandTimestamps();
+        if (!CommandTimestamps::isSet(comStamps.dispatched)) {
+            comStamps.dispatched = EventClockT::now();
+        }
+        CommandTimestamps stamps = comStamps;
+        //homing runs a nested event loop, which may tend com channels while we're executing
+        CommandTimestamps *outerTimestamps = _executingTimestamps;
+        _executingTimestamps = &stamps;
         
         execute(cmd, [&](const gparse::Response &resp) {
-            if (!NO_LOG_M105 || !cmd.isM105()) {
-                LOG("command: %s\n", cmd.toGCode().c_str());
-                LOG("response: %s\n", resp.toString().c_str());
+            //skip formatting the command & response entirely when they won't be logged
+            if ((!NO_LOG_M105 || !cmd.isM105()) && logging::isInfoEnabled()) {
+                char cmdStr[256];
+                cmd.toGCode(cmdStr, sizeof(cmdStr));
+                LOG("command: %s\n", cmdStr);
+                char respStr[gparse::Response::MAX_REST_LENGTH+32];
+                resp.format(respStr, sizeof(respStr));
+                LOG("response: %s\n", respStr);
             }
-            com.reply(resp);
+            if (!resp.isComment()) {
+                stamps.replied = EventClockT::now();
+                traceCommand(cmd, stamps);
+            }
+            //the MotionPlanner holds a single move, so it has either 0 or 1 free slots
+            com.reply(resp, _motionPlanner.readyForNextMove() ? 1 : 0);
         });
+        _executingTimestamps = outerTimestamps;
         //if the above callback isn't called (because the command isn't ready to be serviced), 
         // then a future call to com.getCommand() will return the same command we just read (as opposed to the next line)
     }
@@ -446,6 +605,14 @@ template <typename Drv> void State<Drv>::tendComChannel(gparse::Com &com) {
 template <typename Drv> template <typename ReplyFunc> void State<Drv>::execute(gparse::Command const &cmd, ReplyFunc reply) {
     //process a gcode command received on the given communications channel and return an appropriate response
     if (cmd.isG0() || cmd.isG1()) { //rapid movement / controlled (linear) movement (currently uses same code)
+        if (!cmd.hasAnyXYZEParam()) {
+            //just a feed rate change (e.g. "G1 F3000"). Queueing a zero-length move would stall the motion planner.
+            if (cmd.hasF()) {
+                this->setDestMoveRatePrimitive(fUnitToPrimitive(cmd.getF()));
+            }
+            reply(gparse::Response::Ok);
+            return;
+        }
         if (!_motionPlanner.readyForNextMove()) { //don't queue another command unless we have the memory for it.
             return;
         }
@@ -608,8 +775,8 @@ template <typename Drv> template <typename ReplyFunc> void State<Drv>::execute(g
             b = ioDrivers.heatedBeds()[0].getMeasuredTemperature();
         }
         reply(gparse::Response(gparse::ResponseOk, {
-            std::make_pair("T", std::to_string(t)),
-            std::make_pair("B", std::to_string(b))
+            std::make_pair("T", t),
+            std::make_pair("B", b)
         }));
     } else if (cmd.isM106() || cmd.isM107()) { //set fan speed. Takes parameter S. Can be 0-255 (PWM) or in some implementations, 0.0-1.0
         if (cmd.isM107()) {
@@ -641,7 +808,7 @@ template <typename Drv> template <typename ReplyFunc> void State<Drv>::execute(g
         _isWaitingForHotend = true;
         reply(gparse::Response::Ok);
     } else if (cmd.isM110()) { //set current line number
-        LOGW("(state.h): OP_M110 (set current line number) not implemented\n");
+        //line numbers are tracked by the Com channel as lines are received
         reply(gparse::Response::Ok);
     } else if (cmd.isM111()) {
         // set debug info.
@@ -654,6 +821,7 @@ template <typename Drv> template <typename ReplyFunc> void State<Drv>::execute(g
         reply(gparse::Response::Ok);
     } else if (cmd.isM112()) { //emergency stop
         reply(gparse::Response::Ok);
+        flushComChannels();
         exit(1);
     } else if (cmd.isM115()) {
         // get firmware info
@@ -663,7 +831,9 @@ template <typename Drv> template <typename ReplyFunc> void State<Drv>::execute(g
         // and will also help track the evolution of the software.
         reply(gparse::Response(gparse::ResponseOk, {
             std::make_pair("FIRMWARE_NAME", "printipi"),
-            std::make_pair("FIRMWARE_URL", "https%3A//github.com/Wallacoloo/printipi")
+            std::make_pair("FIRMWARE_URL", "https%3A//github.com/Wallacoloo/printipi"),
+            //hosts may switch to the binary protocol (gparse/binaryprotocol.h) via M880 S1
+            std::make_pair("BINARY_PROTOCOL", "1")
         }));
     } else if (cmd.isM116()) { //Wait for all heaters (and slow moving variables) to reach target
         _isWaitingForHotend = true;
@@ -692,6 +862,27 @@ template <typename Drv> template <typename ReplyFunc> void State<Drv>::execute(g
             reply(gparse::Response(gparse::ResponseWarning, "Invalid servo index"));
         }
         reply(gparse::Response::Ok);
+    } else if (cmd.isM880()) { //enter (S1) or leave (S0) the binary protocol
+        //the Com channel switches formats as soon as the line is received
+        reply(gparse::Response::Ok);
+    } else if (cmd.isM881()) { //report the latency of commands (printipi-specific)
+        //With no P parameter, reply with "<stage>:<count>/<p50>/<p99>/<max>" (in us) for each stage (see LatencyTracer::Stage).
+        //P<n> replies with the histogram of stage n instead, as "<bucket limit (us)>:<count>" pairs.
+        //S1 clears the histograms after reporting them.
+        char text[gparse::Response::MAX_REST_LENGTH+1];
+        int stage = cmd.getP(-1);
+        if (!cmd.hasParam('P')) {
+            _latencyTracer.formatSummary(text, sizeof(text));
+        } else if (stage >= 0 && stage < LatencyTracer::NUM_STAGES) {
+            _latencyTracer.formatHistogram((LatencyTracer::Stage)stage, text, sizeof(text));
+        } else {
+            reply(gparse::Response(gparse::ResponseWarning, "Invalid latency stage"));
+            text[0] = '\0';
+        }
+        if (cmd.getS(0)) {
+            _latencyTracer.clear();
+        }
+        reply(gparse::Response(gparse::ResponseOk, static_cast<const char*>(text)));
     } else if (cmd.isM999()) {
         //Restart after being stopped by error.
         //I think this gets sent whenever Octoprint temporarily loses communication with the program
@@ -715,6 +906,9 @@ template <typename Drv> void State<Drv>::queueArc(const Vector4f &dest, const Ve
     //start the next move at the time that the previous move is scheduled to complete, unless that time is in the past
     auto startTime = std::max(_lastMotionPlannedTime, EventClockT::now());
     _motionPlanner.arcTo(startTime, dest, center, velXyz, minExtRate, maxExtRate, isCW);
+    if (_executingTimestamps) {
+        _executingTimestamps->planned = EventClockT::now();
+    }
 }
         
 template <typename Drv> void State<Drv>::queueMovement(const Vector4f &dest, OptionalArg<float> velXyz, const motion::MotionFlags flags) {
@@ -726,6 +920,9 @@ template <typename Drv> void State<Drv>::queueMovement(const Vector4f &dest, Opt
     //start the next move at the time that the previous move is scheduled to complete, unless that time is in the past
     auto startTime = std::max(_lastMotionPlannedTime, EventClockT::now());
     _motionPlanner.moveTo(startTime, dest, velXyz.get(destMoveRatePrimitive()), minExtRate, maxExtRate, flags);
+    if (_executingTimestamps) {
+        _executingTimestamps->planned = EventClockT::now();
+    }
 }
 
 template <typename Drv> void State<Drv>::homeEndstops() {
@@ -772,4 +969,80 @@ template <typename Drv> std::string State<Drv>::getEndstopStatusString() {
     return imploded.str();
 }
 
+template <typename Drv> void State<Drv>::updateStatus() {
+    struct printipi_status &status = _statusPublisher->beginUpdate();
+    Vector4f pos = _motionPlanner.actualCartesianPosition();
+    status.position[0] = pos.x();
+    status.position[1] = pos.y();
+    status.position[2] = pos.z();
+    status.position[3] = pos.e();
+    const auto &axisPositions = _motionPlanner.axisPositions();
+    status.num_axes = std::min<std::size_t>(axisPositions.size(), PRINTIPI_STATUS_MAX_AXES);
+    for (std::size_t i=0; i<status.num_axes; ++i) {
+        status.axis_steps[i] = axisPositions[i];
+    }
+
+    status.num_heaters = 0;
+    for (auto &heater : ioDrivers.heaters()) {
+        if (status.num_heaters == PRINTIPI_STATUS_MAX_HEATERS) {
+            break;
+        }
+        struct printipi_status_heater &h = status.heaters[status.num_heaters++];
+        h.target_c = heater.getTargetTemperature();
+        h.measured_c = heater.getMeasuredTemperature();
+        h.type = heater.isHotend() ? PRINTIPI_STATUS_HEATER_HOTEND : PRINTIPI_STATUS_HEATER_BED;
+    }
+    status.num_fans = 0;
+    for (auto &fan : ioDrivers.fans()) {
+        if (status.num_fans == PRINTIPI_STATUS_MAX_FANS) {
+            break;
+        }
+        status.fan_duty[status.num_fans++] = fan.getFanDutyCycle();
+    }
+    status.num_endstops = 0;
+    for (auto &endstop : ioDrivers.endstops()) {
+        if (status.num_endstops == PRINTIPI_STATUS_MAX_ENDSTOPS) {
+            break;
+        }
+        status.endstop_triggered[status.num_endstops++] = endstop.isEndstopTriggered();
+    }
+
+    status.is_moving = !_motionPlanner.readyForNextMove();
+    status.is_homed = _isHomed;
+    //the motion planner holds a single move at a time
+    status.free_planner_slots = _motionPlanner.readyForNextMove() ? 1 : 0;
+    status.num_com_channels = gcodeFileStack.size();
+    if (gcodeFileStack.empty()) {
+        status.pending_commands = 0;
+        status.line_number = 0;
+    } else {
+        status.pending_commands = gcodeFileStack.front().numPendingCommands();
+        status.line_number = gcodeFileStack.front().lastLineNumber();
+    }
+    _statusPublisher->endUpdate();
+}
+
+template <typename Drv> void State<Drv>::traceCommand(const gparse::Command &cmd, const CommandTimestamps &stamps) {
+    if (!CommandTimestamps::isSet(stamps.planned)) {
+        char opcode[5];
+        cmd.getOpcode(opcode);
+        _latencyTracer.record(stamps, opcode, cmd.getLineNumber());
+        return;
+    }
+    if (_isAwaitingFirstStep) {
+        //the previous move never queued a step (e.g. it was zero-length)
+        _latencyTracer.record(_awaitingFirstStep, _awaitingFirstStepOpcode, _awaitingFirstStepLine);
+    }
+    _isAwaitingFirstStep = true;
+    _awaitingFirstStep = stamps;
+    cmd.getOpcode(_awaitingFirstStepOpcode);
+    _awaitingFirstStepLine = cmd.getLineNumber();
+}
+
+template <typename Drv> void State<Drv>::traceFirstStep() {
+    _awaitingFirstStep.firstStep = EventClockT::now();
+    _latencyTracer.record(_awaitingFirstStep, _awaitingFirstStepOpcode, _awaitingFirstStepLine);
+    _isAwaitingFirstStep = false;
+}
+
 #endif
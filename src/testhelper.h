@@ -282,6 +282,11 @@ template <typename MachineT=machines::Machine> class TestHelper {
                 eventThread.join();
             }
         }
+        //direct access to the State, e.g. to configure it before calling threadedEventLoop().
+        //  It mustn't be modified once the event loop is running.
+        State<MachineT>& getState() {
+            return state;
+        }
         void threadedEventLoop() {
             eventThread = std::thread([&](){ 
                 state.eventLoop(); 
@@ -0,0 +1,100 @@
+#!/usr/bin/env python
+# Reference encoder for the binary move protocol described in src/gparse/binaryprotocol.h
+# Converts a gcode file into a stream of binary records, which a host can send to Printipi after "M880 S1".
+#
+# usage: python gcode2bin.py input.gcode output.bin [--first-seq N]
+#   The records are numbered starting at --first-seq (default 1), which must be one greater than the last line number
+#   the host sent (or set via M110) before switching to binary.
+#   An EXIT record is appended, returning the channel to text mode.
+import binascii
+import struct
+import sys
+
+SYNC = 0xFE
+RECORD_LINEAR_MOVE = 0x01
+RECORD_RAPID_MOVE = 0x02
+RECORD_ARC_CW = 0x03
+RECORD_ARC_CCW = 0x04
+RECORD_FEEDRATE = 0x05
+RECORD_MCODE = 0x06
+RECORD_TEXT = 0x07
+RECORD_EXIT = 0x7F
+NAN = float('nan')
+
+def record(type, seq, payload):
+	body = struct.pack('<BH', type, seq & 0xffff) + payload
+	#CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+	crc = binascii.crc_hqx(body, 0xffff)
+	return struct.pack('<B', SYNC) + body + struct.pack('<H', crc)
+
+def parse(line):
+	"""Split a line of gcode into (opcode, {param: value}), or return None if it is blank.
+	Returns params=None if any parameter isn't a plain number (e.g. M117 text)."""
+	line = line.split(';')[0].split('*')[0].strip()
+	if not line:
+		return None
+	words = line.split()
+	if words[0][0] in 'Nn':
+		words = words[1:]
+	if not words:
+		return None
+	opcode = words[0].upper()
+	params = {}
+	try:
+		for word in words[1:]:
+			params[word[0].upper()] = float(word[1:]) if len(word) > 1 else 0.0
+	except ValueError:
+		params = None
+	return opcode, params
+
+def encodeLine(line, seq):
+	"""Return the binary records (as a list of byte strings) for one line of gcode."""
+	parsed = parse(line)
+	if parsed is None:
+		return []
+	opcode, params = parsed
+	text = line.split(';')[0].strip()
+	if params is not None:
+		get = lambda p: params.get(p, NAN)
+		if opcode in ('G0', 'G1') and set(params) <= set('XYZEF'):
+			records = []
+			if 'F' in params:
+				records.append((RECORD_FEEDRATE, struct.pack('<f', params['F'])))
+			if set(params) - set('F'):
+				type = RECORD_LINEAR_MOVE if opcode == 'G1' else RECORD_RAPID_MOVE
+				records.append((type, struct.pack('<4f', get('X'), get('Y'), get('Z'), get('E'))))
+			return [record(t, seq+i, p) for i, (t, p) in enumerate(records)]
+		if opcode in ('G2', 'G3') and set(params) <= set('XYZEIJ'):
+			type = RECORD_ARC_CW if opcode == 'G2' else RECORD_ARC_CCW
+			return [record(type, seq, struct.pack('<6f', get('X'), get('Y'), get('Z'), get('E'), get('I'), get('J')))]
+		if opcode[0] == 'M' and opcode[1:].isdigit() and set(params) <= set('SP'):
+			return [record(RECORD_MCODE, seq, struct.pack('<H2f', int(opcode[1:]), get('S'), get('P')))]
+	#anything else is sent verbatim
+	if len(text) > 255:
+		raise ValueError("line too long to encode: %s" %text)
+	return [record(RECORD_TEXT, seq, struct.pack('<B', len(text)) + text.encode('ascii'))]
+
+def encode(lines, firstSeq=1):
+	out = []
+	seq = firstSeq
+	for line in lines:
+		records = encodeLine(line, seq)
+		seq += len(records)
+		out.extend(records)
+	out.append(record(RECORD_EXIT, seq, b''))
+	return b''.join(out)
+
+if __name__ == "__main__":
+	if len(sys.argv) < 3:
+		print("usage: %s input.gcode output.bin [--first-seq N]" %sys.argv[0])
+		sys.exit(1)
+	firstSeq = 1
+	if '--first-seq' in sys.argv:
+		firstSeq = int(sys.argv[sys.argv.index('--first-seq')+1])
+	with open(sys.argv[1]) as f:
+		lines = f.readlines()
+	data = encode(lines, firstSeq)
+	with open(sys.argv[2], 'wb') as f:
+		f.write(data)
+	textLength = sum(len(l) for l in lines)
+	print("%i bytes of gcode -> %i bytes of records" %(textLength, len(data)))
@@ -0,0 +1,93 @@
+/*
+ * Reference reader for the shared memory status snapshot described in src/common/statussnapshot.h
+ * Prints the status published by printipi (when run with --status-shm <name>) without sending any commands to it.
+ *
+ * build: gcc -O2 -o printipi-status printipi-status.c -lrt
+ * usage: ./printipi-status [name] [--watch <seconds>]
+ *   name defaults to /printipi-status.
+ *   --watch reprints the status every <seconds> until interrupted.
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "../src/common/statussnapshot.h"
+
+static void print_status(const struct printipi_status *s) {
+    uint32_t i;
+    printf("update %u at %lld.%06lld s\n", s->update_count,
+        (long long)(s->timestamp_usec/1000000), (long long)(s->timestamp_usec%1000000));
+    printf("position: X:%.3f Y:%.3f Z:%.3f E:%.3f\n", s->position[0], s->position[1], s->position[2], s->position[3]);
+    printf("axis steps:");
+    for (i = 0; i < s->num_axes; ++i) {
+        printf(" %d", s->axis_steps[i]);
+    }
+    printf("\n");
+    for (i = 0; i < s->num_heaters; ++i) {
+        printf("%s %u: %.1f / %.1f C\n", s->heaters[i].type == PRINTIPI_STATUS_HEATER_BED ? "bed" : "hotend", i,
+            s->heaters[i].measured_c, s->heaters[i].target_c);
+    }
+    for (i = 0; i < s->num_fans; ++i) {
+        printf("fan %u: %.0f%%\n", i, s->fan_duty[i]*100);
+    }
+    printf("endstops:");
+    for (i = 0; i < s->num_endstops; ++i) {
+        printf(" %s", s->endstop_triggered[i] ? "triggered" : "open");
+    }
+    printf("\n");
+    printf("moving: %s, homed: %s\n", s->is_moving ? "yes" : "no", s->is_homed ? "yes" : "no");
+    printf("line: %d, pending commands: %u, free planner slots: %u, com channels: %u\n",
+        s->line_number, s->pending_commands, s->free_planner_slots, s->num_com_channels);
+}
+
+int main(int argc, char **argv) {
+    const char *name = PRINTIPI_STATUS_DEFAULT_NAME;
+    double watch = 0;
+    const struct printipi_status *shared;
+    struct printipi_status snapshot;
+    int fd, i;
+    for (i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--watch") && i+1 < argc) {
+            watch = atof(argv[++i]);
+        } else {
+            name = argv[i];
+        }
+    }
+
+    fd = shm_open(name, O_RDONLY, 0);
+    if (fd == -1) {
+        perror("shm_open (is printipi running with --status-shm?)");
+        return 1;
+    }
+    shared = mmap(NULL, sizeof(*shared), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shared == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    if (shared->version != PRINTIPI_STATUS_VERSION || shared->size != sizeof(*shared)) {
+        fprintf(stderr, "%s has version %u (size %u), but this reader expects version %u (size %u)\n", name,
+            shared->version, shared->size, PRINTIPI_STATUS_VERSION, (unsigned)sizeof(*shared));
+        return 1;
+    }
+
+    do {
+        if (printipi_status_read(shared, &snapshot, 1000)) {
+            fprintf(stderr, "status is being updated too often to get a consistent copy\n");
+            return 1;
+        }
+        if (snapshot.version == PRINTIPI_STATUS_STALE) {
+            fprintf(stderr, "printipi is no longer publishing to %s\n", name);
+            return 1;
+        }
+        print_status(&snapshot);
+        if (watch > 0) {
+            printf("\n");
+            fflush(stdout);
+            usleep((useconds_t)(watch*1000000));
+        }
+    } while (watch > 0);
+    return 0;
+}